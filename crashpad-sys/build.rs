@@ -184,6 +184,10 @@ fn run() -> Result<(), Box<dyn std::error::Error>> {
     println!("cargo:rerun-if-changed=build.rs");
     println!("cargo:rerun-if-changed=wrapper.h");
     println!("cargo:rerun-if-changed=crashpad_wrapper.cc");
+    println!("cargo:rerun-if-env-changed=CRASHPAD_CACHE_DIR");
+    println!("cargo:rerun-if-env-changed=CRASHPAD_BUILD_CACHE");
+    println!("cargo:rerun-if-env-changed=CRASHPAD_COMPILER_LAUNCHER");
+    println!("cargo:rerun-if-env-changed=CRASHPAD_OPTIMIZE");
 
     // Execute all build phases in order
     phases
@@ -4,7 +4,26 @@
 ///
 /// Simple module to provide consistent cache paths across all build methods
 use std::env;
-use std::path::PathBuf;
+use std::fs;
+use std::io;
+use std::path::{Path, PathBuf};
+use std::process::Command;
+
+use crate::config::BuildConfig;
+
+/// Bump to invalidate every cached build, e.g. when the stored layout changes
+const BUILD_CACHE_VERSION: &str = "2";
+
+/// Binaries at the top of the build directory that are cached with the
+/// libraries, where the target has them
+const BUILD_BINARIES: [&str; 3] = [
+    "crashpad_handler",
+    "crashpad_handler.exe",
+    "crashpad_wer.dll",
+];
+
+/// Submodules whose commits are compiled into the native build
+const BUILD_SUBMODULES: [&str; 4] = ["crashpad", "mini_chromium", "zlib", "lss"];
 
 /// Get cache root directory
 ///
@@ -33,3 +52,454 @@ pub fn tools_dir() -> PathBuf {
 pub fn prebuilt_dir(version: &str, target: &str) -> PathBuf {
     cache_root().join("prebuilt").join(version).join(target)
 }
+
+/// Get content-addressed store directory (for verified prebuilt archives
+/// and their extracted trees, keyed by SHA-256)
+pub fn store_dir() -> PathBuf {
+    cache_root().join("store")
+}
+
+/// Exclusive lock on a cache entry, shared between concurrent builds
+///
+/// An OS advisory lock (`flock` on Unix, `LockFileEx` on Windows) on a lock
+/// file, so it is released with the process however the build ends, even on
+/// Ctrl-C or a crash, and never taken from a build that is still running.
+/// Released on drop. The file itself stays, holding the pid of the latest
+/// holder: removing it would let a build lock a new file while another
+/// still holds the old one.
+pub struct CacheLock {
+    _file: fs::File,
+}
+
+impl CacheLock {
+    /// Wait until no other build holds `path`, then take it
+    pub fn acquire(path: &Path) -> io::Result<Self> {
+        use std::io::{Read, Seek, Write};
+
+        if let Some(parent) = path.parent() {
+            fs::create_dir_all(parent)?;
+        }
+        let mut file = fs::OpenOptions::new()
+            .read(true)
+            .write(true)
+            .create(true)
+            .truncate(false)
+            .open(path)?;
+
+        if !os_lock::lock(&file, false)? {
+            // Windows refuses reads of a locked range, so the pid may be missing
+            let mut holder = String::new();
+            let _ = file.read_to_string(&mut holder);
+            let holder = match holder.trim() {
+                "" => String::new(),
+                pid => format!(" (pid {pid})"),
+            };
+            println!(
+                "cargo:warning=Waiting for another build{holder} to release {}",
+                path.display()
+            );
+            os_lock::lock(&file, true)?;
+        }
+
+        file.set_len(0)?;
+        file.rewind()?;
+        writeln!(file, "{}", std::process::id())?;
+        Ok(Self { _file: file })
+    }
+}
+
+#[cfg(unix)]
+mod os_lock {
+    use std::fs::File;
+    use std::io;
+    use std::os::raw::c_int;
+    use std::os::unix::io::AsRawFd;
+
+    // Same values on Linux, Android, macOS and the BSDs
+    const LOCK_EX: c_int = 2;
+    const LOCK_NB: c_int = 4;
+
+    extern "C" {
+        fn flock(fd: c_int, operation: c_int) -> c_int;
+    }
+
+    /// Take an exclusive lock on `file`; returns false if another process
+    /// holds it and `wait` is not set
+    pub fn lock(file: &File, wait: bool) -> io::Result<bool> {
+        let operation = if wait { LOCK_EX } else { LOCK_EX | LOCK_NB };
+        loop {
+            if unsafe { flock(file.as_raw_fd(), operation) } == 0 {
+                return Ok(true);
+            }
+            let error = io::Error::last_os_error();
+            match error.kind() {
+                io::ErrorKind::Interrupted => continue,
+                io::ErrorKind::WouldBlock => return Ok(false),
+                _ => return Err(error),
+            }
+        }
+    }
+}
+
+#[cfg(windows)]
+mod os_lock {
+    use std::fs::File;
+    use std::io;
+    use std::os::raw::c_void;
+    use std::os::windows::io::AsRawHandle;
+
+    const LOCKFILE_FAIL_IMMEDIATELY: u32 = 0x1;
+    const LOCKFILE_EXCLUSIVE_LOCK: u32 = 0x2;
+    const ERROR_LOCK_VIOLATION: i32 = 33;
+
+    #[repr(C)]
+    struct Overlapped {
+        internal: usize,
+        internal_high: usize,
+        offset: u32,
+        offset_high: u32,
+        event: *mut c_void,
+    }
+
+    #[link(name = "kernel32")]
+    extern "system" {
+        fn LockFileEx(
+            file: *mut c_void,
+            flags: u32,
+            reserved: u32,
+            bytes_low: u32,
+            bytes_high: u32,
+            overlapped: *mut Overlapped,
+        ) -> i32;
+    }
+
+    /// Take an exclusive lock on `file`; returns false if another process
+    /// holds it and `wait` is not set
+    pub fn lock(file: &File, wait: bool) -> io::Result<bool> {
+        let mut flags = LOCKFILE_EXCLUSIVE_LOCK;
+        if !wait {
+            flags |= LOCKFILE_FAIL_IMMEDIATELY;
+        }
+        let mut overlapped = Overlapped {
+            internal: 0,
+            internal_high: 0,
+            offset: 0,
+            offset_high: 0,
+            event: std::ptr::null_mut(),
+        };
+        // The whole file, however long it grows
+        let locked = unsafe {
+            LockFileEx(
+                file.as_raw_handle() as *mut c_void,
+                flags,
+                0,
+                u32::MAX,
+                u32::MAX,
+                &mut overlapped,
+            )
+        };
+        if locked != 0 {
+            return Ok(true);
+        }
+        let error = io::Error::last_os_error();
+        if error.raw_os_error() == Some(ERROR_LOCK_VIOLATION) {
+            return Ok(false);
+        }
+        Err(error)
+    }
+}
+
+/// Get build cache directory (for native build outputs)
+pub fn build_dir() -> PathBuf {
+    cache_root().join("build")
+}
+
+/// Content-addressed cache of native build outputs
+///
+/// Entries are keyed by everything that goes into the GN/Ninja build: GN args,
+/// target, profile, compiler identity and flags, and the pinned submodule
+/// commits. A hit restores the static libraries, the handler and, on Windows,
+/// the WER module into the build directory instead of running GN and Ninja,
+/// so clean builds and other workspaces sharing CRASHPAD_CACHE_DIR reuse one
+/// build.
+///
+/// Intermediate objects are not cached: restored outputs would be older than
+/// a fresh checkout and Ninja would rebuild them anyway.
+pub struct BuildCache {
+    key: String,
+    verbose: bool,
+}
+
+impl BuildCache {
+    /// Create the cache for `config`
+    ///
+    /// Returns None when disabled with CRASHPAD_BUILD_CACHE=0, or when a
+    /// submodule has local changes that its commit does not describe.
+    pub fn new(config: &BuildConfig) -> Option<Self> {
+        if matches!(
+            env::var("CRASHPAD_BUILD_CACHE").as_deref(),
+            Ok("0" | "false" | "off")
+        ) {
+            return None;
+        }
+
+        let mut hasher = KeyHasher::new();
+        hasher.field("version", BUILD_CACHE_VERSION);
+        hasher.field("crate", env!("CARGO_PKG_VERSION"));
+        hasher.field("target", &config.target);
+        hasher.field("profile", &config.profile);
+
+        // The launcher does not change what gets built
+        let mut gn_args: Vec<_> = config
+            .gn_args
+            .iter()
+            .filter(|(name, _)| name.as_str() != "cc_wrapper")
+            .collect();
+        gn_args.sort();
+        for (name, value) in gn_args {
+            hasher.field(name, value);
+        }
+
+        hasher.field("compiler", &config.compiler.to_string_lossy());
+        hasher.field("compiler_version", &compiler_version(&config.compiler));
+        for flag in &config.cxx_flags {
+            hasher.field("cxx_flag", flag);
+        }
+
+        let third_party = config.manifest_dir.join("third_party");
+        for submodule in BUILD_SUBMODULES {
+            match submodule_commit(&third_party.join(submodule)) {
+                SubmoduleState::Commit(commit) => hasher.field(submodule, &commit),
+                SubmoduleState::Missing => hasher.field(submodule, ""),
+                SubmoduleState::Modified => {
+                    if config.verbose {
+                        eprintln!("Build cache disabled: {submodule} has local changes");
+                    }
+                    return None;
+                }
+            }
+        }
+
+        Some(Self {
+            key: hasher.finish(),
+            verbose: config.verbose,
+        })
+    }
+
+    /// Cache key of the native build
+    pub fn key(&self) -> &str {
+        &self.key
+    }
+
+    fn outputs_dir(&self) -> PathBuf {
+        build_dir().join("out").join(&self.key)
+    }
+
+    /// Restore cached outputs into `build_dir`; returns false on a miss
+    pub fn restore_outputs(&self, build_dir: &Path) -> io::Result<bool> {
+        let outputs = self.outputs_dir();
+        if !outputs.is_dir() {
+            return Ok(false);
+        }
+
+        copy_tree(&outputs, build_dir)?;
+        if self.verbose {
+            eprintln!("Restored Crashpad build from {}", outputs.display());
+        }
+        Ok(true)
+    }
+
+    /// Store the static libraries, handler and WER module found in `build_dir`
+    pub fn store_outputs(&self, build_dir: &Path) -> io::Result<()> {
+        let outputs = self.outputs_dir();
+        if outputs.is_dir() {
+            return Ok(());
+        }
+
+        let staging = staging_dir(&outputs);
+        let _ = fs::remove_dir_all(&staging);
+        fs::create_dir_all(&staging)?;
+        copy_outputs(&build_dir.join("obj"), &staging.join("obj"))?;
+        for binary in BUILD_BINARIES {
+            let path = build_dir.join(binary);
+            if path.is_file() {
+                fs::copy(&path, staging.join(binary))?;
+            }
+        }
+
+        publish(&staging, &outputs)?;
+        if self.verbose {
+            eprintln!("Stored Crashpad build in {}", outputs.display());
+        }
+        Ok(())
+    }
+
+    /// Path of the cached wrapper object compiled from `sources` with `args`,
+    /// keyed by the native build, the contents of every source and header it
+    /// includes from the crate, and the compiler arguments, which carry the
+    /// defines and include paths
+    pub fn wrapper_object(
+        &self,
+        sources: &[&Path],
+        args: &[String],
+        file_name: &str,
+    ) -> io::Result<PathBuf> {
+        let mut hasher = KeyHasher::new();
+        hasher.field("build", &self.key);
+        for source in sources {
+            hasher.field("source", &source.file_name().unwrap().to_string_lossy());
+            hasher.bytes(&fs::read(source)?);
+        }
+        for arg in args {
+            hasher.field("arg", arg);
+        }
+        Ok(build_dir()
+            .join("wrapper")
+            .join(hasher.finish())
+            .join(file_name))
+    }
+
+    /// Store a freshly compiled wrapper object at `cached`
+    pub fn store_wrapper_object(&self, object: &Path, cached: &Path) -> io::Result<()> {
+        let entry = cached.parent().expect("cached object has a directory");
+        if entry.is_dir() {
+            return Ok(());
+        }
+
+        let staging = staging_dir(entry);
+        let _ = fs::remove_dir_all(&staging);
+        fs::create_dir_all(&staging)?;
+        fs::copy(object, staging.join(cached.file_name().unwrap()))?;
+        publish(&staging, entry)
+    }
+}
+
+/// 64-bit FNV-1a over labelled fields
+///
+/// Stable across Rust releases, unlike the std hashers, so keys stay valid
+/// for caches shared between toolchains.
+struct KeyHasher(u64);
+
+impl KeyHasher {
+    fn new() -> Self {
+        Self(0xcbf2_9ce4_8422_2325)
+    }
+
+    fn bytes(&mut self, bytes: &[u8]) {
+        for byte in bytes {
+            self.0 ^= u64::from(*byte);
+            self.0 = self.0.wrapping_mul(0x0000_0100_0000_01b3);
+        }
+    }
+
+    fn field(&mut self, name: &str, value: &str) {
+        self.bytes(name.as_bytes());
+        self.bytes(&[0]);
+        self.bytes(value.as_bytes());
+        self.bytes(&[0]);
+    }
+
+    fn finish(&self) -> String {
+        format!("{:016x}", self.0)
+    }
+}
+
+enum SubmoduleState {
+    Commit(String),
+    Modified,
+    Missing,
+}
+
+/// Commit checked out in `dir`, ignoring untracked files such as the
+/// dependency links created by the prepare phase
+fn submodule_commit(dir: &Path) -> SubmoduleState {
+    if !dir.exists() {
+        return SubmoduleState::Missing;
+    }
+
+    let git = |args: &[&str]| {
+        Command::new("git")
+            .arg("-C")
+            .arg(dir)
+            .args(args)
+            .output()
+            .ok()
+            .filter(|output| output.status.success())
+            .map(|output| String::from_utf8_lossy(&output.stdout).trim().to_string())
+    };
+
+    match git(&["rev-parse", "HEAD"]) {
+        // Packaged crates have no git metadata; the crate version covers them
+        None => SubmoduleState::Missing,
+        Some(commit) => match git(&["status", "--porcelain", "--untracked-files=no"]) {
+            Some(status) if status.is_empty() => SubmoduleState::Commit(commit),
+            _ => SubmoduleState::Modified,
+        },
+    }
+}
+
+/// First line printed by `compiler --version`, or empty if it has none
+fn compiler_version(compiler: &Path) -> String {
+    Command::new(compiler)
+        .arg("--version")
+        .output()
+        .ok()
+        .and_then(|output| {
+            String::from_utf8_lossy(&output.stdout)
+                .lines()
+                .next()
+                .map(str::to_string)
+        })
+        .unwrap_or_default()
+}
+
+/// Process-unique sibling of `entry` to assemble it in
+pub fn staging_dir(entry: &Path) -> PathBuf {
+    let name = entry.file_name().unwrap().to_string_lossy();
+    entry.with_file_name(format!(".{name}.{}.tmp", std::process::id()))
+}
+
+/// Move a fully written `staging` directory into place as `entry`
+///
+/// Concurrent builds may race to publish the same entry; the loser's copy is
+/// identical and is discarded.
+pub fn publish(staging: &Path, entry: &Path) -> io::Result<()> {
+    if let Err(e) = fs::rename(staging, entry) {
+        let _ = fs::remove_dir_all(staging);
+        if !entry.is_dir() {
+            return Err(e);
+        }
+    }
+    Ok(())
+}
+
+/// Copy the static libraries under `src` to `dst`, keeping their layout
+fn copy_outputs(src: &Path, dst: &Path) -> io::Result<()> {
+    for entry in fs::read_dir(src)? {
+        let path = entry?.path();
+        if path.is_dir() {
+            copy_outputs(&path, &dst.join(path.file_name().unwrap()))?;
+        } else if matches!(
+            path.extension().and_then(|ext| ext.to_str()),
+            Some("a" | "lib")
+        ) {
+            fs::create_dir_all(dst)?;
+            fs::copy(&path, dst.join(path.file_name().unwrap()))?;
+        }
+    }
+    Ok(())
+}
+
+fn copy_tree(src: &Path, dst: &Path) -> io::Result<()> {
+    fs::create_dir_all(dst)?;
+    for entry in fs::read_dir(src)? {
+        let path = entry?.path();
+        let target = dst.join(path.file_name().unwrap());
+        if path.is_dir() {
+            copy_tree(&path, &target)?;
+        } else {
+            fs::copy(&path, &target)?;
+        }
+    }
+    Ok(())
+}
@@ -2,9 +2,22 @@
 
 use std::collections::HashMap;
 use std::env;
-use std::path::PathBuf;
+use std::path::{Path, PathBuf};
 use std::process::Command;
 
+/// Build profile for the native code, see CRASHPAD_OPTIMIZE
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum OptimizeProfile {
+    /// Crashpad's own GN defaults
+    Default,
+    /// Per-function/data sections so the final link can drop unused code,
+    /// and a stripped handler
+    Size,
+    /// Size, plus ThinLTO bitcode for the Crashpad libraries, the wrapper
+    /// and the handler
+    ThinLto,
+}
+
 #[derive(Debug, Clone)]
 pub struct BuildConfig {
     // Basic information
@@ -20,6 +33,7 @@ pub struct BuildConfig {
     pub compiler: PathBuf,
     pub archiver: String,
     pub cxx_flags: Vec<String>,
+    pub compiler_launcher: Option<PathBuf>, // sccache/ccache, see CRASHPAD_COMPILER_LAUNCHER
 
     // GN build settings (only for vendored build, not depot_tools)
     pub gn_args: HashMap<String, String>,
@@ -30,6 +44,7 @@ pub struct BuildConfig {
     pub frameworks: Vec<String>,    // iOS/macOS only
 
     // Build options
+    pub optimize: OptimizeProfile,
     pub verbose: bool,
 }
 
@@ -54,8 +69,9 @@ impl BuildConfig {
             compiler: PathBuf::from("c++"),
             archiver: "ar".to_string(),
             cxx_flags: vec!["-std=c++17".to_string()],
+            compiler_launcher: Self::find_compiler_launcher()?,
             gn_args: HashMap::new(),
-            link_libs: vec!["stdc++".to_string(), "pthread".to_string()],
+            link_libs: vec!["stdc++".to_string(), "pthread".to_string(), "z".to_string()],
             crashpad_libs: vec![
                 "crashpad_wrapper".to_string(),
                 "client".to_string(),
@@ -68,6 +84,7 @@ impl BuildConfig {
                 "base".to_string(),
             ],
             frameworks: Vec::new(),
+            optimize: Self::optimize_profile()?,
             verbose: env::var("CRASHPAD_VERBOSE").is_ok(),
         };
 
@@ -102,9 +119,136 @@ impl BuildConfig {
             return Err(format!("Unsupported target: {target}. Supported targets: android, ios, darwin, windows-msvc, linux").into());
         }
 
+        config.setup_optimize()?;
+
         Ok(config)
     }
 
+    /// Read the optimize profile from CRASHPAD_OPTIMIZE or the
+    /// `optimize-size` feature
+    fn optimize_profile() -> Result<OptimizeProfile, Box<dyn std::error::Error>> {
+        match env::var("CRASHPAD_OPTIMIZE").as_deref() {
+            Ok("size") => Ok(OptimizeProfile::Size),
+            Ok("thin-lto") => Ok(OptimizeProfile::ThinLto),
+            Ok("" | "default") => Ok(OptimizeProfile::Default),
+            Ok(other) => Err(format!(
+                "Unsupported CRASHPAD_OPTIMIZE value: {other}. Supported: default, size, thin-lto"
+            )
+            .into()),
+            Err(_) if env::var("CARGO_FEATURE_OPTIMIZE_SIZE").is_ok() => Ok(OptimizeProfile::Size),
+            Err(_) => Ok(OptimizeProfile::Default),
+        }
+    }
+
+    /// Add the compiler and linker flags of the optimize profile
+    ///
+    /// Crashpad's libraries are linked as ordinary archives, so only the
+    /// objects the wrapper references are pulled in. Splitting sections lets
+    /// the linker also drop the unused functions inside those objects; rustc
+    /// already asks for --gc-sections/-dead_strip when linking. The depot_tools
+    /// build passes the same extra_cflags/extra_ldflags to its GN build.
+    fn setup_optimize(&mut self) -> Result<(), Box<dyn std::error::Error>> {
+        if self.optimize == OptimizeProfile::Default {
+            return Ok(());
+        }
+
+        let msvc = self.target.contains("windows");
+        if msvc {
+            if self.optimize == OptimizeProfile::ThinLto {
+                return Err("CRASHPAD_OPTIMIZE=thin-lto requires a clang toolchain".into());
+            }
+            self.append_gn_flags("extra_cflags", &["/Gy", "/Gw"]);
+            self.append_gn_flags("extra_ldflags", &["/OPT:REF", "/OPT:ICF"]);
+            return Ok(());
+        }
+
+        let mut cflags = vec!["-ffunction-sections", "-fdata-sections"];
+        let mut ldflags = vec![if self.target.contains("apple") {
+            "-Wl,-dead_strip"
+        } else {
+            "-Wl,--gc-sections"
+        }];
+        if self.optimize == OptimizeProfile::ThinLto {
+            cflags.push("-flto=thin");
+            ldflags.push("-flto=thin");
+            // The wrapper object is bitcode, which needs an LLVM archiver to
+            // index; libtool handles it on Apple targets
+            if self.archiver == "ar" {
+                if let Some(llvm_ar) = self.llvm_tool("llvm-ar") {
+                    self.archiver = llvm_ar.to_string_lossy().into_owned();
+                }
+            }
+        }
+
+        self.append_gn_flags("extra_cflags", &cflags);
+        self.append_gn_flags("extra_ldflags", &ldflags);
+        self.cxx_flags
+            .extend(cflags.iter().map(|flag| flag.to_string()));
+        Ok(())
+    }
+
+    /// Append `flags` to a space-separated GN string arg
+    fn append_gn_flags(&mut self, name: &str, flags: &[&str]) {
+        let mut value = self
+            .gn_args
+            .get(name)
+            .map(|value| value.trim_matches('"').to_string())
+            .unwrap_or_default();
+        for flag in flags {
+            if !value.is_empty() {
+                value.push(' ');
+            }
+            value.push_str(flag);
+        }
+        self.gn_args
+            .insert(name.to_string(), format!("\"{value}\""));
+    }
+
+    /// Whether the handler copied out of the build directory is stripped
+    pub fn strip_handler(&self) -> bool {
+        self.optimize != OptimizeProfile::Default
+    }
+
+    /// Strip `handler`, a copy taken out of the build directory, if the
+    /// optimize profile asks for it
+    ///
+    /// The build directory keeps the symbols. A failed strip only warns.
+    pub fn strip_handler_copy(&self, handler: &Path) {
+        if !self.strip_handler() {
+            return;
+        }
+        let (strip, flags) = self.strip_tool();
+        let status = Command::new(&strip).args(flags).arg(handler).status();
+        if !status.is_ok_and(|status| status.success()) {
+            println!(
+                "cargo:warning=Failed to strip {} with {}",
+                handler.display(),
+                strip.display()
+            );
+        }
+    }
+
+    /// Strip tool for the handler and the flags to run it with
+    pub fn strip_tool(&self) -> (PathBuf, &'static [&'static str]) {
+        if self.target.contains("apple") {
+            return (PathBuf::from("strip"), &["-S", "-x"]);
+        }
+        (
+            self.llvm_tool("llvm-strip")
+                .unwrap_or_else(|| PathBuf::from("strip")),
+            &["--strip-all"],
+        )
+    }
+
+    /// Find an LLVM binutils replacement such as llvm-ar
+    fn llvm_tool(&self, name: &str) -> Option<PathBuf> {
+        // The NDK ships them next to its clang
+        if self.target.contains("android") {
+            return Some(self.compiler.with_file_name(name)).filter(|path| path.exists());
+        }
+        which::which(name).ok()
+    }
+
     /// Configure for Android
     fn setup_android(&mut self, target: &str) -> Result<(), Box<dyn std::error::Error>> {
         // Find NDK dynamically
@@ -174,6 +318,7 @@ impl BuildConfig {
             "c++abi".to_string(),
             "log".to_string(),
             "dl".to_string(),
+            "z".to_string(),
         ];
 
         Ok(())
@@ -269,7 +414,7 @@ impl BuildConfig {
         self.compiler = PathBuf::from("c++");
         self.archiver = "libtool".to_string();
 
-        self.link_libs = vec!["c++".to_string()];
+        self.link_libs = vec!["c++".to_string(), "z".to_string()];
         self.crashpad_libs.push("mig_output".to_string()); // macOS needs MIG-generated code
         self.frameworks = vec![
             "Foundation".to_string(),
@@ -343,6 +488,7 @@ impl BuildConfig {
             "common".to_string(),
             "util".to_string(),
             "base".to_string(),
+            "zlib".to_string(), // Crashpad builds its embedded zlib on Windows
         ];
 
         Ok(())
@@ -431,6 +577,27 @@ impl BuildConfig {
         Err("Android NDK not found. Please set ANDROID_NDK_HOME environment variable or install cargo-ndk (cargo install cargo-ndk)".into())
     }
 
+    /// Find the compiler launcher named by CRASHPAD_COMPILER_LAUNCHER
+    ///
+    /// `auto` picks sccache or ccache from PATH if either is installed, any
+    /// other value names the launcher itself. Unset means no launcher.
+    fn find_compiler_launcher() -> Result<Option<PathBuf>, Box<dyn std::error::Error>> {
+        let launcher = match env::var("CRASHPAD_COMPILER_LAUNCHER") {
+            Ok(launcher) if !launcher.is_empty() => launcher,
+            _ => return Ok(None),
+        };
+
+        if launcher == "auto" {
+            return Ok(["sccache", "ccache"]
+                .iter()
+                .find_map(|name| which::which(name).ok()));
+        }
+
+        which::which(&launcher)
+            .map(Some)
+            .map_err(|_| format!("Compiler launcher not found: {launcher}").into())
+    }
+
     /// Get build directory for current platform
     /// Uses a fixed path without hash for consistency between vendored and prebuild
     pub fn build_dir(&self) -> PathBuf {
@@ -8,6 +8,7 @@ use std::fs;
 use std::path::{Path, PathBuf};
 use std::process::Command;
 
+use crate::config::BuildConfig;
 use crate::tools::{depot_cmd, ensure_depot_tools, setup_depot_tools_env};
 
 /// Main entry point for build.rs
@@ -15,6 +16,8 @@ pub fn build_with_depot_tools() -> Result<(), Box<dyn std::error::Error>> {
     let manifest_dir = PathBuf::from(env::var("CARGO_MANIFEST_DIR")?);
     let target = env::var("TARGET")?;
     let profile = env::var("PROFILE").unwrap_or_else(|_| "debug".to_string());
+    // Platform settings and the optimize profile, shared with phases.rs
+    let config = BuildConfig::from_env()?;
 
     // Step 1: Setup depot_tools
     let platform_dir = manifest_dir
@@ -34,10 +37,11 @@ pub fn build_with_depot_tools() -> Result<(), Box<dyn std::error::Error>> {
         &manifest_dir,
         &target,
         &profile,
+        &config,
     )?;
 
     // Step 3: Build crashpad-rs-sys
-    build_crashpad_sys(&build_output, &target)?;
+    build_crashpad_sys(&build_output, &target, config)?;
 
     Ok(())
 }
@@ -55,6 +59,7 @@ pub fn build_crashpad_with_depot(
     manifest_dir: &Path,
     target: &str,
     profile: &str,
+    config: &BuildConfig,
 ) -> Result<CrashpadBuildOutput, Box<dyn std::error::Error>> {
     // Configure output directory to be in target/{target}/{profile}/crashpad_build
     let final_build_dir = manifest_dir
@@ -65,9 +70,39 @@ pub fn build_crashpad_with_depot(
         .join(profile)
         .join("crashpad_build");
 
-    // Check for build completion marker
+    // Configure GN build args
+    let mut gn_args = vec![
+        format!(
+            "is_debug={}",
+            if profile == "debug" { "true" } else { "false" }
+        ),
+        "crashpad_build_tests=false".to_string(),
+    ];
+
+    if target.contains("windows") {
+        gn_args.push("target_os=\"win\"".to_string());
+        gn_args.push(format!(
+            "target_cpu=\"{}\"",
+            if target.contains("x86_64") {
+                "x64"
+            } else {
+                "x86"
+            }
+        ));
+    }
+
+    // The runtime library on Windows and the optimize profile's flags
+    for name in ["extra_cflags", "extra_ldflags"] {
+        if let Some(value) = config.gn_args.get(name) {
+            gn_args.push(format!("{name}={value}"));
+        }
+    }
+    let gn_args = gn_args.join(" ");
+
+    // Check for build completion marker, which records the GN args it was
+    // built with
     let marker_file = final_build_dir.join(".crashpad-ok");
-    if marker_file.exists() {
+    if fs::read_to_string(&marker_file).is_ok_and(|built| built == gn_args) {
         println!("cargo:warning=Using cached Crashpad build (.crashpad-ok found)");
         println!(
             "cargo:warning=Note: If crashpad_wrapper.cc was modified, delete {} and rebuild",
@@ -165,31 +200,6 @@ pub fn build_crashpad_with_depot(
         crashpad_dir.join("crashpad_wrapper.cc"),
     )?;
 
-    // Configure GN build args
-    let mut gn_args = vec![
-        format!(
-            "is_debug={}",
-            if profile == "debug" { "true" } else { "false" }
-        ),
-        "crashpad_build_tests=false".to_string(),
-    ];
-
-    if target.contains("windows") {
-        gn_args.push("target_os=\"win\"".to_string());
-        gn_args.push(format!(
-            "target_cpu=\"{}\"",
-            if target.contains("x86_64") {
-                "x64"
-            } else {
-                "x86"
-            }
-        ));
-        gn_args.push(format!(
-            "extra_cflags=\"{}\"",
-            if profile == "debug" { "/MDd" } else { "/MD" }
-        ));
-    }
-
     // Create the output directory if it doesn't exist
     fs::create_dir_all(&final_build_dir)?;
 
@@ -199,7 +209,7 @@ pub fn build_crashpad_with_depot(
         .args([
             "gen",
             final_build_dir.to_str().unwrap(),
-            &format!("--args={}", gn_args.join(" ")),
+            &format!("--args={gn_args}"),
         ])
         .current_dir(&crashpad_dir)
         .status()?;
@@ -210,26 +220,28 @@ pub fn build_crashpad_with_depot(
 
     // Run Ninja build - explicitly build library targets
     let ninja = depot_cmd(depot_tools_dir, "ninja");
-    let status = Command::new(&ninja)
-        .args([
-            "-C",
-            final_build_dir.to_str().unwrap(),
-            "client:client",
-            "client:common",
-            "util:util",
-            "third_party/mini_chromium/mini_chromium/base:base",
-            "handler:crashpad_handler",
-        ])
-        .current_dir(&crashpad_dir)
-        .status()?;
+    let mut ninja_cmd = Command::new(&ninja);
+    ninja_cmd.args([
+        "-C",
+        final_build_dir.to_str().unwrap(),
+        "client:client",
+        "client:common",
+        "util:util",
+        "third_party/mini_chromium/mini_chromium/base:base",
+        "handler:crashpad_handler",
+    ]);
+    // WER module for crashes the in-process handler never sees
+    if target.contains("windows") {
+        ninja_cmd.arg("handler/win/wer:crashpad_wer");
+    }
+    let status = ninja_cmd.current_dir(&crashpad_dir).status()?;
 
     if !status.success() {
         return Err("ninja build failed".into());
     }
 
     // Create build completion marker
-    let marker_file = final_build_dir.join(".crashpad-ok");
-    fs::write(&marker_file, "")?;
+    fs::write(&marker_file, &gn_args)?;
 
     Ok(CrashpadBuildOutput {
         build_out_dir: final_build_dir,
@@ -242,16 +254,15 @@ pub fn build_crashpad_with_depot(
 pub fn build_crashpad_sys(
     build_output: &CrashpadBuildOutput,
     target: &str,
+    mut config: BuildConfig,
 ) -> Result<(), Box<dyn std::error::Error>> {
-    use crate::config::BuildConfig;
     use crate::phases::BuildPhases;
 
-    // Create proper config using from_env() to get all platform-specific settings
-    let mut config = BuildConfig::from_env()?;
-
     // Override paths to point to our depot-built Crashpad
     config.crashpad_dir = build_output.crashpad_dir.clone();
 
+    let strip = config.clone();
+
     // Use phases for wrapper compilation, bindgen, and linking
     let phases = BuildPhases::new(config);
 
@@ -263,7 +274,7 @@ pub fn build_crashpad_sys(
     phases.emit_link()?;
 
     // Copy handler to final target directory
-    copy_handler_to_target(&build_output.build_out_dir, target)?;
+    copy_handler_to_target(&build_output.build_out_dir, target, &strip)?;
 
     Ok(())
 }
@@ -272,6 +283,7 @@ pub fn build_crashpad_sys(
 fn copy_handler_to_target(
     build_dir: &Path,
     target: &str,
+    config: &BuildConfig,
 ) -> Result<(), Box<dyn std::error::Error>> {
     // iOS doesn't have external handler
     if target.contains("ios") {
@@ -333,6 +345,7 @@ fn copy_handler_to_target(
         handler_dest.display()
     );
     fs::copy(&handler_src, &handler_dest)?;
+    config.strip_handler_copy(&handler_dest);
 
     // Set executable permissions on Unix
     #[cfg(unix)]
@@ -350,5 +363,39 @@ fn copy_handler_to_target(
     // Expose handler path to dependents via DEP_<links>_HANDLER
     println!("cargo:handler={}", handler_dest.display());
 
+    if target.contains("windows") {
+        copy_wer_module(build_dir, &target_dir)?;
+    }
+
+    Ok(())
+}
+
+/// Copy crashpad_wer.dll next to the handler
+///
+/// Applications register it with `CrashpadClient::register_wer_module` so
+/// WER captures fast-fail and stack overflow crashes out of process.
+pub fn copy_wer_module(
+    build_dir: &Path,
+    target_dir: &Path,
+) -> Result<(), Box<dyn std::error::Error>> {
+    let module_src = build_dir.join("crashpad_wer.dll");
+    if !module_src.exists() {
+        println!(
+            "cargo:warning=crashpad_wer.dll not found at {}, skipping copy",
+            module_src.display()
+        );
+        return Ok(());
+    }
+
+    let module_dest = target_dir.join("crashpad_wer.dll");
+    fs::copy(&module_src, &module_dest)?;
+
+    println!(
+        "cargo:rustc-env=CRASHPAD_WER_MODULE_PATH={}",
+        module_dest.display()
+    );
+    // Expose the module path to dependents via DEP_<links>_WER_MODULE
+    println!("cargo:wer_module={}", module_dest.display());
+
     Ok(())
 }
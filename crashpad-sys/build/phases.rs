@@ -6,6 +6,7 @@ use std::fs;
 use std::path::PathBuf;
 use std::process::Command;
 
+use crate::cache::BuildCache;
 use crate::config::BuildConfig;
 use crate::tools::BinaryToolManager;
 
@@ -15,6 +16,9 @@ pub struct BuildPhases {
     gn_path: Option<PathBuf>,
     #[allow(dead_code)]
     ninja_path: Option<PathBuf>,
+    cache: Option<BuildCache>,
+    // Outputs came from the build cache, GN and Ninja are skipped
+    restored: bool,
 }
 
 impl BuildPhases {
@@ -24,6 +28,8 @@ impl BuildPhases {
             config,
             gn_path: None,
             ninja_path: None,
+            cache: None,
+            restored: false,
         }
     }
 
@@ -50,11 +56,23 @@ impl BuildPhases {
             self.create_dependency_links()?;
         }
 
+        self.cache = BuildCache::new(&self.config);
+        if let Some(cache) = &self.cache {
+            if self.config.verbose {
+                eprintln!("Build cache key: {}", cache.key());
+            }
+            self.restored = cache.restore_outputs(&self.config.build_dir())?;
+        }
+
         Ok(())
     }
 
     /// Phase 2: Configure build with GN
     pub fn configure(&self) -> Result<(), Box<dyn std::error::Error>> {
+        if self.restored {
+            return Ok(());
+        }
+
         let build_dir = self.config.build_dir();
 
         // Windows: Create python3.exe symlink if needed
@@ -64,9 +82,11 @@ impl BuildPhases {
         }
 
         // Create GN args string
-        let gn_args = self
-            .config
-            .gn_args
+        let mut gn_args = self.config.gn_args.clone();
+        if let Some(launcher) = self.toolchain_launcher() {
+            gn_args.insert("cc_wrapper".to_string(), format!("\"{launcher}\""));
+        }
+        let gn_args = gn_args
             .iter()
             .map(|(k, v)| format!("{k} = {v}"))
             .collect::<Vec<_>>()
@@ -118,6 +138,10 @@ impl BuildPhases {
 
     /// Phase 3: Build with Ninja
     pub fn build(&self) -> Result<(), Box<dyn std::error::Error>> {
+        if self.restored {
+            return self.copy_handler_to_target();
+        }
+
         let build_dir = self.config.build_dir();
 
         // Get Ninja path (set in prepare phase)
@@ -167,6 +191,11 @@ impl BuildPhases {
 
             // Add handler executable for non-iOS platforms
             cmd.arg("handler:crashpad_handler");
+
+            // WER module for crashes the in-process handler never sees
+            if self.config.target.contains("windows") {
+                cmd.arg("handler/win/wer:crashpad_wer");
+            }
         }
 
         let output = cmd.output()?;
@@ -184,6 +213,12 @@ impl BuildPhases {
             return Err("Failed to build Crashpad libraries".into());
         }
 
+        if let Some(cache) = &self.cache {
+            if let Err(e) = cache.store_outputs(&build_dir) {
+                println!("cargo:warning=Failed to store Crashpad build in cache: {e}");
+            }
+        }
+
         // Copy crashpad_handler to target directory for easy access
         self.copy_handler_to_target()?;
 
@@ -216,6 +251,9 @@ impl BuildPhases {
             // Windows-specific flags
             build.flag_if_supported("/EHsc");
 
+            // Selects the zlib header in third_party/zlib/zlib_crashpad.h
+            build.define("CRASHPAD_ZLIB_SOURCE_EMBEDDED", None);
+
             // Match the runtime library with what GN is using
             // GN builds with /MDd in debug mode, /MD in release mode
             if self.config.profile == "debug" {
@@ -248,31 +286,59 @@ impl BuildPhases {
 
         // Original code for non-Windows platforms
         let wrapper_obj = self.config.out_dir.join("crashpad_wrapper.o");
-
-        let mut cmd = Command::new(&self.config.compiler);
+        let wrapper_h = self.config.manifest_dir.join("wrapper.h");
 
         // Add compiler flags
-        for flag in &self.config.cxx_flags {
-            cmd.arg(flag);
-        }
+        let mut args = self.config.cxx_flags.clone();
 
         // Add ios-specific defines
         if self.config.target.contains("ios") {
-            cmd.args(["-DTARGET_OS_IOS=1"]);
+            args.push("-DTARGET_OS_IOS=1".to_string());
         }
 
+        // Crashpad uses the system zlib outside Windows
+        args.push("-DCRASHPAD_ZLIB_SOURCE_SYSTEM".to_string());
+
         // Add include paths
-        cmd.args([
-            "-I",
-            self.config.crashpad_dir.to_str().unwrap(),
-            "-I",
+        args.extend([
+            "-I".to_string(),
+            self.config.crashpad_dir.to_str().unwrap().to_string(),
+            "-I".to_string(),
             self.config
                 .crashpad_dir
                 .join("third_party/mini_chromium/mini_chromium")
                 .to_str()
-                .unwrap(),
+                .unwrap()
+                .to_string(),
         ]);
 
+        let cached_obj = match &self.cache {
+            Some(cache) => Some(cache.wrapper_object(
+                &[&wrapper_cc, &wrapper_h],
+                &args,
+                "crashpad_wrapper.o",
+            )?),
+            None => None,
+        };
+        if let Some(cached_obj) = cached_obj.as_ref().filter(|path| path.exists()) {
+            if self.config.verbose {
+                eprintln!("Using cached wrapper from {}", cached_obj.display());
+            }
+            fs::copy(cached_obj, &wrapper_obj)?;
+            return Ok(());
+        }
+
+        let mut cmd = match &self.config.compiler_launcher {
+            Some(launcher) => {
+                let mut cmd = Command::new(launcher);
+                cmd.arg(&self.config.compiler);
+                cmd
+            }
+            None => Command::new(&self.config.compiler),
+        };
+
+        cmd.args(&args);
+
         // Compile to object file
         cmd.args([
             "-c",
@@ -291,6 +357,12 @@ impl BuildPhases {
             return Err("Wrapper object file not created".into());
         }
 
+        if let (Some(cache), Some(cached_obj)) = (&self.cache, &cached_obj) {
+            if let Err(e) = cache.store_wrapper_object(&wrapper_obj, cached_obj) {
+                println!("cargo:warning=Failed to store wrapper in cache: {e}");
+            }
+        }
+
         Ok(())
     }
 
@@ -340,7 +412,7 @@ impl BuildPhases {
 
                 cmd.status()?
             }
-            _ => Command::new("ar")
+            _ => Command::new(&self.config.archiver)
                 .args([
                     "rcs",
                     lib_path.to_str().unwrap(),
@@ -442,6 +514,7 @@ impl BuildPhases {
             obj_dir.join("minidump"),
             obj_dir.join("snapshot"),
             obj_dir.join("handler"),
+            obj_dir.join("third_party/zlib"),
             self.config.out_dir.clone(),
         ];
 
@@ -524,6 +597,42 @@ impl BuildPhases {
         Ok(())
     }
 
+    /// Compiler launcher to hand to the GN toolchain as `cc_wrapper`
+    ///
+    /// Only passed when mini_chromium's toolchain declares the arg; otherwise
+    /// the launcher is used for the wrapper alone.
+    fn toolchain_launcher(&self) -> Option<String> {
+        let launcher = self.config.compiler_launcher.as_ref()?;
+        let toolchain = self
+            .config
+            .crashpad_dir
+            .join("third_party/mini_chromium/mini_chromium/build");
+        if !Self::declares_gn_arg(&toolchain, "cc_wrapper") {
+            if self.config.verbose {
+                eprintln!("GN toolchain has no cc_wrapper arg, launcher used for the wrapper only");
+            }
+            return None;
+        }
+        Some(launcher.to_string_lossy().replace('\\', "/"))
+    }
+
+    /// Whether a .gn/.gni file under `dir` mentions `arg`
+    fn declares_gn_arg(dir: &std::path::Path, arg: &str) -> bool {
+        let Ok(entries) = fs::read_dir(dir) else {
+            return false;
+        };
+        entries.flatten().any(|entry| {
+            let path = entry.path();
+            if path.is_dir() {
+                return Self::declares_gn_arg(&path, arg);
+            }
+            matches!(
+                path.extension().and_then(|ext| ext.to_str()),
+                Some("gn" | "gni")
+            ) && fs::read_to_string(&path).is_ok_and(|content| content.contains(arg))
+        })
+    }
+
     /// Copy crashpad_handler to target directory for consistent access
     fn copy_handler_to_target(&self) -> Result<(), Box<dyn std::error::Error>> {
         // iOS doesn't have external handler
@@ -582,6 +691,8 @@ impl BuildPhases {
         // Copy the handler
         fs::copy(&handler_src, &handler_dest)?;
 
+        self.config.strip_handler_copy(&handler_dest);
+
         // Set executable permissions on Unix
         #[cfg(unix)]
         {
@@ -599,6 +710,10 @@ impl BuildPhases {
         // Expose handler path to dependents via DEP_<links>_HANDLER
         println!("cargo:handler={}", handler_dest.display());
 
+        if self.config.target.contains("windows") {
+            crate::depot_build::copy_wer_module(&build_dir, &target_dir)?;
+        }
+
         Ok(())
     }
 
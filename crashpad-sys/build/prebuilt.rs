@@ -6,6 +6,8 @@ use std::fs;
 use std::io;
 use std::path::{Path, PathBuf};
 
+use sha2::{Digest, Sha256};
+
 /// Download and setup prebuilt binaries
 pub fn download_and_link() -> Result<(), Box<dyn std::error::Error>> {
     let out_dir = PathBuf::from(env::var("OUT_DIR")?);
@@ -21,13 +23,7 @@ pub fn download_and_link() -> Result<(), Box<dyn std::error::Error>> {
     let cache_dir = crate::cache::prebuilt_dir(&version, &target);
     println!("cargo:warning=Cache dir: {}", cache_dir.display());
 
-    let marker_file = cache_dir.join(".crashpad-ok");
-    if !marker_file.exists() {
-        println!("cargo:warning=No marker file, attempting download...");
-        download_prebuilt(&version, &target, &cache_dir)?;
-        fs::write(&marker_file, "")?;
-    }
-
+    let cache_dir = resolve_prebuilt(&version, &target, &cache_dir)?;
     println!(
         "cargo:warning=Using cached prebuilt from: {}",
         cache_dir.display()
@@ -52,39 +48,231 @@ pub fn download_and_link() -> Result<(), Box<dyn std::error::Error>> {
     Ok(())
 }
 
-/// Download from GitHub Releases
-fn download_prebuilt(
+/// Archives at least this large are fetched over several connections
+const PARALLEL_DOWNLOAD_MIN: u64 = 8 * 1024 * 1024;
+
+/// Connections used for a parallel download
+const DOWNLOAD_CONNECTIONS: u64 = 4;
+
+/// Find the extracted prebuilt for `version` and `target`, downloading it
+/// on first use
+///
+/// Archives are verified against their published SHA-256 and kept in the
+/// content-addressed store, extracted once per digest. `cache_dir` only
+/// records which digest belongs to this version and target. A lock file makes
+/// concurrent builds wait for one fetch instead of racing it.
+fn resolve_prebuilt(
     version: &str,
     target: &str,
     cache_dir: &Path,
-) -> Result<(), Box<dyn std::error::Error>> {
-    fs::create_dir_all(cache_dir)?;
+) -> Result<PathBuf, Box<dyn std::error::Error>> {
+    // Caches from before the store extracted straight into cache_dir
+    if cache_dir.join(".crashpad-ok").exists() && !digest_file(cache_dir).exists() {
+        return Ok(cache_dir.to_path_buf());
+    }
+    if let Some(tree) = installed_tree(cache_dir) {
+        return Ok(tree);
+    }
+
+    let _lock = crate::cache::CacheLock::acquire(&cache_dir.join(".lock"))?;
+    // Another build may have finished the fetch while we waited
+    if let Some(tree) = installed_tree(cache_dir) {
+        return Ok(tree);
+    }
 
     let url = format!(
         "https://github.com/bahamoth/crashpad-rs/releases/download/v{}/crashpad-{}-{}.tar.gz",
         version, version, target
     );
+    let digest = expected_digest(&url)?;
+    let tree = fetch_tree(&url, &digest)?;
+    fs::write(digest_file(cache_dir), format!("{digest}\n"))?;
+    Ok(tree)
+}
 
-    println!("cargo:warning=Downloading from: {}", url);
+fn digest_file(cache_dir: &Path) -> PathBuf {
+    cache_dir.join("sha256")
+}
 
-    let response = ureq::get(&url).call().map_err(|e| {
-        println!(
-            "cargo:warning=Note: Prebuilt binaries not available at {}",
-            url
-        );
-        println!("cargo:warning=This is expected if releases haven't been published yet");
-        format!("Failed to download prebuilt: {}", e)
-    })?;
+/// Store tree recorded for `cache_dir`, if it has been extracted
+fn installed_tree(cache_dir: &Path) -> Option<PathBuf> {
+    let digest = fs::read_to_string(digest_file(cache_dir)).ok()?;
+    let tree = crate::cache::store_dir().join("trees").join(digest.trim());
+    tree.is_dir().then_some(tree)
+}
 
-    let temp_file = cache_dir.join("download.tar.gz");
-    let mut file = fs::File::create(&temp_file)?;
-    io::copy(&mut response.into_reader(), &mut file)?;
+/// SHA-256 the archive at `url` must have
+///
+/// CRASHPAD_PREBUILT_SHA256 pins it, e.g. for mirrored archives; otherwise
+/// it is read from the `.sha256` file published next to the archive.
+fn expected_digest(url: &str) -> Result<String, Box<dyn std::error::Error>> {
+    let line = match env::var("CRASHPAD_PREBUILT_SHA256") {
+        Ok(digest) => digest,
+        Err(_) => ureq::get(&format!("{url}.sha256"))
+            .call()
+            .map_err(|e| {
+                println!("cargo:warning=Note: Prebuilt binaries not available at {url}");
+                println!("cargo:warning=This is expected if releases haven't been published yet");
+                format!("Failed to download prebuilt checksum: {e}")
+            })?
+            .into_string()?,
+    };
+
+    let digest = line
+        .split_whitespace()
+        .next()
+        .unwrap_or_default()
+        .to_ascii_lowercase();
+    if digest.len() != 64 || !digest.bytes().all(|b| b.is_ascii_hexdigit()) {
+        return Err(format!("Invalid SHA-256 for prebuilt archive: {line}").into());
+    }
+    Ok(digest)
+}
+
+/// Extracted tree of the archive with `digest`, downloading and extracting
+/// it if the store does not have it yet
+fn fetch_tree(url: &str, digest: &str) -> Result<PathBuf, Box<dyn std::error::Error>> {
+    let store = crate::cache::store_dir();
+    let tree = store.join("trees").join(digest);
+    if tree.is_dir() {
+        return Ok(tree);
+    }
 
-    extract_archive(&temp_file, cache_dir)?;
+    let archive = store.join("archives").join(format!("{digest}.tar.gz"));
+    if !archive.exists() {
+        println!("cargo:warning=Downloading from: {}", url);
+        download_verified(url, digest, &archive)?;
+    }
 
-    fs::remove_file(temp_file)?;
+    let staging = crate::cache::staging_dir(&tree);
+    let _ = fs::remove_dir_all(&staging);
+    fs::create_dir_all(&staging)?;
+    extract_archive(&archive, &staging)?;
+    crate::cache::publish(&staging, &tree)?;
 
-    eprintln!("Downloaded and extracted to: {}", cache_dir.display());
+    eprintln!("Downloaded and extracted to: {}", tree.display());
+    Ok(tree)
+}
+
+/// Download `url` to `archive`, failing unless its SHA-256 is `digest`
+///
+/// Partial downloads are kept under the store's downloads/ directory and
+/// resumed by the next attempt when the server supports ranges.
+fn download_verified(
+    url: &str,
+    digest: &str,
+    archive: &Path,
+) -> Result<(), Box<dyn std::error::Error>> {
+    let downloads = crate::cache::store_dir().join("downloads");
+    fs::create_dir_all(&downloads)?;
+
+    // Ranges are requested from wherever the release URL redirects to
+    let head = ureq::head(url).call().ok();
+    let ranged = head.as_ref().and_then(|head| {
+        let length = head.header("Content-Length")?.parse::<u64>().ok()?;
+        (head.header("Accept-Ranges") == Some("bytes"))
+            .then(|| (head.get_url().to_string(), length))
+    });
+
+    let parts = match &ranged {
+        Some((_, length)) if *length >= PARALLEL_DOWNLOAD_MIN => DOWNLOAD_CONNECTIONS,
+        _ => 1,
+    };
+    let part_path = |index: u64| downloads.join(format!("{digest}.{index}.part"));
+
+    match &ranged {
+        Some((location, length)) => {
+            let chunk = (length + parts - 1) / parts;
+            std::thread::scope(|scope| {
+                let workers: Vec<_> = (0..parts)
+                    .map(|index| {
+                        let start = index * chunk;
+                        let end = (start + chunk).min(*length);
+                        let path = part_path(index);
+                        scope.spawn(move || download_range(location, start, end, &path))
+                    })
+                    .collect();
+                workers
+                    .into_iter()
+                    .try_for_each(|worker| worker.join().expect("download thread panicked"))
+            })?;
+        }
+        None => {
+            let response = ureq::get(url)
+                .call()
+                .map_err(|e| format!("Failed to download prebuilt: {e}"))?;
+            let mut file = fs::File::create(part_path(0))?;
+            io::copy(&mut response.into_reader(), &mut file)?;
+        }
+    }
+
+    // Join the parts while hashing them
+    if let Some(parent) = archive.parent() {
+        fs::create_dir_all(parent)?;
+    }
+    let assembled = crate::cache::staging_dir(archive);
+    let mut hasher = Sha256::new();
+    let mut buffer = vec![0; 64 * 1024];
+    {
+        let mut output = fs::File::create(&assembled)?;
+        for index in 0..parts {
+            let mut input = fs::File::open(part_path(index))?;
+            loop {
+                let read = io::Read::read(&mut input, &mut buffer)?;
+                if read == 0 {
+                    break;
+                }
+                hasher.update(&buffer[..read]);
+                io::Write::write_all(&mut output, &buffer[..read])?;
+            }
+        }
+    }
+    for index in 0..parts {
+        let _ = fs::remove_file(part_path(index));
+    }
+
+    let actual: String = hasher
+        .finalize()
+        .iter()
+        .map(|byte| format!("{byte:02x}"))
+        .collect();
+    if actual != digest {
+        let _ = fs::remove_file(&assembled);
+        return Err(format!("Checksum mismatch for {url}: expected {digest}, got {actual}").into());
+    }
+
+    fs::rename(&assembled, archive)?;
+    Ok(())
+}
+
+/// Download bytes `start..end` of `url` into `path`, resuming from what an
+/// earlier attempt left there
+fn download_range(url: &str, start: u64, end: u64, path: &Path) -> io::Result<()> {
+    let mut have = fs::metadata(path)
+        .map(|metadata| metadata.len())
+        .unwrap_or(0);
+    if have > end - start {
+        fs::remove_file(path)?;
+        have = 0;
+    }
+    if have == end - start {
+        return Ok(());
+    }
+
+    let error = |message: String| io::Error::new(io::ErrorKind::Other, message);
+    let response = ureq::get(url)
+        .set("Range", &format!("bytes={}-{}", start + have, end - 1))
+        .call()
+        .map_err(|e| error(format!("Failed to download prebuilt: {e}")))?;
+    if response.status() != 206 {
+        return Err(error(format!("Server ignored range request for {url}")));
+    }
+
+    let mut file = fs::OpenOptions::new()
+        .create(true)
+        .append(true)
+        .open(path)?;
+    io::copy(&mut response.into_reader(), &mut file)?;
     Ok(())
 }
 
@@ -208,13 +396,16 @@ fn setup_link_flags(cache_dir: &Path, target: &str) -> Result<(), Box<dyn std::e
         println!("cargo:rustc-link-lib=framework=IOKit");
         println!("cargo:rustc-link-lib=dylib=bsm");
         println!("cargo:rustc-link-lib=c++");
+        println!("cargo:rustc-link-lib=z");
     } else if target.contains("android") {
         // Android uses libc++ instead of libstdc++
         println!("cargo:rustc-link-lib=c++_static");
         println!("cargo:rustc-link-lib=c++abi");
+        println!("cargo:rustc-link-lib=z");
     } else {
         println!("cargo:rustc-link-lib=stdc++");
         println!("cargo:rustc-link-lib=pthread");
+        println!("cargo:rustc-link-lib=z");
     }
 
     let handler_path = cache_dir.join(if target.contains("windows") {
@@ -318,5 +509,9 @@ fn copy_handler_to_target(
     // Expose handler path to dependents via DEP_<links>_HANDLER
     println!("cargo:handler={}", handler_dest.display());
     eprintln!("Handler copied to target directory");
+
+    if target.contains("windows") {
+        crate::depot_build::copy_wer_module(cache_dir, &target_dir)?;
+    }
     Ok(())
 }
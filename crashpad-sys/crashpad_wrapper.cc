@@ -1,15 +1,60 @@
 #include "client/crashpad_client.h"
+#include "client/annotation.h"
+#include "client/crash_report_database.h"
+#include "client/crashpad_info.h"
+#include "client/simple_address_range_bag.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
 
 #ifdef _WIN32
 #include "base/strings/utf_string_conversions.h"
 #endif
 
+#include "third_party/zlib/zlib_crashpad.h"
+#include "util/file/file_reader.h"
+#include "util/file/file_writer.h"
+#include "util/file/filesystem.h"
 #include "util/misc/capture_context.h"
+#include "util/misc/uuid.h"
+#include "util/misc/zlib.h"
+
+#if defined(__linux__) || defined(__ANDROID__)
+  #include <dirent.h>
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <pthread.h>
+  #include <sched.h>
+  #include <signal.h>
+  #include <ucontext.h>
+  #include <sys/mman.h>
+  #include <sys/resource.h>
+  #include <sys/socket.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+  #include <cerrno>
+  #include <cstdlib>
+  #include <string>
+  #include "base/posix/eintr_wrapper.h"
+  #include "util/file/file_io.h"
+  #include "util/linux/exception_handler_client.h"
+#endif
 
 // Platform-specific includes for simulate crash
 #if defined(__APPLE__)
   #include <TargetConditionals.h>
+  #include <pthread.h>
+  #include <signal.h>
+  #include <unistd.h>
+  #include <cerrno>
   #if TARGET_OS_IOS
     #include "client/simulate_crash_ios.h"
   #else
@@ -21,18 +66,927 @@
   #include "client/simulate_crash_win.h"
 #endif
 
+#include "wrapper.h"
+
 using namespace crashpad;
 
-extern "C" {
+namespace {
+
+// Build the annotation map expected by the Crashpad start functions
+std::map<std::string, std::string> MakeAnnotations(
+    const char** annotations_keys,
+    const char** annotations_values,
+    size_t annotations_count) {
+    std::map<std::string, std::string> annotations;
+    for (size_t i = 0; i < annotations_count; i++) {
+        annotations[annotations_keys[i]] = annotations_values[i];
+    }
+    return annotations;
+}
+
+// Collect non-null extra handler arguments from the caller
+std::vector<std::string> MakeArguments(
+    const char** extra_arguments,
+    size_t extra_arguments_count) {
+    std::vector<std::string> arguments;
+    if (extra_arguments != nullptr) {
+        for (size_t i = 0; i < extra_arguments_count; i++) {
+            if (extra_arguments[i]) {
+                arguments.push_back(extra_arguments[i]);
+            }
+        }
+    }
+    return arguments;
+}
+
+// Runtime annotation slot over a buffer preallocated at creation
+// The buffer is owned by the slot unless the caller supplies its own.
+// Registered annotations are never unlinked from the AnnotationList, so slots
+// are intentionally never freed.
+struct RuntimeAnnotation {
+    RuntimeAnnotation(const char* name, size_t capacity)
+        : name(name),
+          capacity(capacity),
+          owned_buffer(new char[capacity]),
+          buffer(owned_buffer.get()),
+          annotation(Annotation::Type::kString, this->name.c_str(), buffer) {}
+
+    RuntimeAnnotation(const char* name, char* buffer, size_t capacity)
+        : name(name),
+          capacity(capacity),
+          buffer(buffer),
+          annotation(Annotation::Type::kString, this->name.c_str(), buffer) {}
+
+    const std::string name;
+    const size_t capacity;
+    const std::unique_ptr<char[]> owned_buffer;
+    char* const buffer;
+    Annotation annotation;
+};
+
+// Annotation::SetSize() requires sizes below kValueMaxSize, so a full slot
+// must be too
+bool IsValidAnnotation(const char* name, size_t capacity) {
+    return name && name[0] != '\0' &&
+           strlen(name) < Annotation::kNameMaxLength &&
+           capacity > 0 && capacity < Annotation::kValueMaxSize;
+}
+
+// Extra memory ranges captured in every dump
+// SimpleAddressRangeBag is not thread-safe, so all access goes through the lock.
+std::mutex g_extra_memory_lock;
+
+SimpleAddressRangeBag* ExtraMemoryRanges() {
+    static SimpleAddressRangeBag* ranges = [] {
+        SimpleAddressRangeBag* bag = new SimpleAddressRangeBag();
+        CrashpadInfo::GetCrashpadInfo()->set_extra_memory_ranges(bag);
+        return bag;
+    }();
+    return ranges;
+}
+
+// [begin, end) of process memory
+struct MemoryRange {
+    uintptr_t begin;
+    uintptr_t end;
+
+    bool operator==(const MemoryRange& other) const {
+        return begin == other.begin && end == other.end;
+    }
+    bool Overlaps(const MemoryRange& other) const {
+        return begin < other.end && other.begin < end;
+    }
+};
+
+MemoryRange MakeRange(const void* address, size_t size) {
+    uintptr_t begin = reinterpret_cast<uintptr_t>(address);
+    // Ranges running past the end of the address space are cut short
+    return {begin, begin + std::min<uintptr_t>(size, UINTPTR_MAX - begin)};
+}
+
+// Extra ranges as requested, and the pieces of them outside every exclusion
+// that are registered in the bag. Guarded by g_extra_memory_lock, as are the
+// exclusions.
+std::vector<MemoryRange> g_extra_requested;
+std::vector<MemoryRange> g_extra_registered;
+std::vector<MemoryRange> g_excluded;
+constexpr size_t kMaxExcludedRanges = 256;
+
+bool OverlapsExtraRange(const MemoryRange& range) {
+    return std::any_of(g_extra_requested.begin(), g_extra_requested.end(),
+                       [&range](const MemoryRange& extra) {
+                           return extra.Overlaps(range);
+                       });
+}
+
+// Append the non-empty parts of range outside every exclusion to pieces
+void ClipToExclusions(const MemoryRange& range, std::vector<MemoryRange>* pieces) {
+    std::vector<MemoryRange> remaining{range};
+    for (const MemoryRange& excluded : g_excluded) {
+        std::vector<MemoryRange> clipped;
+        for (const MemoryRange& piece : remaining) {
+            if (!piece.Overlaps(excluded)) {
+                clipped.push_back(piece);
+                continue;
+            }
+            if (piece.begin < excluded.begin) {
+                clipped.push_back({piece.begin, excluded.begin});
+            }
+            if (excluded.end < piece.end) {
+                clipped.push_back({excluded.end, piece.end});
+            }
+        }
+        remaining.swap(clipped);
+    }
+    for (const MemoryRange& piece : remaining) {
+        if (piece.begin < piece.end) {
+            pieces->push_back(piece);
+        }
+    }
+}
+
+// Register the requested extra ranges minus the exclusions in the bag
+// Returns false if the pieces do not all fit; those that do are registered.
+bool SyncExtraMemoryRanges() {
+    SimpleAddressRangeBag* bag = ExtraMemoryRanges();
+    for (const MemoryRange& piece : g_extra_registered) {
+        bag->Remove(reinterpret_cast<void*>(piece.begin), piece.end - piece.begin);
+    }
+    g_extra_registered.clear();
+
+    std::vector<MemoryRange> pieces;
+    for (const MemoryRange& range : g_extra_requested) {
+        ClipToExclusions(range, &pieces);
+    }
+    bool complete = true;
+    for (const MemoryRange& piece : pieces) {
+        if (bag->Insert(reinterpret_cast<void*>(piece.begin), piece.end - piece.begin)) {
+            g_extra_registered.push_back(piece);
+        } else {
+            complete = false;
+        }
+    }
+    return complete;
+}
+
+#if defined(__linux__) || defined(__ANDROID__)
+// Number of exclusions covering each whole page this process marked
+// MADV_DONTDUMP, as a step function: the count at an address is the value of
+// the last key at or below it, and 0 before the first key. Guarded by
+// g_extra_memory_lock.
+std::map<uintptr_t, uint32_t> g_dontdump_pages;
+
+// Make the step function change at address at, keeping the counts
+void SplitDontDumpPages(uintptr_t at) {
+    auto next = g_dontdump_pages.upper_bound(at);
+    uint32_t count = next == g_dontdump_pages.begin() ? 0 : std::prev(next)->second;
+    g_dontdump_pages.emplace(at, count);
+}
+
+// Count the whole pages of range as excluded once more or once less, marking
+// pages left out of kernel core dumps when the first exclusion covers them
+// and back in when the last one goes. Pages this process never marked are
+// left alone, so advice set elsewhere is only overridden where an exclusion
+// covered it. Crashpad reads memory through ptrace and /proc, which ignore
+// the flag.
+void AdviseCoreDump(const MemoryRange& range, bool excluded) {
+    static const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    if (range.begin > UINTPTR_MAX - page_size) {
+        return;
+    }
+    uintptr_t begin = (range.begin + page_size - 1) & ~(page_size - 1);
+    uintptr_t end = range.end & ~(page_size - 1);
+    if (begin >= end) {
+        return;
+    }
+
+    SplitDontDumpPages(begin);
+    SplitDontDumpPages(end);
+    std::vector<MemoryRange> changed;
+    for (auto it = g_dontdump_pages.find(begin); it->first != end; ++it) {
+        bool flips = excluded ? it->second++ == 0 : --it->second == 0;
+        if (!flips) {
+            continue;
+        }
+        uintptr_t run_end = std::next(it)->first;
+        if (!changed.empty() && changed.back().end == it->first) {
+            changed.back().end = run_end;
+        } else {
+            changed.push_back({it->first, run_end});
+        }
+    }
+
+    // Drop steps that no longer change the count
+    auto it = g_dontdump_pages.lower_bound(begin);
+    if (it != g_dontdump_pages.begin()) {
+        --it;
+    }
+    uint32_t previous = 0;
+    if (it != g_dontdump_pages.begin()) {
+        previous = std::prev(it)->second;
+    }
+    while (it != g_dontdump_pages.end() && it->first <= end) {
+        if (it->second == previous) {
+            it = g_dontdump_pages.erase(it);
+        } else {
+            previous = it->second;
+            ++it;
+        }
+    }
+
+    for (const MemoryRange& run : changed) {
+        // Mappings that do not support the flag keep being dumped
+        madvise(reinterpret_cast<void*>(run.begin), run.end - run.begin,
+                excluded ? MADV_DONTDUMP : MADV_DODUMP);
+    }
+}
+#endif
+
+#if defined(__linux__) || defined(__ANDROID__)
+// Apply a per-thread setting to every thread of a process
+// Linux keeps nice values, I/O priorities and affinity per thread, and the
+// handler has spawned its worker threads by the time it accepts clients.
+// Threads that exit while the list is walked are not an error.
+template <typename Apply>
+bool ForEachThread(pid_t pid, Apply apply) {
+    std::string tasks = "/proc/" + std::to_string(pid) + "/task";
+    DIR* dir = opendir(tasks.c_str());
+    if (!dir) {
+        return false;
+    }
+    bool found = false;
+    bool ok = true;
+    while (dirent* entry = readdir(dir)) {
+        char* end = nullptr;
+        long tid = strtol(entry->d_name, &end, 10);
+        if (*end != '\0' || tid <= 0) {
+            continue;
+        }
+        found = true;
+        if (!apply(static_cast<pid_t>(tid)) && errno != ESRCH) {
+            ok = false;
+        }
+    }
+    closedir(dir);
+    return found && ok;
+}
+#endif
+
+// Rewrite a report file in place, gzip-compressing it or restoring the
+// original minidump
+// The result is written next to the report and renamed over it, so readers
+// see either the old or the new file. Returns false if the file was already in
+// the requested form or could not be rewritten.
+bool TranscodeReportFile(const base::FilePath& path, bool compress, int level) {
+    constexpr size_t kChunkSize = 64 * 1024;
+    std::vector<unsigned char> input(kChunkSize);
+    std::vector<unsigned char> output(kChunkSize);
+
+    FileReader reader;
+    if (!reader.Open(path)) {
+        return false;
+    }
+    // Only the gzip magic is read up front, keeping the check cheap for
+    // reports that are already in the requested form
+    FileOperationResult read = reader.Read(input.data(), 2);
+    bool is_gzip = read == 2 && input[0] == 0x1f && input[1] == 0x8b;
+    if (read < 0 || is_gzip == compress) {
+        return false;
+    }
+
+    z_stream stream = {};
+    int window_bits = ZlibWindowBitsWithGzipWrapper(MAX_WBITS);
+    int init = compress ? deflateInit2(&stream, level, Z_DEFLATED, window_bits,
+                                       8, Z_DEFAULT_STRATEGY)
+                        : inflateInit2(&stream, window_bits);
+    if (init != Z_OK) {
+        return false;
+    }
 
-// Opaque handle for CrashpadClient
-typedef void* crashpad_client_t;
+    base::FilePath temp_path(path.value() + FILE_PATH_LITERAL(".tmp"));
+    FileWriter writer;
+    bool ok = writer.Open(temp_path, FileWriteMode::kTruncateOrCreate,
+                          FilePermissions::kOwnerOnly);
+    bool created = ok;
+    bool finished = false;
+    while (ok && !finished) {
+        bool eof = read == 0;
+        if (read < 0 || (eof && !compress)) {
+            // Read error, or a truncated gzip stream
+            ok = false;
+            break;
+        }
+        stream.next_in = input.data();
+        stream.avail_in = static_cast<uInt>(read);
+        do {
+            stream.next_out = output.data();
+            stream.avail_out = static_cast<uInt>(output.size());
+            int result = compress
+                             ? deflate(&stream, eof ? Z_FINISH : Z_NO_FLUSH)
+                             : inflate(&stream, Z_NO_FLUSH);
+            if (result == Z_STREAM_END) {
+                finished = true;
+            } else if (result != Z_OK && result != Z_BUF_ERROR) {
+                ok = false;
+                break;
+            }
+            size_t produced = output.size() - stream.avail_out;
+            if (produced > 0 && !writer.Write(output.data(), produced)) {
+                ok = false;
+                break;
+            }
+        } while (!finished && stream.avail_out == 0);
+        if (ok && !finished) {
+            read = reader.Read(input.data(), input.size());
+        }
+    }
+
+    if (compress) {
+        deflateEnd(&stream);
+    } else {
+        inflateEnd(&stream);
+    }
+    reader.Close();
+    writer.Close();
+
+    ok = ok && MoveFileOrDirectory(temp_path, path);
+    if (!ok && created) {
+        LoggingRemoveFile(temp_path);
+    }
+    return ok;
+}
+
+// Copy at most max_bytes of source to destination, from the start of the file
+// or, with tail_only, from its end, optionally gzip-compressing the copy
+// The file is streamed in chunks, never read whole, and the copy is written
+// next to destination and renamed over it, so the handler never attaches a
+// partial file. Returns the number of bytes taken from source, or -1.
+uint64_t CurrentProcessId() {
+#ifdef _WIN32
+    return GetCurrentProcessId();
+#else
+    return static_cast<uint64_t>(getpid());
+#endif
+}
+
+// Temporary name next to destination, unique to this process and call
+// Processes sharing a database may stage the same destination at once.
+base::FilePath StagingTempPath(const base::FilePath& destination) {
+    static std::atomic<uint64_t> g_staging_counter{0};
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".%llu.%llu.tmp",
+             static_cast<unsigned long long>(CurrentProcessId()),
+             static_cast<unsigned long long>(
+                 g_staging_counter.fetch_add(1, std::memory_order_relaxed)));
+#ifdef _WIN32
+    return base::FilePath(destination.value() + base::UTF8ToWide(suffix));
+#else
+    return base::FilePath(destination.value() + suffix);
+#endif
+}
+
+int64_t StageAttachment(const base::FilePath& source,
+                        const base::FilePath& destination,
+                        uint64_t max_bytes,
+                        bool tail_only,
+                        bool compress) {
+    constexpr size_t kChunkSize = 64 * 1024;
+    std::vector<unsigned char> input(kChunkSize);
+    std::vector<unsigned char> output(kChunkSize);
+
+    FileReader reader;
+    if (!reader.Open(source)) {
+        return -1;
+    }
+    if (tail_only) {
+        FileOffset size = reader.Seek(0, SEEK_END);
+        if (size < 0) {
+            return -1;
+        }
+        FileOffset start = static_cast<uint64_t>(size) > max_bytes
+                               ? size - static_cast<FileOffset>(max_bytes)
+                               : 0;
+        if (reader.Seek(start, SEEK_SET) != start) {
+            return -1;
+        }
+    }
+
+    z_stream stream = {};
+    if (compress &&
+        deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                     ZlibWindowBitsWithGzipWrapper(MAX_WBITS), 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return -1;
+    }
+
+    base::FilePath temp_path = StagingTempPath(destination);
+    FileWriter writer;
+    bool ok = writer.Open(temp_path, FileWriteMode::kTruncateOrCreate,
+                          FilePermissions::kOwnerOnly);
+    bool created = ok;
+    uint64_t copied = 0;
+    bool finished = false;
+    while (ok && !finished) {
+        size_t wanted = static_cast<size_t>(
+            std::min<uint64_t>(input.size(), max_bytes - copied));
+        FileOperationResult read =
+            wanted > 0 ? reader.Read(input.data(), wanted) : 0;
+        if (read < 0) {
+            ok = false;
+            break;
+        }
+        copied += static_cast<uint64_t>(read);
+        bool eof = read == 0;
+        if (!compress) {
+            ok = eof || writer.Write(input.data(), static_cast<size_t>(read));
+            finished = eof;
+            continue;
+        }
+
+        stream.next_in = input.data();
+        stream.avail_in = static_cast<uInt>(read);
+        do {
+            stream.next_out = output.data();
+            stream.avail_out = static_cast<uInt>(output.size());
+            int result = deflate(&stream, eof ? Z_FINISH : Z_NO_FLUSH);
+            if (result == Z_STREAM_END) {
+                finished = true;
+            } else if (result != Z_OK && result != Z_BUF_ERROR) {
+                ok = false;
+                break;
+            }
+            size_t produced = output.size() - stream.avail_out;
+            if (produced > 0 && !writer.Write(output.data(), produced)) {
+                ok = false;
+                break;
+            }
+        } while (!finished && stream.avail_out == 0);
+    }
+
+    if (compress) {
+        deflateEnd(&stream);
+    }
+    reader.Close();
+    writer.Close();
+
+    ok = ok && MoveFileOrDirectory(temp_path, destination);
+    if (!ok && created) {
+        LoggingRemoveFile(temp_path);
+    }
+    return ok ? static_cast<int64_t>(copied) : -1;
+}
+
+base::FilePath MakeFilePath(const char* path) {
+#ifdef _WIN32
+    return base::FilePath(base::UTF8ToWide(path));
+#else
+    return base::FilePath(path);
+#endif
+}
+
+// Build the attachment list expected by the Crashpad start functions
+std::vector<base::FilePath> MakeAttachments(const char** attachments,
+                                            size_t attachments_count) {
+    std::vector<base::FilePath> paths;
+    for (size_t i = 0; i < attachments_count; i++) {
+        paths.push_back(MakeFilePath(attachments[i]));
+    }
+    return paths;
+}
+
+// Transcode the reports named by textual UUID; returns how many were rewritten
+size_t TranscodeReports(
+    CrashReportDatabase* db,
+    const char** uuids,
+    size_t count,
+    bool compress,
+    int level) {
+    size_t rewritten = 0;
+    for (size_t i = 0; i < count; i++) {
+        UUID uuid;
+        CrashReportDatabase::Report report;
+        if (uuids[i] && uuid.InitializeFromString(uuids[i]) &&
+            db->LookUpCrashReport(uuid, &report) == CrashReportDatabase::kNoError &&
+            TranscodeReportFile(report.file_path, compress, level)) {
+            rewritten++;
+        }
+    }
+    return rewritten;
+}
+
+// Monotonic clock for dump phase timings
+uint64_t MonotonicNanos() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+// Dump policy state
+std::atomic<int> g_dump_policy{0};
+std::mutex g_dump_lock;
+std::condition_variable g_dump_done;
+bool g_dump_in_progress = false;
+uint64_t g_dumps_finished = 0;
+
+#ifndef _WIN32
+void LockDumpForFork() {
+    g_dump_lock.lock();
+}
+
+void UnlockDumpAfterFork() {
+    g_dump_lock.unlock();
+}
+
+// Neither the dumping thread nor the waiters exist in a forked child, so the
+// child starts with no dump in flight and a condition variable without the
+// parent's waiters on it
+void ResetDumpInChild() {
+    g_dump_in_progress = false;
+    new (&g_dump_done) std::condition_variable();
+    g_dump_lock.unlock();
+}
+#endif
+
+// Once per process, outside RunDump so every instantiation shares it
+void RegisterDumpForkHandlers() {
+#ifndef _WIN32
+    static const bool fork_handlers_registered =
+        pthread_atfork(LockDumpForFork, UnlockDumpAfterFork,
+                       ResetDumpInChild) == 0;
+    (void)fork_handlers_registered;
+#endif
+}
+
+// Runs dump() under the dump policy and returns a CRASHPAD_DUMP_* outcome.
+// Only one dump is requested at a time: a caller arriving while one is in
+// flight waits for its turn (queue), waits for the in-flight dump and shares
+// it (coalesce), or returns immediately (drop). timing, if set, gets the
+// wait before dump() ran and the time dump() took as request_ns.
+template <typename Dump>
+int RunDump(crashpad_dump_timing_t* timing, Dump dump) {
+    uint64_t start = MonotonicNanos();
+    if (timing) {
+        *timing = {};
+    }
+
+    RegisterDumpForkHandlers();
+    std::unique_lock<std::mutex> lock(g_dump_lock);
+    if (g_dump_in_progress) {
+        int policy = g_dump_policy.load(std::memory_order_relaxed);
+        if (policy == CRASHPAD_DUMP_POLICY_DROP) {
+            return CRASHPAD_DUMP_DROPPED;
+        }
+        if (policy == CRASHPAD_DUMP_POLICY_COALESCE) {
+            // The in-flight dump also captures this thread, so it stands in
+            uint64_t generation = g_dumps_finished;
+            g_dump_done.wait(lock, [generation] {
+                return g_dumps_finished != generation;
+            });
+            if (timing) {
+                timing->wait_ns = MonotonicNanos() - start;
+            }
+            return CRASHPAD_DUMP_COALESCED;
+        }
+        g_dump_done.wait(lock, [] { return !g_dump_in_progress; });
+    }
+    g_dump_in_progress = true;
+    lock.unlock();
+
+    uint64_t began = MonotonicNanos();
+    dump();
+    uint64_t finished = MonotonicNanos();
+
+    lock.lock();
+    g_dump_in_progress = false;
+    g_dumps_finished++;
+    lock.unlock();
+    g_dump_done.notify_all();
+
+    if (timing) {
+        timing->wait_ns = began - start;
+        timing->request_ns = finished - began;
+    }
+    return CRASHPAD_DUMP_TAKEN;
+}
+
+// Request a dump for a context captured earlier, possibly on another thread
+void DumpWithContext(void* context) {
+#ifdef _WIN32
+    CrashpadClient::DumpWithoutCrash(*static_cast<const CONTEXT*>(context));
+#elif defined(__APPLE__)
+  #if TARGET_OS_IOS
+    CrashpadClient::DumpWithoutCrash(static_cast<NativeCPUContext*>(context));
+  #else
+    SimulateCrash(*static_cast<NativeCPUContext*>(context));
+  #endif
+#elif defined(__linux__) || defined(__ANDROID__)
+    CrashpadClient::DumpWithoutCrash(static_cast<NativeCPUContext*>(context));
+#else
+    #error "Unsupported platform for dump without crash"
+#endif
+}
+
+// Stack pointer recorded by CaptureContext, 0 if unknown for this CPU
+uintptr_t ContextStackPointer(const NativeCPUContext& context) {
+#ifdef _WIN32
+  #if defined(_M_X64)
+    return context.Rsp;
+  #elif defined(_M_ARM64)
+    return context.Sp;
+  #elif defined(_M_IX86)
+    return context.Esp;
+  #else
+    return 0;
+  #endif
+#elif defined(__APPLE__)
+  #if defined(__x86_64__)
+    return context.uts.ts64.__rsp;
+  #elif defined(__aarch64__)
+    return arm_thread_state64_get_sp(context.ts_64);
+  #else
+    return 0;
+  #endif
+#elif defined(__x86_64__)
+    return context.uc_mcontext.gregs[REG_RSP];
+#elif defined(__i386__)
+    return context.uc_mcontext.gregs[REG_ESP];
+#elif defined(__aarch64__)
+    return context.uc_mcontext.sp;
+#elif defined(__arm__)
+    return context.uc_mcontext.arm_sp;
+#else
+    return 0;
+#endif
+}
+
+// Lowest and one-past-highest address of the calling thread's stack
+bool CurrentStackBounds(uintptr_t* low, uintptr_t* high) {
+#ifdef _WIN32
+    ULONG_PTR stack_low;
+    ULONG_PTR stack_high;
+    GetCurrentThreadStackLimits(&stack_low, &stack_high);
+    *low = stack_low;
+    *high = stack_high;
+    return true;
+#elif defined(__APPLE__)
+    pthread_t self = pthread_self();
+    *high = reinterpret_cast<uintptr_t>(pthread_get_stackaddr_np(self));
+    *low = *high - pthread_get_stacksize_np(self);
+    return true;
+#else
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+        return false;
+    }
+    void* stack = nullptr;
+    size_t size = 0;
+    int result = pthread_attr_getstack(&attr, &stack, &size);
+    pthread_attr_destroy(&attr);
+    if (result != 0) {
+        return false;
+    }
+    *low = reinterpret_cast<uintptr_t>(stack);
+    *high = *low + size;
+    return true;
+#endif
+}
+
+// Byte copy of live stack memory
+// Stacks hold sanitizer redzones between locals, so the reads must not be
+// instrumented, and volatile keeps them from turning back into memcpy().
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((no_sanitize_address))
+#endif
+void CopyStackMemory(char* to, const volatile char* from, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        to[i] = from[i];
+    }
+}
+
+// OS id of the calling thread, as the minidump thread list reports it
+uint64_t CurrentThreadId() {
+#ifdef _WIN32
+    return GetCurrentThreadId();
+#elif defined(__APPLE__)
+    uint64_t tid = 0;
+    pthread_threadid_np(nullptr, &tid);
+    return tid;
+#else
+    return static_cast<uint64_t>(syscall(SYS_gettid));
+#endif
+}
+
+// Handler health (see crashpad_handler_get_status())
+// Only ever written by the start and attach functions and the monitor
+// thread, so readers get plain atomic loads.
+std::atomic<int> g_handler_state{CRASHPAD_HANDLER_NOT_STARTED};
+std::atomic<uint64_t> g_handler_state_since{0};
+std::atomic<int> g_handler_pid{-1};
+std::atomic<uint64_t> g_handler_starts{0};
+std::atomic<uint64_t> g_handler_start_failures{0};
+std::atomic<uint64_t> g_handler_disconnects{0};
+std::atomic<uint64_t> g_handshake_last_ns{0};
+std::atomic<uint64_t> g_handshake_max_ns{0};
+std::atomic<uint64_t> g_handshake_total_ns{0};
+
+void SetHandlerState(int state) {
+    g_handler_state_since.store(MonotonicNanos(), std::memory_order_relaxed);
+    g_handler_state.store(state, std::memory_order_release);
+}
+
+// Record the outcome of a handler start that began at started
+void RecordHandlerStart(uint64_t started, bool success) {
+    if (!success) {
+        g_handler_start_failures.fetch_add(1, std::memory_order_relaxed);
+        SetHandlerState(CRASHPAD_HANDLER_FAILED);
+        return;
+    }
+
+    uint64_t handshake = MonotonicNanos() - started;
+    g_handshake_last_ns.store(handshake, std::memory_order_relaxed);
+    g_handshake_total_ns.fetch_add(handshake, std::memory_order_relaxed);
+    uint64_t max = g_handshake_max_ns.load(std::memory_order_relaxed);
+    while (handshake > max &&
+           !g_handshake_max_ns.compare_exchange_weak(
+               max, handshake, std::memory_order_relaxed)) {
+    }
+    g_handler_starts.fetch_add(1, std::memory_order_relaxed);
+    SetHandlerState(CRASHPAD_HANDLER_RUNNING);
+}
+
+#if defined(__linux__) || defined(__ANDROID__)
+// Process id of the handler on sock, given what Crashpad recorded
+// Crashpad only asks the handler for its pid when ptrace is restricted, so it
+// may not know it.
+pid_t HandlerPid(int sock, pid_t pid) {
+    if (pid > 0) {
+        return pid;
+    }
+    ucred credentials;
+    ExceptionHandlerClient handler_client(sock, true);
+    if (handler_client.GetHandlerCredentials(&credentials) != 0) {
+        return -1;
+    }
+    return credentials.pid;
+}
+
+// Write end of the pipe that stops the current monitor thread, -1 if none
+std::mutex g_monitor_lock;
+int g_monitor_stop = -1;
+
+// Set in a forked child whose parent was monitoring a running handler
+// The child inherits the connection but not the monitor thread, so the next
+// status query re-arms the monitor on the inherited socket.
+std::atomic<bool> g_monitor_inherited{false};
+
+void LockMonitorForFork() {
+    g_monitor_lock.lock();
+}
+
+void UnlockMonitorAfterFork() {
+    g_monitor_lock.unlock();
+}
+
+// Only async-signal-safe calls until the monitor is re-armed
+void ResetMonitorInChild() {
+    if (g_monitor_stop >= 0) {
+        close(g_monitor_stop);
+        g_monitor_stop = -1;
+        g_monitor_inherited.store(
+            g_handler_state.load(std::memory_order_relaxed) ==
+                CRASHPAD_HANDLER_RUNNING,
+            std::memory_order_relaxed);
+    }
+    g_monitor_lock.unlock();
+}
+
+// Watch the connection to the handler this process uses
+// A detached thread polls a duplicate of the socket for hangup only, so dump
+// traffic never wakes it, and marks the handler lost when it exits or is
+// killed. Replaces the monitor of an earlier connection, whose thread closes
+// its descriptors so an old handler is not kept connected. inherited is set
+// when re-arming in a forked child, which keeps the handler pid it inherited
+// rather than asking the handler over the shared socket.
+void MonitorHandler(bool inherited = false) {
+    static const bool fork_handlers_registered =
+        pthread_atfork(LockMonitorForFork, UnlockMonitorAfterFork,
+                       ResetMonitorInChild) == 0;
+    (void)fork_handlers_registered;
+
+    std::lock_guard<std::mutex> guard(g_monitor_lock);
+    if (g_monitor_stop >= 0) {
+        close(g_monitor_stop);
+        g_monitor_stop = -1;
+    }
+
+    int sock = -1;
+    pid_t pid = -1;
+    if (!CrashpadClient::GetHandlerSocket(&sock, &pid)) {
+        return;
+    }
+    if (!inherited) {
+        g_handler_pid.store(HandlerPid(sock, pid), std::memory_order_relaxed);
+    }
+
+    int watched = fcntl(sock, F_DUPFD_CLOEXEC, 0);
+    if (watched < 0) {
+        return;
+    }
+    int stop[2];
+    if (pipe2(stop, O_CLOEXEC) != 0) {
+        close(watched);
+        return;
+    }
+    g_monitor_stop = stop[1];
+
+    std::thread([watched, stopped = stop[0]] {
+        pollfd fds[2] = {{watched, POLLRDHUP, 0}, {stopped, POLLIN, 0}};
+        int ready;
+        do {
+            ready = poll(fds, 2, -1);
+        } while (ready < 0 && errno == EINTR);
+        if (ready > 0 && fds[1].revents == 0) {
+            g_handler_disconnects.fetch_add(1, std::memory_order_relaxed);
+            g_handler_pid.store(-1, std::memory_order_relaxed);
+            SetHandlerState(CRASHPAD_HANDLER_LOST);
+        }
+        close(watched);
+        close(stopped);
+    }).detach();
+}
+
+// Crashpad takes a bare function pointer, so the user handler is kept here.
+// Crashpad only accepts one once its signal handler is installed, so a
+// handler set earlier is handed over by the start or attach that installs it.
+std::atomic<crashpad_first_chance_handler_t> g_first_chance_handler{nullptr};
+std::atomic<bool> g_signal_handler_installed{false};
+
+bool FirstChanceTrampoline(int signo, siginfo_t* siginfo, ucontext_t* context) {
+    crashpad_first_chance_handler_t handler =
+        g_first_chance_handler.load(std::memory_order_acquire);
+    return handler && handler(signo, siginfo, context);
+}
+
+// Give Crashpad's freshly installed signal handler the first-chance handler
+void InstallFirstChanceHandler() {
+    g_signal_handler_installed.store(true);
+    if (g_first_chance_handler.load()) {
+        CrashpadClient::SetFirstChanceExceptionHandler(FirstChanceTrampoline);
+    }
+}
+#endif
+
+#ifdef _WIN32
+// Threads waiting for asynchronous handler starts, by client
+// Joined when their client is deleted; never destroyed at exit, since a
+// joinable std::thread must not be.
+std::mutex g_start_waiters_lock;
+std::map<CrashpadClient*, std::thread*>* StartWaiters() {
+    static auto* waiters = new std::map<CrashpadClient*, std::thread*>();
+    return waiters;
+}
+
+void JoinStartWaiter(CrashpadClient* client) {
+    std::thread* waiter = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(g_start_waiters_lock);
+        auto it = StartWaiters()->find(client);
+        if (it != StartWaiters()->end()) {
+            waiter = it->second;
+            StartWaiters()->erase(it);
+        }
+    }
+    if (waiter) {
+        waiter->join();
+        delete waiter;
+    }
+}
+
+// Record the handshake of an asynchronous start once it finishes, off the
+// calling thread
+void WaitForHandlerStartInBackground(CrashpadClient* client, uint64_t started) {
+    JoinStartWaiter(client);
+    auto* waiter = new std::thread([client, started] {
+        RecordHandlerStart(started, client->WaitForHandlerStart(INFINITE));
+    });
+    std::lock_guard<std::mutex> guard(g_start_waiters_lock);
+    (*StartWaiters())[client] = waiter;
+}
+#endif
+
+}  // namespace
+
+extern "C" {
 
 crashpad_client_t crashpad_client_new() {
     return new CrashpadClient();
 }
 
 void crashpad_client_delete(crashpad_client_t client) {
+#ifdef _WIN32
+    JoinStartWaiter(static_cast<CrashpadClient*>(client));
+#endif
     delete static_cast<CrashpadClient*>(client);
 }
 
@@ -46,7 +1000,9 @@ bool crashpad_client_start_handler(
     const char** annotations_values,
     size_t annotations_count,
     const char** extra_arguments,
-    size_t extra_arguments_count) {
+    size_t extra_arguments_count,
+    const char** attachments,
+    size_t attachments_count) {
     
     auto* crashpad_client = static_cast<CrashpadClient*>(client);
     
@@ -63,21 +1019,10 @@ bool crashpad_client_start_handler(
     
     std::string url_str(url ? url : "");
     
-    std::map<std::string, std::string> annotations;
-    for (size_t i = 0; i < annotations_count; i++) {
-        annotations[annotations_keys[i]] = annotations_values[i];
-    }
-    
-    std::vector<std::string> arguments;
-    
-    // Add extra arguments from caller
-    if (extra_arguments != nullptr) {
-        for (size_t i = 0; i < extra_arguments_count; i++) {
-            if (extra_arguments[i]) {
-                arguments.push_back(extra_arguments[i]);
-            }
-        }
-    }
+    std::map<std::string, std::string> annotations =
+        MakeAnnotations(annotations_keys, annotations_values, annotations_count);
+    std::vector<std::string> arguments =
+        MakeArguments(extra_arguments, extra_arguments_count);
     
     bool restartable = true;
     // Linux doesn't support asynchronous start
@@ -87,7 +1032,9 @@ bool crashpad_client_start_handler(
     bool asynchronous_start = true;  // Start asynchronously on other platforms
     #endif
     
-    return crashpad_client->StartHandler(
+    uint64_t started = MonotonicNanos();
+    SetHandlerState(CRASHPAD_HANDLER_STARTING);
+    bool success = crashpad_client->StartHandler(
         handler,
         database,
         metrics,
@@ -95,17 +1042,201 @@ bool crashpad_client_start_handler(
         annotations,
         arguments,
         restartable,
-        asynchronous_start
+        asynchronous_start,
+        MakeAttachments(attachments, attachments_count)
     );
+    
+#ifdef _WIN32
+    // The handshake finishes on a Crashpad thread after this returns
+    if (success) {
+        WaitForHandlerStartInBackground(crashpad_client, started);
+        return true;
+    }
+#endif
+    RecordHandlerStart(started, success);
+#if defined(__linux__) || defined(__ANDROID__)
+    if (success) {
+        InstallFirstChanceHandler();
+        MonitorHandler();
+    }
+#endif
+    return success;
 }
 
+#if defined(__linux__) || defined(__ANDROID__)
+bool crashpad_client_start_handler_at_crash(
+    crashpad_client_t client,
+    const char* handler_path,
+    const char* database_path,
+    const char* metrics_path,
+    const char* url,
+    const char** annotations_keys,
+    const char** annotations_values,
+    size_t annotations_count,
+    const char** extra_arguments,
+    size_t extra_arguments_count,
+    const char** attachments,
+    size_t attachments_count) {
+    
+    auto* crashpad_client = static_cast<CrashpadClient*>(client);
+    
+    base::FilePath handler(handler_path);
+    base::FilePath database(database_path);
+    base::FilePath metrics(metrics_path);
+    std::string url_str(url ? url : "");
+    
+    std::map<std::string, std::string> annotations =
+        MakeAnnotations(annotations_keys, annotations_values, annotations_count);
+    std::vector<std::string> arguments =
+        MakeArguments(extra_arguments, extra_arguments_count);
+    
+    // Only installs the signal handlers; the handler process is spawned by
+    // the crashing process itself. StartHandlerWithLinkerAtCrash is not used
+    // because the build does not produce the Android linker trampoline.
+    bool success = crashpad_client->StartHandlerAtCrash(
+        handler,
+        database,
+        metrics,
+        url_str,
+        annotations,
+        arguments,
+        MakeAttachments(attachments, attachments_count)
+    );
+    if (success) {
+        InstallFirstChanceHandler();
+        SetHandlerState(CRASHPAD_HANDLER_ON_DEMAND);
+    } else {
+        g_handler_start_failures.fetch_add(1, std::memory_order_relaxed);
+        SetHandlerState(CRASHPAD_HANDLER_FAILED);
+    }
+    return success;
+}
+
+bool crashpad_client_initialize_signal_stack_for_thread() {
+    return CrashpadClient::InitializeSignalStackForThread();
+}
+
+bool crashpad_client_get_handler_socket(int* sock, int* pid) {
+    pid_t handler_pid = -1;
+    if (!CrashpadClient::GetHandlerSocket(sock, &handler_pid)) {
+        return false;
+    }
+    if (pid) {
+        *pid = handler_pid;
+    }
+    return true;
+}
+
+bool crashpad_client_set_handler_socket(
+    crashpad_client_t client,
+    int sock,
+    int pid) {
+    
+    auto* crashpad_client = static_cast<CrashpadClient*>(client);
+    if (!crashpad_client->SetHandlerSocket(ScopedFileHandle(sock), pid)) {
+        return false;
+    }
+    InstallFirstChanceHandler();
+    SetHandlerState(CRASHPAD_HANDLER_RUNNING);
+    MonitorHandler();
+    return true;
+}
+
+int crashpad_handler_socket_dup_inheritable(int sock) {
+    // dup() never sets FD_CLOEXEC on the new descriptor
+    return HANDLE_EINTR(dup(sock));
+}
+
+int crashpad_client_get_handler_pid() {
+    int sock = -1;
+    pid_t pid = -1;
+    if (!CrashpadClient::GetHandlerSocket(&sock, &pid)) {
+        return -1;
+    }
+    return HandlerPid(sock, pid);
+}
+
+bool crashpad_process_set_nice(int pid, int nice) {
+    return ForEachThread(pid, [nice](pid_t tid) {
+        return setpriority(PRIO_PROCESS, tid, nice) == 0;
+    });
+}
+
+bool crashpad_process_set_io_priority(int pid, int io_class, int io_level) {
+    // From linux/ioprio.h, which not every libc exposes
+    constexpr int kIoprioWhoProcess = 1;
+    constexpr int kIoprioClassShift = 13;
+    int priority = (io_class << kIoprioClassShift) | io_level;
+    return ForEachThread(pid, [priority](pid_t tid) {
+        return syscall(SYS_ioprio_set, kIoprioWhoProcess, tid, priority) == 0;
+    });
+}
+
+bool crashpad_process_set_affinity(int pid, const int* cpus, size_t cpu_count) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < cpu_count; i++) {
+        if (cpus[i] < 0 || cpus[i] >= CPU_SETSIZE) {
+            return false;
+        }
+        CPU_SET(cpus[i], &set);
+    }
+    return cpu_count > 0 && ForEachThread(pid, [&set](pid_t tid) {
+        return sched_setaffinity(tid, sizeof(set), &set) == 0;
+    });
+}
+
+void crashpad_client_set_first_chance_handler(
+    crashpad_first_chance_handler_t handler) {
+    g_first_chance_handler.store(handler);
+    if (g_signal_handler_installed.load()) {
+        CrashpadClient::SetFirstChanceExceptionHandler(
+            handler ? FirstChanceTrampoline : nullptr);
+    }
+}
+
+void* crashpad_siginfo_fault_address(const void* siginfo) {
+    return siginfo ? static_cast<const siginfo_t*>(siginfo)->si_addr : nullptr;
+}
+#endif
+
 #ifdef _WIN32
 bool crashpad_client_set_handler_ipc_pipe(
     crashpad_client_t client,
     const wchar_t* ipc_pipe) {
     
     auto* crashpad_client = static_cast<CrashpadClient*>(client);
-    return crashpad_client->SetHandlerIPCPipe(ipc_pipe);
+    if (!crashpad_client->SetHandlerIPCPipe(ipc_pipe)) {
+        return false;
+    }
+    SetHandlerState(CRASHPAD_HANDLER_RUNNING);
+    return true;
+}
+
+size_t crashpad_client_get_handler_ipc_pipe(
+    crashpad_client_t client,
+    wchar_t* buffer,
+    size_t buffer_len) {
+    
+    auto* crashpad_client = static_cast<CrashpadClient*>(client);
+    std::wstring ipc_pipe = crashpad_client->GetHandlerIPCPipe();
+    
+    if (buffer != nullptr && buffer_len > ipc_pipe.size()) {
+        std::copy(ipc_pipe.begin(), ipc_pipe.end(), buffer);
+        buffer[ipc_pipe.size()] = L'\0';
+    }
+    return ipc_pipe.size();
+}
+
+bool crashpad_client_register_wer_module(
+    crashpad_client_t client,
+    const wchar_t* path) {
+    if (!client || !path) {
+        return false;
+    }
+
+    auto* crashpad_client = static_cast<CrashpadClient*>(client);
+    return crashpad_client->RegisterWerModule(path);
 }
 #endif
 
@@ -115,7 +1246,11 @@ bool crashpad_client_set_handler_mach_service(
     const char* service_name) {
     
     auto* crashpad_client = static_cast<CrashpadClient*>(client);
-    return crashpad_client->SetHandlerMachService(service_name);
+    if (!crashpad_client->SetHandlerMachService(service_name)) {
+        return false;
+    }
+    SetHandlerState(CRASHPAD_HANDLER_RUNNING);
+    return true;
 }
 
 bool crashpad_client_use_system_default_handler(
@@ -134,7 +1269,9 @@ bool crashpad_client_start_in_process_handler(
     const char* url,
     const char** annotations_keys,
     const char** annotations_values,
-    size_t annotations_count) {
+    size_t annotations_count,
+    crashpad_pending_reports_callback_t observer,
+    void* observer_context) {
     
     auto* crashpad_client = static_cast<CrashpadClient*>(client);
     
@@ -142,87 +1279,556 @@ bool crashpad_client_start_in_process_handler(
     base::FilePath database(database_path);
     std::string url_str(url ? url : "");
     
-    std::map<std::string, std::string> annotations;
-    for (size_t i = 0; i < annotations_count; i++) {
-        annotations[annotations_keys[i]] = annotations_values[i];
-    }
+    std::map<std::string, std::string> annotations =
+        MakeAnnotations(annotations_keys, annotations_values, annotations_count);
     
-    // Empty callback for now
     CrashpadClient::ProcessPendingReportsObservationCallback callback;
+    if (observer) {
+        callback = [observer, observer_context]() { observer(observer_context); };
+    }
     
-    return CrashpadClient::StartCrashpadInProcessHandler(
+    uint64_t started = MonotonicNanos();
+    SetHandlerState(CRASHPAD_HANDLER_STARTING);
+    bool success = CrashpadClient::StartCrashpadInProcessHandler(
         database,
         url_str,
         annotations,
         callback
     );
+    RecordHandlerStart(started, success);
+    return success;
 }
 
 void crashpad_client_process_intermediate_dumps() {
     CrashpadClient::ProcessIntermediateDumps();
 }
 
+void crashpad_client_process_intermediate_dump(const char* path) {
+    if (path) {
+        CrashpadClient::ProcessIntermediateDump(base::FilePath(path));
+    }
+}
+
+void crashpad_thread_set_background_qos() {
+    pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+}
+
 void crashpad_client_start_processing_pending_reports() {
     CrashpadClient::StartProcessingPendingReports();
 }
 #endif
 
+void crashpad_handler_get_status(crashpad_handler_status_t* status) {
+    if (!status) {
+        return;
+    }
+#if defined(__linux__) || defined(__ANDROID__)
+    if (g_monitor_inherited.exchange(false)) {
+        MonitorHandler(true);
+    }
+#endif
+    status->state = g_handler_state.load(std::memory_order_acquire);
+    status->pid = g_handler_pid.load(std::memory_order_relaxed);
+    status->starts = g_handler_starts.load(std::memory_order_relaxed);
+    status->start_failures = g_handler_start_failures.load(std::memory_order_relaxed);
+    status->disconnects = g_handler_disconnects.load(std::memory_order_relaxed);
+    status->last_handshake_ns = g_handshake_last_ns.load(std::memory_order_relaxed);
+    status->max_handshake_ns = g_handshake_max_ns.load(std::memory_order_relaxed);
+    status->total_handshake_ns = g_handshake_total_ns.load(std::memory_order_relaxed);
+    uint64_t since = g_handler_state_since.load(std::memory_order_relaxed);
+    status->state_age_ns = since == 0 ? 0 : MonotonicNanos() - since;
+}
+
 // DumpWithoutCrash/SimulateCrash support
 // Note: DumpWithoutCrash is only available on Windows, Linux/Android, and iOS
 // On macOS, we use SimulateCrash instead
-void crashpad_dump_without_crash() {
+void crashpad_set_dump_policy(int policy) {
+    if (policy >= CRASHPAD_DUMP_POLICY_QUEUE && policy <= CRASHPAD_DUMP_POLICY_DROP) {
+        g_dump_policy.store(policy, std::memory_order_relaxed);
+    }
+}
+
+int crashpad_dump_without_crash_timed(crashpad_dump_timing_t* timing) {
+    uint64_t capture_start = 0;
+    uint64_t captured = 0;
+    int outcome = RunDump(timing, [&capture_start, &captured]() {
+        capture_start = MonotonicNanos();
 #ifdef _WIN32
-    // Windows has DumpWithoutCrash
-    CONTEXT context;
-    CaptureContext(&context);
-    CrashpadClient::DumpWithoutCrash(context);
+        // Windows has DumpWithoutCrash
+        CONTEXT context;
+        CaptureContext(&context);
+        captured = MonotonicNanos();
+        CrashpadClient::DumpWithoutCrash(context);
 #elif defined(__APPLE__)
   #if TARGET_OS_IOS
-    // iOS has DumpWithoutCrash
-    NativeCPUContext context;
-    CaptureContext(&context);
-    CrashpadClient::DumpWithoutCrash(&context);
+        // iOS has DumpWithoutCrash
+        NativeCPUContext context;
+        CaptureContext(&context);
+        captured = MonotonicNanos();
+        CrashpadClient::DumpWithoutCrash(&context);
   #else
-    // macOS uses SimulateCrash instead of DumpWithoutCrash
-    NativeCPUContext context;
-    CaptureContext(&context);
-    SimulateCrash(context);
+        // macOS uses SimulateCrash instead of DumpWithoutCrash
+        NativeCPUContext context;
+        CaptureContext(&context);
+        captured = MonotonicNanos();
+        SimulateCrash(context);
   #endif
 #elif defined(__linux__) || defined(__ANDROID__)
-    // Linux and Android have DumpWithoutCrash
-    NativeCPUContext context;
-    CaptureContext(&context);
-    CrashpadClient::DumpWithoutCrash(&context);
+        // Linux and Android have DumpWithoutCrash
+        NativeCPUContext context;
+        CaptureContext(&context);
+        captured = MonotonicNanos();
+        CrashpadClient::DumpWithoutCrash(&context);
 #else
     #error "Unsupported platform for dump without crash"
 #endif
+    });
+    if (timing && outcome == CRASHPAD_DUMP_TAKEN) {
+        // RunDump timed capture and request together
+        timing->capture_ns = captured - capture_start;
+        timing->request_ns -= timing->capture_ns;
+    }
+    return outcome;
+}
+
+void crashpad_dump_without_crash() {
+    crashpad_dump_without_crash_timed(nullptr);
 }
 
 // Alternative that allows passing a pre-captured context
+int crashpad_dump_without_crash_with_context_timed(
+    void* context,
+    crashpad_dump_timing_t* timing) {
+    return RunDump(timing, [context]() { DumpWithContext(context); });
+}
+
+int crashpad_dump_without_crash_with_context(void* context) {
+    return crashpad_dump_without_crash_with_context_timed(context, nullptr);
+}
+
+int crashpad_dump_without_crash_with_stack_timed(
+    void* context,
+    const void* stack,
+    const crashpad_stack_copy_t* copy,
+    crashpad_dump_timing_t* timing) {
+    return RunDump(timing, [context, stack, copy]() {
+        // RunDump runs one dump at a time, so one slot serves them all
+        static RuntimeAnnotation* const slot =
+            new RuntimeAnnotation(CRASHPAD_STACK_COPY_ANNOTATION, 128);
+
+        bool added = copy->size > 0 &&
+                     crashpad_add_extra_memory_range(stack, copy->size);
+        int length;
+        if (added) {
+            length = snprintf(slot->buffer, slot->capacity,
+                              "tid=%llu sp=0x%llx copy=0x%llx size=%llu",
+                              static_cast<unsigned long long>(copy->thread_id),
+                              static_cast<unsigned long long>(copy->stack_address),
+                              static_cast<unsigned long long>(
+                                  reinterpret_cast<uintptr_t>(stack)),
+                              static_cast<unsigned long long>(copy->size));
+        } else {
+            length = snprintf(slot->buffer, slot->capacity, "tid=%llu",
+                              static_cast<unsigned long long>(copy->thread_id));
+        }
+        slot->annotation.SetSize(static_cast<Annotation::ValueSizeType>(
+            std::min(static_cast<size_t>(length), slot->capacity - 1)));
+
+        DumpWithContext(context);
+
+        slot->annotation.Clear();
+        if (added) {
+            crashpad_remove_extra_memory_range(stack, copy->size);
+        }
+    });
+}
+
+// Context capture for deferred dumps
+size_t crashpad_cpu_context_size() {
+    return sizeof(NativeCPUContext);
+}
+
+void crashpad_capture_context(void* context) {
+    CaptureContext(static_cast<NativeCPUContext*>(context));
+}
+
+bool crashpad_capture_stack(
+    const void* context,
+    void* buffer,
+    size_t capacity,
+    crashpad_stack_copy_t* copy) {
+    copy->thread_id = CurrentThreadId();
+    copy->stack_address = 0;
+    copy->size = 0;
+
+    uintptr_t sp =
+        ContextStackPointer(*static_cast<const NativeCPUContext*>(context));
+    uintptr_t low = 0;
+    uintptr_t high = 0;
+    // Also refuses contexts captured on an alternate signal stack
+    if (!CurrentStackBounds(&low, &high) || sp < low || sp >= high) {
+        return false;
+    }
+
+    // Innermost frames first, so the cap drops the outermost ones
+    size_t size = static_cast<size_t>(std::min<uintptr_t>(high - sp, capacity));
+    CopyStackMemory(static_cast<char*>(buffer),
+                    reinterpret_cast<const volatile char*>(sp), size);
+    copy->stack_address = sp;
+    copy->size = size;
+    return true;
+}
+
+// Runtime annotations
+crashpad_annotation_t crashpad_annotation_new(const char* name, size_t capacity) {
+    if (!IsValidAnnotation(name, capacity)) {
+        return nullptr;
+    }
+    return new RuntimeAnnotation(name, capacity);
+}
+
+crashpad_annotation_t crashpad_annotation_register(
+    const char* name,
+    void* buffer,
+    size_t capacity) {
+    if (!buffer || !IsValidAnnotation(name, capacity)) {
+        return nullptr;
+    }
+    return new RuntimeAnnotation(name, static_cast<char*>(buffer), capacity);
+}
+
+void crashpad_annotation_set(
+    crashpad_annotation_t annotation,
+    const char* value,
+    size_t value_len) {
+    RuntimeAnnotation* slot = static_cast<RuntimeAnnotation*>(annotation);
+    size_t size = std::min(value_len, slot->capacity);
+    memcpy(slot->buffer, value, size);
+    // The first non-empty value links the slot into the AnnotationList
+    slot->annotation.SetSize(static_cast<Annotation::ValueSizeType>(size));
+}
+
+void crashpad_annotation_set_size(crashpad_annotation_t annotation, size_t size) {
+    RuntimeAnnotation* slot = static_cast<RuntimeAnnotation*>(annotation);
+    slot->annotation.SetSize(
+        static_cast<Annotation::ValueSizeType>(std::min(size, slot->capacity)));
+}
+
+void crashpad_annotation_clear(crashpad_annotation_t annotation) {
+    static_cast<RuntimeAnnotation*>(annotation)->annotation.Clear();
+}
+
+size_t crashpad_annotation_max_value_size() {
+    return Annotation::kValueMaxSize - 1;
+}
+
+// Dump contents
+void crashpad_info_set_gather_indirectly_referenced_memory(
+    bool enabled,
+    uint32_t limit) {
+    CrashpadInfo::GetCrashpadInfo()->set_gather_indirectly_referenced_memory(
+        enabled ? TriState::kEnabled : TriState::kDisabled, limit);
+}
+
+void crashpad_info_set_system_crash_reporter_forwarding(bool enabled) {
+    CrashpadInfo::GetCrashpadInfo()->set_system_crash_reporter_forwarding(
+        enabled ? TriState::kEnabled : TriState::kDisabled);
+}
+
+// Extra memory ranges
+bool crashpad_add_extra_memory_range(const void* address, size_t size) {
+    std::lock_guard<std::mutex> lock(g_extra_memory_lock);
+    g_extra_requested.push_back(MakeRange(address, size));
+    if (!SyncExtraMemoryRanges()) {
+        g_extra_requested.pop_back();
+        SyncExtraMemoryRanges();
+        return false;
+    }
+    return true;
+}
+
+bool crashpad_remove_extra_memory_range(const void* address, size_t size) {
+    std::lock_guard<std::mutex> lock(g_extra_memory_lock);
+    auto it = std::find(g_extra_requested.begin(), g_extra_requested.end(),
+                        MakeRange(address, size));
+    if (it == g_extra_requested.end()) {
+        return false;
+    }
+    g_extra_requested.erase(it);
+    SyncExtraMemoryRanges();
+    return true;
+}
+
+bool crashpad_exclude_memory_range(const void* address, size_t size) {
+    if (size == 0) {
+        return false;
+    }
+    MemoryRange range = MakeRange(address, size);
+
+    std::lock_guard<std::mutex> lock(g_extra_memory_lock);
+    if (g_excluded.size() >= kMaxExcludedRanges) {
+        return false;
+    }
+    g_excluded.push_back(range);
+    if (OverlapsExtraRange(range)) {
+        // Removing pieces only frees bag entries, so this cannot fail
+        SyncExtraMemoryRanges();
+    }
+#if defined(__linux__) || defined(__ANDROID__)
+    AdviseCoreDump(range, true);
+#endif
+    return true;
+}
+
+bool crashpad_remove_excluded_memory_range(const void* address, size_t size) {
+    MemoryRange range = MakeRange(address, size);
+
+    std::lock_guard<std::mutex> lock(g_extra_memory_lock);
+    auto it = std::find(g_excluded.begin(), g_excluded.end(), range);
+    if (it == g_excluded.end()) {
+        return false;
+    }
+    g_excluded.erase(it);
+    if (OverlapsExtraRange(range)) {
+        // Pieces that no longer fit stay out of dumps
+        SyncExtraMemoryRanges();
+    }
+#if defined(__linux__) || defined(__ANDROID__)
+    AdviseCoreDump(range, false);
+#endif
+    return true;
+}
+
+// Crash report database
+crashpad_database_t crashpad_database_open(const char* path) {
+    if (!path) {
+        return nullptr;
+    }
 #ifdef _WIN32
-void crashpad_dump_without_crash_with_context(const void* context) {
-    const CONTEXT* ctx = static_cast<const CONTEXT*>(context);
-    CrashpadClient::DumpWithoutCrash(*ctx);
+    base::FilePath database_path(base::UTF8ToWide(path));
+#else
+    base::FilePath database_path(path);
+#endif
+    return CrashReportDatabase::Initialize(database_path).release();
 }
-#elif defined(__APPLE__)
-  #if TARGET_OS_IOS
-void crashpad_dump_without_crash_with_context(void* context) {
-    NativeCPUContext* ctx = static_cast<NativeCPUContext*>(context);
-    CrashpadClient::DumpWithoutCrash(ctx);
+
+void crashpad_database_close(crashpad_database_t database) {
+    delete static_cast<CrashReportDatabase*>(database);
 }
-  #else
-void crashpad_dump_without_crash_with_context(void* context) {
-    NativeCPUContext* ctx = static_cast<NativeCPUContext*>(context);
-    SimulateCrash(*ctx);
+
+bool crashpad_database_list_reports(
+    crashpad_database_t database,
+    int sets,
+    crashpad_report_info_t** reports,
+    size_t* count) {
+    *reports = nullptr;
+    *count = 0;
+    auto* db = static_cast<CrashReportDatabase*>(database);
+
+    std::vector<CrashReportDatabase::Report> pending;
+    std::vector<CrashReportDatabase::Report> completed;
+    if ((sets & CRASHPAD_REPORTS_PENDING) &&
+        db->GetPendingReports(&pending) != CrashReportDatabase::kNoError) {
+        return false;
+    }
+    if ((sets & CRASHPAD_REPORTS_COMPLETED) &&
+        db->GetCompletedReports(&completed) != CrashReportDatabase::kNoError) {
+        return false;
+    }
+
+    size_t total = pending.size() + completed.size();
+    if (total == 0) {
+        return true;
+    }
+
+    crashpad_report_info_t* out = new crashpad_report_info_t[total];
+    size_t index = 0;
+    auto pack = [&](const CrashReportDatabase::Report& report, bool is_pending) {
+        crashpad_report_info_t& info = out[index++];
+        std::string uuid = report.uuid.ToString();
+        memset(info.uuid, 0, sizeof(info.uuid));
+        memcpy(info.uuid, uuid.data(), std::min(uuid.size(), sizeof(info.uuid) - 1));
+        info.pending = is_pending;
+        info.uploaded = report.uploaded;
+        info.upload_explicitly_requested = report.upload_explicitly_requested;
+        info.upload_attempts = report.upload_attempts;
+        info.creation_time = report.creation_time;
+        info.last_upload_attempt_time = report.last_upload_attempt_time;
+        info.total_size = report.total_size;
+    };
+    for (const auto& report : pending) {
+        pack(report, true);
+    }
+    for (const auto& report : completed) {
+        pack(report, false);
+    }
+
+    *reports = out;
+    *count = total;
+    return true;
 }
-  #endif
-#elif defined(__linux__) || defined(__ANDROID__)
-void crashpad_dump_without_crash_with_context(void* context) {
-    NativeCPUContext* ctx = static_cast<NativeCPUContext*>(context);
-    CrashpadClient::DumpWithoutCrash(ctx);
+
+void crashpad_report_list_free(crashpad_report_info_t* reports) {
+    delete[] reports;
+}
+
+bool crashpad_database_get_counters(
+    crashpad_database_t database,
+    crashpad_database_counters_t* counters) {
+    *counters = {};
+    auto* db = static_cast<CrashReportDatabase*>(database);
+
+    std::vector<CrashReportDatabase::Report> pending;
+    std::vector<CrashReportDatabase::Report> completed;
+    if (db->GetPendingReports(&pending) != CrashReportDatabase::kNoError ||
+        db->GetCompletedReports(&completed) != CrashReportDatabase::kNoError) {
+        return false;
+    }
+
+    auto count = [counters](const CrashReportDatabase::Report& report) {
+        counters->upload_attempts += std::max(report.upload_attempts, 0);
+        counters->total_size += report.total_size;
+        counters->last_upload_attempt_time = std::max<int64_t>(
+            counters->last_upload_attempt_time, report.last_upload_attempt_time);
+    };
+    for (const auto& report : pending) {
+        counters->pending++;
+        if (report.upload_explicitly_requested) {
+            counters->upload_requested++;
+        }
+        count(report);
+    }
+    for (const auto& report : completed) {
+        counters->completed++;
+        if (report.uploaded) {
+            counters->uploaded++;
+        } else if (report.upload_attempts > 0) {
+            counters->upload_failed++;
+        } else {
+            counters->upload_skipped++;
+        }
+        count(report);
+    }
+
+    // The settings also remember attempts for reports since deleted
+    Settings* settings = db->GetSettings();
+    if (settings) {
+        time_t last_attempt = 0;
+        if (settings->GetLastUploadAttemptTime(&last_attempt)) {
+            counters->last_upload_attempt_time = std::max<int64_t>(
+                counters->last_upload_attempt_time, last_attempt);
+        }
+        bool enabled = false;
+        if (settings->GetUploadsEnabled(&enabled)) {
+            counters->uploads_enabled = enabled;
+        }
+    }
+    return true;
+}
+
+size_t crashpad_database_delete_reports(
+    crashpad_database_t database,
+    const char** uuids,
+    size_t count) {
+    auto* db = static_cast<CrashReportDatabase*>(database);
+    size_t deleted = 0;
+    for (size_t i = 0; i < count; i++) {
+        UUID uuid;
+        if (uuids[i] && uuid.InitializeFromString(uuids[i]) &&
+            db->DeleteReport(uuid) == CrashReportDatabase::kNoError) {
+            deleted++;
+        }
+    }
+    return deleted;
+}
+
+bool crashpad_database_set_uploads_enabled(
+    crashpad_database_t database,
+    bool enabled) {
+    Settings* settings = static_cast<CrashReportDatabase*>(database)->GetSettings();
+    return settings && settings->SetUploadsEnabled(enabled);
 }
+
+size_t crashpad_database_request_uploads(
+    crashpad_database_t database,
+    const char** uuids,
+    size_t count) {
+    auto* db = static_cast<CrashReportDatabase*>(database);
+    size_t requested = 0;
+    for (size_t i = 0; i < count; i++) {
+        UUID uuid;
+        if (uuids[i] && uuid.InitializeFromString(uuids[i]) &&
+            db->RequestUpload(uuid) == CrashReportDatabase::kNoError) {
+            requested++;
+        }
+    }
+    return requested;
+}
+
+size_t crashpad_database_compress_reports(
+    crashpad_database_t database,
+    const char** uuids,
+    size_t count,
+    int level) {
+    if (level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION) {
+        return 0;
+    }
+    return TranscodeReports(static_cast<CrashReportDatabase*>(database),
+                            uuids, count, true, level);
+}
+
+size_t crashpad_database_decompress_reports(
+    crashpad_database_t database,
+    const char** uuids,
+    size_t count) {
+    return TranscodeReports(static_cast<CrashReportDatabase*>(database),
+                            uuids, count, false, Z_DEFAULT_COMPRESSION);
+}
+
+bool crashpad_attachments_supported() {
+#if defined(__APPLE__) && TARGET_OS_IOS
+    // The in-process handler has no attachment support
+    return false;
 #else
-    #error "Unsupported platform for dump without crash"
+    // Windows, macOS, Linux and Android handlers take --attachment
+    return true;
 #endif
+}
+
+bool crashpad_process_exists(int64_t pid) {
+#ifdef _WIN32
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE,
+                                 static_cast<DWORD>(pid));
+    if (!process) {
+        // Running, but owned by someone else
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    }
+    DWORD exit_code = 0;
+    bool running = GetExitCodeProcess(process, &exit_code) &&
+                   exit_code == STILL_ACTIVE;
+    CloseHandle(process);
+    return running;
+#else
+    if (pid <= 0) {
+        return false;
+    }
+    return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+#endif
+}
+
+int64_t crashpad_stage_attachment(
+    const char* source,
+    const char* destination,
+    uint64_t max_bytes,
+    bool tail_only,
+    bool compress) {
+    return StageAttachment(MakeFilePath(source), MakeFilePath(destination),
+                           max_bytes, tail_only, compress);
+}
+
+int crashpad_database_clean(crashpad_database_t database, int64_t lockfile_ttl) {
+    return static_cast<CrashReportDatabase*>(database)->CleanDatabase(
+        static_cast<time_t>(lockfile_ttl));
+}
 
 } // extern "C"
\ No newline at end of file
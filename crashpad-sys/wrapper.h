@@ -5,6 +5,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,6 +21,8 @@ crashpad_client_t crashpad_client_new();
 void crashpad_client_delete(crashpad_client_t client);
 
 // Start the Crashpad handler
+// attachments are files the handler copies into every report, see
+// crashpad_stage_attachment(); pass 0 where attachments are unsupported.
 bool crashpad_client_start_handler(
     crashpad_client_t client,
     const char* handler_path,
@@ -30,13 +33,109 @@ bool crashpad_client_start_handler(
     const char** annotations_values,
     size_t annotations_count,
     const char** extra_arguments,
-    size_t extra_arguments_count);
+    size_t extra_arguments_count,
+    const char** attachments,
+    size_t attachments_count);
+
+// Start the Crashpad handler lazily (Linux/Android only)
+// Installs the crash signal handlers without spawning a handler process.
+// The handler is launched from the crashing process only when a crash or
+// dump request actually happens, so idle processes carry no handler.
+#if defined(__linux__) || defined(__ANDROID__)
+bool crashpad_client_start_handler_at_crash(
+    crashpad_client_t client,
+    const char* handler_path,
+    const char* database_path,
+    const char* metrics_path,
+    const char* url,
+    const char** annotations_keys,
+    const char** annotations_values,
+    size_t annotations_count,
+    const char** extra_arguments,
+    size_t extra_arguments_count,
+    const char** attachments,
+    size_t attachments_count);
+
+// Set up the alternate signal stack for the calling thread (Linux/Android only)
+// Crashpad does this for the thread that starts the handler; other threads
+// need it to report crashes caused by stack overflow.
+bool crashpad_client_initialize_signal_stack_for_thread();
+
+// Get the connection to the handler started by this process (Linux/Android only)
+// The socket remains owned by Crashpad. Returns false if no handler is running.
+bool crashpad_client_get_handler_socket(int* sock, int* pid);
+
+// Attach to an already running handler (Linux/Android only)
+// Takes ownership of sock. pid is the handler's process id, or -1 to query it
+// from the handler over the socket. No handler process is spawned.
+bool crashpad_client_set_handler_socket(
+    crashpad_client_t client,
+    int sock,
+    int pid);
+
+// Duplicate a handler socket without close-on-exec (Linux/Android only)
+// The returned descriptor survives exec so a child process can attach to the
+// handler. Returns -1 on failure.
+int crashpad_handler_socket_dup_inheritable(int sock);
+
+// Process id of the handler this process is connected to (Linux/Android only)
+// Asks the handler when Crashpad did not record it. Returns -1 if no handler
+// is connected.
+int crashpad_client_get_handler_pid();
+
+// Set the nice value of every thread of a process (Linux/Android only)
+bool crashpad_process_set_nice(int pid, int nice);
+
+// Set the I/O scheduling class and level of every thread of a process, as
+// with ioprio_set(2) (Linux/Android only)
+bool crashpad_process_set_io_priority(int pid, int io_class, int io_level);
+
+// Restrict every thread of a process to the given CPUs (Linux/Android only)
+bool crashpad_process_set_affinity(int pid, const int* cpus, size_t cpu_count);
+
+// First-chance signal handler (Linux/Android only)
+// Runs inside Crashpad's signal handler before a dump is requested. siginfo
+// points to the signal's siginfo_t and context to its ucontext_t. Returning
+// true means the signal was handled: execution resumes and the handler is not
+// contacted. Must be async-signal-safe.
+typedef bool (*crashpad_first_chance_handler_t)(
+    int signo,
+    void* siginfo,
+    void* context);
+
+// Install or, with NULL, remove the first-chance handler (Linux/Android only)
+// May be called before a handler is started or attached: the handler is kept
+// and takes effect once a start or attach installs Crashpad's signal handler.
+void crashpad_client_set_first_chance_handler(
+    crashpad_first_chance_handler_t handler);
+
+// Faulting address (si_addr) of a siginfo_t (Linux/Android only)
+void* crashpad_siginfo_fault_address(const void* siginfo);
+#endif
 
 // Set handler IPC pipe (for Windows)
 #ifdef _WIN32
 bool crashpad_client_set_handler_ipc_pipe(
     crashpad_client_t client,
     const wchar_t* ipc_pipe);
+
+// Get the IPC pipe name of the handler this client is connected to (Windows)
+// Copies at most buffer_len wide characters including the terminator and
+// returns the length of the name without terminator (0 if not connected).
+// Call with buffer_len = 0 to query the required size.
+size_t crashpad_client_get_handler_ipc_pipe(
+    crashpad_client_t client,
+    wchar_t* buffer,
+    size_t buffer_len);
+
+// Register crashpad_wer.dll at `path` as a WER runtime exception module so
+// fast-fail and stack overflow crashes are captured by WER out of process
+// (Windows only). Call after the handler has started or the IPC pipe is set.
+// The DLL must also be listed under the RuntimeExceptionHelperModules
+// registry key for WER to load it.
+bool crashpad_client_register_wer_module(
+    crashpad_client_t client,
+    const wchar_t* path);
 #endif
 
 // Platform-specific functions for macOS/iOS
@@ -52,29 +151,366 @@ bool crashpad_client_use_system_default_handler(
 
 // iOS-specific in-process handler functions
 #if defined(TARGET_OS_IOS) && TARGET_OS_IOS
+// Called on Crashpad's upload thread after each pass over pending reports
+typedef void (*crashpad_pending_reports_callback_t)(void* context);
+
+// observer may be NULL; observer_context must outlive the process
 bool crashpad_client_start_in_process_handler(
     crashpad_client_t client,
     const char* database_path,
     const char* url,
     const char** annotations_keys,
     const char** annotations_values,
-    size_t annotations_count);
+    size_t annotations_count,
+    crashpad_pending_reports_callback_t observer,
+    void* observer_context);
 
 void crashpad_client_process_intermediate_dumps();
 
+// Convert a single intermediate dump file into a minidump
+void crashpad_client_process_intermediate_dump(const char* path);
+
+// Move the calling thread to the background QoS class
+void crashpad_thread_set_background_qos();
+
 void crashpad_client_start_processing_pending_reports();
 #endif
 #endif
 
+// Handler health
+// Kept by the start and attach functions and, on Linux/Android, by a monitor
+// thread that wakes only when the handler closes its connection. Reading it
+// never blocks or talks to the handler.
+#define CRASHPAD_HANDLER_NOT_STARTED 0  // No handler started or attached
+#define CRASHPAD_HANDLER_STARTING 1     // Launched, handshake not finished
+#define CRASHPAD_HANDLER_RUNNING 2      // Connected to a running handler
+#define CRASHPAD_HANDLER_ON_DEMAND 3    // Launched at crash time (Linux/Android)
+#define CRASHPAD_HANDLER_LOST 4         // Handler closed the connection
+#define CRASHPAD_HANDLER_FAILED 5       // The last start failed
+
+typedef struct {
+    int state;                     // CRASHPAD_HANDLER_*
+    int pid;                       // Handler process id, -1 if unknown
+    uint64_t starts;               // Launches that finished the handshake
+    uint64_t start_failures;
+    uint64_t disconnects;          // Times the handler closed the connection
+    uint64_t last_handshake_ns;    // Launch until the handler accepted
+    uint64_t max_handshake_ns;
+    uint64_t total_handshake_ns;   // Sum over all starts
+    uint64_t state_age_ns;         // Time since the state last changed
+} crashpad_handler_status_t;
+
+// Copy the cached handler health into status
+// In a child forked while the handler was running, the first call also starts
+// watching the inherited connection (Linux/Android).
+void crashpad_handler_get_status(crashpad_handler_status_t* status);
+
 // DumpWithoutCrash support - capture a dump without crashing the process
 // This is useful for diagnostic purposes when you want to capture the current
 // state without terminating the application
 void crashpad_dump_without_crash();
 
+// Policy for a dump requested while another thread's dump is in flight.
+// Only one dump is requested from the handler at a time.
+#define CRASHPAD_DUMP_POLICY_QUEUE 0     // Wait, then take a dump of its own
+#define CRASHPAD_DUMP_POLICY_COALESCE 1  // Wait for the in-flight dump and share it
+#define CRASHPAD_DUMP_POLICY_DROP 2      // Return immediately without a dump
+
+// Process-wide; CRASHPAD_DUMP_POLICY_QUEUE until set
+void crashpad_set_dump_policy(int policy);
+
+// Outcome of a dump request
+#define CRASHPAD_DUMP_TAKEN 0      // A dump was written for this request
+#define CRASHPAD_DUMP_COALESCED 1  // Another thread's dump covered this request
+#define CRASHPAD_DUMP_DROPPED 2    // Another dump was in flight, nothing written
+
+// Phase timings of one dump, in nanoseconds of a monotonic clock
+typedef struct {
+    uint64_t wait_ns;     // Waiting for another thread's dump to finish
+    uint64_t capture_ns;  // CaptureContext in the calling thread
+    uint64_t request_ns;  // Handler round trip until the minidump is written
+} crashpad_dump_timing_t;
+
+// Same as crashpad_dump_without_crash(), also filling in timing
+// Returns a CRASHPAD_DUMP_* outcome
+int crashpad_dump_without_crash_timed(crashpad_dump_timing_t* timing);
+
 // Alternative that allows passing a pre-captured context
 // On Windows: context should be a pointer to CONTEXT structure
 // On other platforms: context should be a pointer to NativeCPUContext
-void crashpad_dump_without_crash_with_context(void* context);
+// Returns a CRASHPAD_DUMP_* outcome
+int crashpad_dump_without_crash_with_context(void* context);
+
+// Same as crashpad_dump_without_crash_with_context(), also filling in timing
+// (capture_ns is always 0)
+int crashpad_dump_without_crash_with_context_timed(void* context,
+                                                   crashpad_dump_timing_t* timing);
+
+// Context capture for deferred dumps
+// Capture the caller's context with crashpad_capture_context() and pass it to
+// crashpad_dump_without_crash_with_context() later, possibly from another
+// thread. The dump names the thread that requests it, so the exception record
+// pairs the captured registers with the requesting thread's id, and the
+// capturing thread's stack is read wherever it is when the dump runs. To keep
+// the stack as it was, also copy it with crashpad_capture_stack() and dump
+// with crashpad_dump_without_crash_with_stack_timed().
+
+// Size in bytes of the native CPU context (CONTEXT on Windows)
+// Buffers must be at least this large and 16-byte aligned.
+size_t crashpad_cpu_context_size();
+
+// Capture the calling thread's CPU context into context
+void crashpad_capture_context(void* context);
+
+// Copy of a thread's stack taken by crashpad_capture_stack()
+typedef struct {
+    uint64_t thread_id;      // OS id of the thread the stack belongs to
+    uint64_t stack_address;  // Address the first copied byte was read from
+    size_t size;             // Bytes copied, 0 if nothing was
+} crashpad_stack_copy_t;
+
+// Annotation naming the stack copy in a dump from
+// crashpad_dump_without_crash_with_stack_timed(), with the value
+// "tid=<id> sp=0x<stack_address> copy=0x<buffer> size=<bytes>", or just
+// "tid=<id>" when no copy was recorded. The copy is an extra memory range at
+// <buffer>; tools map it back onto the thread's stack at <stack_address>.
+#define CRASHPAD_STACK_COPY_ANNOTATION "crashpad_stack_copy"
+
+// Copy the calling thread's stack into buffer
+// Copies from the stack pointer in context, which the calling thread must
+// have captured with crashpad_capture_context(), up to the top of its stack,
+// at most capacity bytes. The innermost frames come first, so a short buffer
+// drops the outermost ones. copy->thread_id is always set; returns false with
+// copy->size 0 if the stack bounds are unknown or the context's stack pointer
+// is outside them (e.g. on an alternate signal stack).
+bool crashpad_capture_stack(
+    const void* context,
+    void* buffer,
+    size_t capacity,
+    crashpad_stack_copy_t* copy);
+
+// Same as crashpad_dump_without_crash_with_context_timed(), and records a
+// stack copy from crashpad_capture_stack() in that dump
+// For this dump only, the first copy->size bytes of stack are an extra memory
+// range and CRASHPAD_STACK_COPY_ANNOTATION describes them. A request that is
+// coalesced or dropped records nothing.
+int crashpad_dump_without_crash_with_stack_timed(
+    void* context,
+    const void* stack,
+    const crashpad_stack_copy_t* copy,
+    crashpad_dump_timing_t* timing);
+
+// Runtime annotations
+// Slots are backed by crashpad::Annotation and read by the handler directly
+// from process memory at crash time, so values can change at any point.
+
+// Opaque handle for a runtime annotation slot
+typedef void* crashpad_annotation_t;
+
+// Create a string annotation slot holding up to capacity bytes
+// The value buffer is allocated once here. Slots live until process exit.
+// Returns NULL if the name is empty or too long, or capacity is 0 or larger
+// than crashpad_annotation_max_value_size().
+crashpad_annotation_t crashpad_annotation_new(const char* name, size_t capacity);
+
+// Create a string annotation slot over a caller-owned buffer
+// buffer must stay valid and in place until process exit (e.g. a static).
+// The caller writes the value into buffer and then publishes its length with
+// crashpad_annotation_set_size(). Same validation as crashpad_annotation_new().
+crashpad_annotation_t crashpad_annotation_register(
+    const char* name,
+    void* buffer,
+    size_t capacity);
+
+// Replace the slot's value
+// Copies at most capacity bytes; never allocates or locks. Concurrent writers
+// to the same slot may leave a mix of both values.
+void crashpad_annotation_set(
+    crashpad_annotation_t annotation,
+    const char* value,
+    size_t value_len);
+
+// Publish the first size bytes of the slot's buffer as its value
+// size is clamped to the slot's capacity.
+void crashpad_annotation_set_size(crashpad_annotation_t annotation, size_t size);
+
+// Drop the slot's value from future crash reports
+void crashpad_annotation_clear(crashpad_annotation_t annotation);
+
+// Largest value a single annotation can hold, one byte below
+// crashpad::Annotation::kValueMaxSize
+size_t crashpad_annotation_max_value_size();
+
+// Dump contents
+// These settings live in this process's CrashpadInfo and are read by the
+// handler at crash time, so they can be changed at any point.
+
+// Capture heap memory referenced from thread stacks, up to limit bytes in total
+void crashpad_info_set_gather_indirectly_referenced_memory(
+    bool enabled,
+    uint32_t limit);
+
+// Let the system crash reporter also handle crashes (macOS ReportCrash,
+// Windows WER)
+void crashpad_info_set_system_crash_reporter_forwarding(bool enabled);
+
+// Extra memory ranges
+// Registered ranges are copied into every dump taken of this process. At most
+// 64 ranges can be registered at once.
+
+// Include [address, address + size) in crash dumps
+// Returns false if the range table is full.
+bool crashpad_add_extra_memory_range(const void* address, size_t size);
+
+// Stop including a range added with crashpad_add_extra_memory_range()
+// Returns false if the range was not registered.
+bool crashpad_remove_extra_memory_range(const void* address, size_t size);
+
+// Excluded memory ranges
+// Memory that crash dumps need not carry, such as caches, tensor buffers and
+// allocator arenas. An exclusion covers only two things: the parts of extra
+// memory ranges inside it are not registered, and on Linux/Android whole pages
+// inside it are marked MADV_DONTDUMP for kernel core dumps while any exclusion
+// covers them. Removing the last exclusion over a page marks it MADV_DODUMP
+// again; other pages are never advised. What Crashpad captures itself is not
+// affected: the handler has no exclusion hook, so thread stacks are captured
+// in full, and indirectly referenced memory is gathered from stack values and
+// can still reach excluded memory, bounded by its limit. At most 256 ranges
+// can be excluded at once.
+
+// Leave [address, address + size) out of crash dumps
+// Cheap enough to call for every arena an allocator maps: takes a lock and
+// makes one madvise() call per run of pages not already excluded. Returns
+// false if size is 0 or the exclusion table is full.
+bool crashpad_exclude_memory_range(const void* address, size_t size);
+
+// Drop an exclusion added with crashpad_exclude_memory_range()
+// Returns false if the range was not excluded.
+bool crashpad_remove_excluded_memory_range(const void* address, size_t size);
+
+// Crash report database
+// Reports can be listed and deleted while a handler is using the database.
+
+// Opaque handle for CrashReportDatabase
+typedef void* crashpad_database_t;
+
+// Open the database at path, creating it if needed. Returns NULL on failure.
+crashpad_database_t crashpad_database_open(const char* path);
+
+// Close a database opened with crashpad_database_open()
+void crashpad_database_close(crashpad_database_t database);
+
+// Report sets for crashpad_database_list_reports()
+#define CRASHPAD_REPORTS_PENDING 1
+#define CRASHPAD_REPORTS_COMPLETED 2
+
+// Metadata of one report
+typedef struct {
+    char uuid[37];                     // Textual UUID, NUL-terminated
+    bool pending;                      // Not yet uploaded or given up on
+    bool uploaded;
+    bool upload_explicitly_requested;
+    int32_t upload_attempts;
+    int64_t creation_time;             // Seconds since the epoch
+    int64_t last_upload_attempt_time;  // Seconds since the epoch, 0 if never
+    uint64_t total_size;               // Bytes on disk including attachments
+} crashpad_report_info_t;
+
+// List reports in the sets selected by the CRASHPAD_REPORTS_* mask
+// Stores a packed array in *reports and its length in *count, all in one
+// call. Free the array with crashpad_report_list_free(). *reports is NULL
+// when there are no reports.
+bool crashpad_database_list_reports(
+    crashpad_database_t database,
+    int sets,
+    crashpad_report_info_t** reports,
+    size_t* count);
+
+// Free an array returned by crashpad_database_list_reports()
+void crashpad_report_list_free(crashpad_report_info_t* reports);
+
+// Aggregate counters over every report in a database
+typedef struct {
+    uint64_t pending;            // Waiting for upload
+    uint64_t completed;          // Uploaded or given up on
+    uint64_t uploaded;
+    uint64_t upload_requested;   // Pending and explicitly requested
+    uint64_t upload_failed;      // Completed after failed upload attempts
+    uint64_t upload_skipped;     // Completed without any upload attempt
+    uint64_t upload_attempts;    // Sum over all reports
+    uint64_t total_size;         // Bytes on disk including attachments
+    int64_t last_upload_attempt_time;  // Seconds since the epoch, 0 if never
+    bool uploads_enabled;
+} crashpad_database_counters_t;
+
+// Compute counters without copying per-report metadata to the caller
+bool crashpad_database_get_counters(
+    crashpad_database_t database,
+    crashpad_database_counters_t* counters);
+
+// Delete reports by textual UUID; returns the number deleted
+size_t crashpad_database_delete_reports(
+    crashpad_database_t database,
+    const char** uuids,
+    size_t count);
+
+// Enable or disable automatic uploads by the handler
+// While disabled, the handler moves new reports to the completed set without
+// uploading them; crashpad_database_request_uploads() can release them later.
+bool crashpad_database_set_uploads_enabled(
+    crashpad_database_t database,
+    bool enabled);
+
+// Mark reports (by textual UUID) for upload even while uploads are disabled
+// The handler uploads them on its next pass over pending reports. Returns the
+// number of reports marked.
+size_t crashpad_database_request_uploads(
+    crashpad_database_t database,
+    const char** uuids,
+    size_t count);
+
+// Whether a process with this id is running, e.g. to clean up after
+// processes that have exited
+// Processes of other users count as running.
+bool crashpad_process_exists(int64_t pid);
+
+// Whether the handler supports report attachments on this platform
+// (Windows, macOS, Linux and Android; not iOS)
+bool crashpad_attachments_supported();
+
+// Copy at most max_bytes of source to destination for use as an attachment,
+// from the start of source or, with tail_only, from its end, and gzip the
+// copy if compress is set
+// The copy is streamed to a temporary file unique to this call and renamed
+// into place once complete. Returns the number of bytes taken from source, or
+// -1 on failure.
+int64_t crashpad_stage_attachment(
+    const char* source,
+    const char* destination,
+    uint64_t max_bytes,
+    bool tail_only,
+    bool compress);
+
+// Gzip-compress the minidumps of reports (by textual UUID) in place
+// level is a zlib level from 0 to 9, or -1 for the default. Only reports the
+// handler will not upload should be compressed: the handler reads the minidump
+// before uploading it. Returns the number of reports compressed.
+size_t crashpad_database_compress_reports(
+    crashpad_database_t database,
+    const char** uuids,
+    size_t count,
+    int level);
+
+// Restore the minidumps of reports compressed with
+// crashpad_database_compress_reports(); returns the number restored
+size_t crashpad_database_decompress_reports(
+    crashpad_database_t database,
+    const char** uuids,
+    size_t count);
+
+// Remove orphaned files and stale locks older than lockfile_ttl seconds
+// Returns the number of files removed.
+int crashpad_database_clean(crashpad_database_t database, int64_t lockfile_ttl);
 
 #ifdef __cplusplus
 }
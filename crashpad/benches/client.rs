@@ -0,0 +1,255 @@
+//! Client hot path benchmarks
+//!
+//! Measures handler start latency across annotation counts,
+//! `dump_without_crash` latency across thread counts and heap sizes, and the
+//! cost of a `handler_status` probe. The
+//! handler is looked up from `CRASHPAD_HANDLER`, then next to the bench
+//! executable's profile directory (`target/release/`); without one every
+//! benchmark is skipped.
+//!
+//! Run through `cargo xtask bench`, which also collects the results into one
+//! JSON file. When `CRASHPAD_BENCH_OUT` is set, the size of the handler and
+//! of this executable, which links the Crashpad libraries, is written to
+//! `binary_size.json` in that directory, and the idle handler's resident set
+//! size to `handler_rss.json` (Linux and Android only).
+
+use std::collections::HashMap;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Barrier};
+use std::thread::{self, JoinHandle};
+use std::time::Duration;
+
+use crashpad_rs::{CrashpadClient, CrashpadConfig};
+use criterion::{black_box, criterion_group, BenchmarkId, Criterion};
+use tempfile::TempDir;
+
+const ANNOTATION_COUNTS: [usize; 3] = [0, 16, 128];
+const THREAD_COUNTS: [usize; 3] = [1, 8, 64];
+const HEAP_MIB: [usize; 3] = [0, 64, 512];
+
+fn find_handler() -> Option<PathBuf> {
+    if let Some(path) = std::env::var_os("CRASHPAD_HANDLER") {
+        return Some(PathBuf::from(path));
+    }
+
+    let name = if cfg!(windows) {
+        "crashpad_handler.exe"
+    } else {
+        "crashpad_handler"
+    };
+    // Benches run from target/<profile>/deps/
+    let exe = std::env::current_exe().ok()?;
+    let path = exe.parent()?.parent()?.join(name);
+    path.exists().then_some(path)
+}
+
+fn config(handler: &Path, dir: &TempDir) -> CrashpadConfig {
+    CrashpadConfig::builder()
+        .handler_path(handler)
+        .database_path(dir.path().join("crashpad_db"))
+        .metrics_path(dir.path().join("crashpad_metrics"))
+        .build()
+}
+
+fn annotations(count: usize) -> HashMap<String, String> {
+    (0..count)
+        .map(|i| (format!("key_{i}"), format!("value_{i}_{}", "x".repeat(32))))
+        .collect()
+}
+
+/// A client with a running handler, shared by the dump benchmarks
+struct Running {
+    client: CrashpadClient,
+    dir: TempDir,
+}
+
+fn start(handler: &Path) -> Running {
+    let running = Running {
+        client: CrashpadClient::new().expect("client"),
+        dir: TempDir::new().expect("temp dir"),
+    };
+    running
+        .client
+        .start_with_config(&config(handler, &running.dir), &HashMap::new())
+        .expect("handler should start");
+    running
+}
+
+/// Threads parked until dropped, so dumps have their stacks to capture
+struct ParkedThreads {
+    release: Arc<Barrier>,
+    threads: Vec<JoinHandle<()>>,
+}
+
+impl ParkedThreads {
+    fn spawn(count: usize) -> Self {
+        let release = Arc::new(Barrier::new(count + 1));
+        let threads = (0..count)
+            .map(|_| {
+                let release = Arc::clone(&release);
+                thread::spawn(move || {
+                    release.wait();
+                })
+            })
+            .collect();
+        ParkedThreads { release, threads }
+    }
+}
+
+impl Drop for ParkedThreads {
+    fn drop(&mut self) {
+        self.release.wait();
+        for thread in self.threads.drain(..) {
+            let _ = thread.join();
+        }
+    }
+}
+
+fn bench_start(c: &mut Criterion) {
+    let Some(handler) = find_handler() else {
+        eprintln!("crashpad_handler not found, skipping start benchmarks");
+        return;
+    };
+
+    let mut group = c.benchmark_group("start_with_config");
+    // Every iteration spawns a handler process
+    group.sample_size(10);
+    group.measurement_time(Duration::from_secs(20));
+    for count in ANNOTATION_COUNTS {
+        let annotations = annotations(count);
+        group.bench_with_input(
+            BenchmarkId::new("annotations", count),
+            &annotations,
+            |b, annotations| {
+                let dir = TempDir::new().expect("temp dir");
+                let config = config(&handler, &dir);
+                b.iter(|| {
+                    let client = CrashpadClient::new().expect("client");
+                    client
+                        .start_with_config(&config, annotations)
+                        .expect("handler should start");
+                    black_box(client)
+                });
+            },
+        );
+    }
+    group.finish();
+}
+
+fn bench_dump(c: &mut Criterion) {
+    let Some(handler) = find_handler() else {
+        eprintln!("crashpad_handler not found, skipping dump benchmarks");
+        return;
+    };
+    let running = start(&handler);
+
+    let mut group = c.benchmark_group("dump_without_crash");
+    group.sample_size(20);
+    for count in THREAD_COUNTS {
+        let _threads = ParkedThreads::spawn(count.saturating_sub(1));
+        group.bench_function(BenchmarkId::new("threads", count), |b| {
+            b.iter(|| running.client.dump_without_crash());
+        });
+    }
+    for mib in HEAP_MIB {
+        // Touch every page so it is resident and mapped
+        let heap = vec![1u8; mib * 1024 * 1024];
+        group.bench_function(BenchmarkId::new("heap_mib", mib), |b| {
+            b.iter(|| running.client.dump_without_crash());
+        });
+        black_box(&heap);
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("handler_status");
+    group.bench_function("probe", |b| {
+        b.iter(|| running.client.handler_status());
+    });
+    group.finish();
+}
+
+/// Writes the handler and bench executable sizes to `CRASHPAD_BENCH_OUT`
+fn record_binary_sizes() {
+    let Some(out_dir) = std::env::var_os("CRASHPAD_BENCH_OUT").map(PathBuf::from) else {
+        return;
+    };
+    let size = |path: Option<PathBuf>| {
+        path.and_then(|path| std::fs::metadata(path).ok())
+            .map_or("null".to_string(), |metadata| metadata.len().to_string())
+    };
+    let handler_bytes = size(find_handler());
+    let bench_bytes = size(std::env::current_exe().ok());
+
+    let json = format!("{{\"handler_bytes\": {handler_bytes}, \"bench_bytes\": {bench_bytes}}}\n");
+    if std::fs::create_dir_all(&out_dir).is_ok() {
+        let _ = std::fs::write(out_dir.join("binary_size.json"), json);
+    }
+    println!("handler: {handler_bytes} bytes, bench executable: {bench_bytes} bytes");
+}
+
+/// Writes the resident set size of an idle handler to `CRASHPAD_BENCH_OUT`
+#[cfg(any(target_os = "linux", target_os = "android"))]
+fn record_idle_handler_rss() {
+    let Some(out_dir) = std::env::var_os("CRASHPAD_BENCH_OUT").map(PathBuf::from) else {
+        return;
+    };
+    let Some(handler) = find_handler() else {
+        return;
+    };
+
+    let running = start(&handler);
+    // Let the handler finish its startup work
+    thread::sleep(Duration::from_secs(1));
+
+    let Some(status) = handler_status(&running) else {
+        return;
+    };
+    let field = |name: &str| {
+        status
+            .lines()
+            .find_map(|line| line.strip_prefix(name))
+            .and_then(|rest| rest.split_whitespace().next())
+            .and_then(|kib| kib.parse::<u64>().ok())
+    };
+    let (Some(rss_kib), Some(hwm_kib)) = (field("VmRSS:"), field("VmHWM:")) else {
+        return;
+    };
+
+    let json = format!("{{\"rss_kib\": {rss_kib}, \"peak_rss_kib\": {hwm_kib}}}\n");
+    if std::fs::create_dir_all(&out_dir).is_ok() {
+        let _ = std::fs::write(out_dir.join("handler_rss.json"), json);
+    }
+    println!("idle handler RSS: {rss_kib} KiB (peak {hwm_kib} KiB)");
+}
+
+/// `/proc/<pid>/status` of the handler serving `running`
+///
+/// The handler is double-forked and Crashpad does not always know its pid,
+/// so it is found by the database path on its command line.
+#[cfg(any(target_os = "linux", target_os = "android"))]
+fn handler_status(running: &Running) -> Option<String> {
+    let database = running.dir.path().join("crashpad_db");
+    let needle = format!("--database={}", database.display());
+    std::fs::read_dir("/proc")
+        .ok()?
+        .flatten()
+        .find_map(|entry| {
+            let cmdline = std::fs::read(entry.path().join("cmdline")).ok()?;
+            cmdline
+                .split(|&byte| byte == 0)
+                .any(|arg| arg == needle.as_bytes())
+                .then(|| std::fs::read_to_string(entry.path().join("status")).ok())?
+        })
+}
+
+#[cfg(not(any(target_os = "linux", target_os = "android")))]
+fn record_idle_handler_rss() {}
+
+criterion_group!(benches, bench_start, bench_dump);
+
+fn main() {
+    record_binary_sizes();
+    record_idle_handler_rss();
+    benches();
+    Criterion::default().configure_from_args().final_summary();
+}
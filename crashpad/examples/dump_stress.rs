@@ -0,0 +1,382 @@
+//! Concurrent dump stress harness
+//!
+//! Fires `dump_without_crash` from many threads at once and reports
+//! throughput, per-call latency and lost reports, i.e. dumps that returned
+//! `Dumped` but never showed up in the database. With `--crash`, a child
+//! process runs the same load and crashes halfway through, to check that
+//! crashes racing non-fatal dumps are reported.
+//!
+//! ```text
+//! cargo run --example dump_stress -- --threads 64 --dumps 4 --policy coalesce
+//! cargo run --example dump_stress -- --threads 8 --dumps 8 --crash
+//! ```
+//!
+//! The handler is found through `CRASHPAD_HANDLER` or next to the example's
+//! profile directory. The last line of output is a JSON summary.
+
+// Android standalone executables need pthread_atfork, see crashpad_test_cli
+#[cfg(target_os = "android")]
+#[no_mangle]
+pub extern "C" fn pthread_atfork(
+    _prepare: Option<extern "C" fn()>,
+    _parent: Option<extern "C" fn()>,
+    _child: Option<extern "C" fn()>,
+) -> i32 {
+    0
+}
+
+use crashpad_rs::{CrashDatabase, CrashpadClient, CrashpadConfig, DumpOutcome, DumpPolicy};
+use std::collections::HashMap;
+use std::env;
+use std::io::{BufRead, BufReader, Write};
+use std::path::PathBuf;
+use std::process::{self, Command, Stdio};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Arc, Barrier};
+use std::thread;
+use std::time::{Duration, Instant};
+
+const EXIT_USAGE: i32 = 1;
+const EXIT_HANDLER_FAILED: i32 = 2;
+const EXIT_LOST_REPORTS: i32 = 3;
+
+/// Line the crashing child prints for every written dump
+const DUMPED_LINE: &str = "dumped";
+
+/// How long to wait for the handler to finish writing reports
+const SETTLE_TIMEOUT: Duration = Duration::from_secs(30);
+
+struct Options {
+    threads: usize,
+    dumps: usize,
+    policy: DumpPolicy,
+    crash: bool,
+    child: bool,
+}
+
+fn usage() -> ! {
+    eprintln!(
+        "usage: dump_stress [--threads N] [--dumps M] [--policy queue|coalesce|drop] [--crash]"
+    );
+    process::exit(EXIT_USAGE);
+}
+
+fn parse_options() -> Options {
+    let mut options = Options {
+        threads: 8,
+        dumps: 4,
+        policy: DumpPolicy::Queue,
+        crash: false,
+        child: false,
+    };
+
+    let mut args = env::args().skip(1);
+    while let Some(arg) = args.next() {
+        let mut value = || args.next().unwrap_or_else(|| usage());
+        match arg.as_str() {
+            "--threads" => options.threads = value().parse().unwrap_or_else(|_| usage()),
+            "--dumps" => options.dumps = value().parse().unwrap_or_else(|_| usage()),
+            "--policy" => {
+                options.policy = match value().as_str() {
+                    "queue" => DumpPolicy::Queue,
+                    "coalesce" => DumpPolicy::Coalesce,
+                    "drop" => DumpPolicy::Drop,
+                    _ => usage(),
+                }
+            }
+            "--crash" => options.crash = true,
+            "--child" => options.child = true,
+            _ => usage(),
+        }
+    }
+    if options.threads == 0 {
+        usage();
+    }
+    options
+}
+
+fn handler_path() -> PathBuf {
+    if let Some(path) = env::var_os("CRASHPAD_HANDLER") {
+        return PathBuf::from(path);
+    }
+
+    let exe_path = env::current_exe().expect("current executable");
+    let exe_dir = exe_path.parent().unwrap();
+    if cfg!(target_os = "android") {
+        return exe_dir.join("libcrashpad_handler.so");
+    }
+    let handler_name = if cfg!(windows) {
+        "crashpad_handler.exe"
+    } else {
+        "crashpad_handler"
+    };
+    // Examples are in target/<profile>/examples/, the handler one level up
+    if exe_dir.file_name() == Some(std::ffi::OsStr::new("examples")) {
+        exe_dir.parent().unwrap().join(handler_name)
+    } else {
+        exe_dir.join(handler_name)
+    }
+}
+
+fn database_path() -> PathBuf {
+    let exe_path = env::current_exe().expect("current executable");
+    exe_path.parent().unwrap().join("dump_stress_db")
+}
+
+fn start_client(options: &Options) -> CrashpadClient {
+    let client = CrashpadClient::new().unwrap_or_else(|e| {
+        eprintln!("✗ Failed to create Crashpad client: {e}");
+        process::exit(EXIT_HANDLER_FAILED);
+    });
+    let database = database_path();
+    let config = CrashpadConfig::builder()
+        .handler_path(handler_path())
+        .database_path(&database)
+        .metrics_path(database.with_file_name("dump_stress_metrics"))
+        .dump_policy(options.policy)
+        .build();
+
+    let mut annotations = HashMap::new();
+    annotations.insert("tool".to_string(), "dump_stress".to_string());
+    if let Err(e) = client.start_with_config(&config, &annotations) {
+        eprintln!("✗ Failed to start handler: {e}");
+        process::exit(EXIT_HANDLER_FAILED);
+    }
+    client
+}
+
+/// Outcome and latency of every dump call
+#[derive(Default)]
+struct Samples {
+    latencies: Vec<Duration>,
+    dumped: usize,
+    coalesced: usize,
+    dropped: usize,
+}
+
+impl Samples {
+    fn add(&mut self, latency: Duration, outcome: DumpOutcome) {
+        self.latencies.push(latency);
+        match outcome {
+            DumpOutcome::Dumped => self.dumped += 1,
+            DumpOutcome::Coalesced => self.coalesced += 1,
+            DumpOutcome::Dropped => self.dropped += 1,
+        }
+    }
+
+    fn merge(&mut self, other: Samples) {
+        self.latencies.extend(other.latencies);
+        self.dumped += other.dumped;
+        self.coalesced += other.coalesced;
+        self.dropped += other.dropped;
+    }
+
+    fn percentile(&self, percent: usize) -> Duration {
+        let mut sorted = self.latencies.clone();
+        sorted.sort();
+        match sorted.len() {
+            0 => Duration::ZERO,
+            len => sorted[(len * percent / 100).min(len - 1)],
+        }
+    }
+}
+
+/// Runs `options.dumps` dumps on each of `options.threads` threads, released
+/// together. `on_dumped` runs after every written dump; when `crash_after` is
+/// set, the process crashes once that many calls have returned.
+fn run_load(
+    client: &Arc<CrashpadClient>,
+    options: &Options,
+    crash_after: Option<usize>,
+    on_dumped: fn(),
+) -> (Samples, Duration) {
+    let start = Arc::new(Barrier::new(options.threads + 1));
+    let returned = Arc::new(AtomicUsize::new(0));
+    let workers: Vec<_> = (0..options.threads)
+        .map(|_| {
+            let client = Arc::clone(client);
+            let start = Arc::clone(&start);
+            let returned = Arc::clone(&returned);
+            let dumps = options.dumps;
+            thread::spawn(move || {
+                let mut samples = Samples::default();
+                start.wait();
+                for _ in 0..dumps {
+                    let begin = Instant::now();
+                    let outcome = client.dump_without_crash();
+                    samples.add(begin.elapsed(), outcome);
+                    if outcome == DumpOutcome::Dumped {
+                        on_dumped();
+                    }
+                    let returned = returned.fetch_add(1, Ordering::SeqCst) + 1;
+                    if crash_after == Some(returned) {
+                        crash();
+                    }
+                }
+                samples
+            })
+        })
+        .collect();
+
+    start.wait();
+    let begin = Instant::now();
+    let mut samples = Samples::default();
+    for worker in workers {
+        samples.merge(worker.join().expect("dump thread panicked"));
+    }
+    (samples, begin.elapsed())
+}
+
+fn crash() -> ! {
+    unsafe {
+        let ptr: *mut i32 = std::ptr::null_mut();
+        std::ptr::write_volatile(ptr, 42);
+    }
+    unreachable!()
+}
+
+fn print_dumped() {
+    let mut stdout = std::io::stdout().lock();
+    let _ = writeln!(stdout, "{DUMPED_LINE}");
+    let _ = stdout.flush();
+}
+
+/// Reports in the database once the count stops changing
+fn settled_report_count(expected: usize) -> usize {
+    let database = match CrashDatabase::open(database_path()) {
+        Ok(database) => database,
+        Err(_) => return 0,
+    };
+    let deadline = Instant::now() + SETTLE_TIMEOUT;
+    let mut count = 0;
+    let mut stable_since = Instant::now();
+    loop {
+        let current = database.reports().map_or(0, |reports| reports.len());
+        if current != count {
+            count = current;
+            stable_since = Instant::now();
+        }
+        let stable = stable_since.elapsed() >= Duration::from_secs(2);
+        if (count >= expected && stable) || Instant::now() >= deadline {
+            return count;
+        }
+        thread::sleep(Duration::from_millis(100));
+    }
+}
+
+fn policy_name(policy: DumpPolicy) -> &'static str {
+    match policy {
+        DumpPolicy::Queue => "queue",
+        DumpPolicy::Coalesce => "coalesce",
+        DumpPolicy::Drop => "drop",
+    }
+}
+
+fn run_child(options: &Options) -> ! {
+    let client = Arc::new(start_client(options));
+    let calls = options.threads * options.dumps;
+    run_load(&client, options, Some(calls / 2 + 1), print_dumped);
+    // Fewer than two calls in total: crash without racing anything
+    crash()
+}
+
+/// Runs the load in a child that crashes; returns dumps written before the
+/// crash and the child's runtime.
+fn run_crashing_child(options: &Options) -> (usize, Duration) {
+    let exe = env::current_exe().expect("current executable");
+    let begin = Instant::now();
+    let mut child = Command::new(exe)
+        .args(["--child", "--policy", policy_name(options.policy)])
+        .args(["--threads", &options.threads.to_string()])
+        .args(["--dumps", &options.dumps.to_string()])
+        .stdout(Stdio::piped())
+        .spawn()
+        .expect("spawn crashing child");
+
+    let stdout = child.stdout.take().expect("child stdout");
+    let dumped = BufReader::new(stdout)
+        .lines()
+        .map_while(|line| line.ok())
+        .filter(|line| line == DUMPED_LINE)
+        .count();
+    let status = child.wait().expect("wait for child");
+    println!("child exited with {status}");
+    (dumped, begin.elapsed())
+}
+
+fn main() {
+    let options = parse_options();
+    if options.child {
+        run_child(&options);
+    }
+
+    let _ = std::fs::remove_dir_all(database_path());
+    println!(
+        "Stress: {} threads x {} dumps, policy {}{}",
+        options.threads,
+        options.dumps,
+        policy_name(options.policy),
+        if options.crash {
+            ", crashing halfway"
+        } else {
+            ""
+        }
+    );
+
+    let (samples, elapsed, expected) = if options.crash {
+        let (dumped, elapsed) = run_crashing_child(&options);
+        let samples = Samples {
+            dumped,
+            ..Samples::default()
+        };
+        // Every written dump plus the crash itself
+        (samples, elapsed, dumped + 1)
+    } else {
+        let client = Arc::new(start_client(&options));
+        let (samples, elapsed) = run_load(&client, &options, None, || {});
+        let expected = samples.dumped;
+        (samples, elapsed, expected)
+    };
+
+    let reports = settled_report_count(expected);
+    let lost = expected.saturating_sub(reports);
+    let calls = samples.latencies.len();
+    let throughput = samples.dumped as f64 / elapsed.as_secs_f64();
+
+    println!(
+        "calls: {calls}, dumped: {}, coalesced: {}, dropped: {}",
+        samples.dumped, samples.coalesced, samples.dropped
+    );
+    println!("throughput: {throughput:.1} dumps/s over {elapsed:?}");
+    if calls > 0 {
+        println!(
+            "latency: p50 {:?}, p99 {:?}, max {:?}",
+            samples.percentile(50),
+            samples.percentile(99),
+            samples.percentile(100)
+        );
+    }
+    println!("reports: {reports} of {expected} expected, {lost} lost");
+    println!(
+        "{{\"threads\": {}, \"dumps_per_thread\": {}, \"policy\": \"{}\", \"crash\": {}, \
+         \"calls\": {calls}, \"dumped\": {}, \"coalesced\": {}, \"dropped\": {}, \
+         \"elapsed_ms\": {}, \"throughput_per_s\": {throughput:.3}, \
+         \"p50_us\": {}, \"p99_us\": {}, \"max_us\": {}, \
+         \"reports\": {reports}, \"expected_reports\": {expected}, \"lost_reports\": {lost}}}",
+        options.threads,
+        options.dumps,
+        policy_name(options.policy),
+        options.crash,
+        samples.dumped,
+        samples.coalesced,
+        samples.dropped,
+        elapsed.as_millis(),
+        samples.percentile(50).as_micros(),
+        samples.percentile(99).as_micros(),
+        samples.percentile(100).as_micros(),
+    );
+
+    if lost > 0 {
+        process::exit(EXIT_LOST_REPORTS);
+    }
+}
@@ -0,0 +1,333 @@
+use std::cell::UnsafeCell;
+use std::ffi::CString;
+use std::fmt;
+use std::hint;
+use std::os::raw::c_void;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::OnceLock;
+
+use crate::{CrashpadError, Result};
+use crashpad_rs_sys::*;
+
+/// Largest annotation value, one byte below
+/// `crashpad::Annotation::kValueMaxSize`, which sizes must stay under
+const MAX_VALUE_SIZE: usize = 5 * 4096 - 1;
+
+/// Longest annotation name, matching `crashpad::Annotation::kNameMaxLength`
+/// (including the terminator)
+const MAX_NAME_LENGTH: usize = 256;
+
+/// A crash annotation whose value can be updated at any time.
+///
+/// Unlike the annotations passed when starting the handler, a slot is read
+/// directly out of process memory when a crash happens, so the latest value
+/// always ends up in the report. The value buffer is allocated once when the
+/// slot is created; [`AnnotationSlot::set`] is a bounded copy with no heap
+/// allocation or locking, suitable for per-request updates.
+///
+/// Slots stay registered until the process exits, even after the
+/// `AnnotationSlot` is dropped. Create them once and reuse them.
+///
+/// # Example
+/// ```no_run
+/// use crashpad_rs::AnnotationSlot;
+///
+/// let request_id = AnnotationSlot::new("request_id", 64)?;
+/// request_id.set("3f2a9c");
+/// # Ok::<(), crashpad_rs::CrashpadError>(())
+/// ```
+#[derive(Debug)]
+pub struct AnnotationSlot {
+    handle: crashpad_annotation_t,
+    capacity: usize,
+}
+
+// SAFETY: the slot is owned by Crashpad for the rest of the process and the
+// wrapper functions are safe to call from any thread.
+unsafe impl Send for AnnotationSlot {}
+unsafe impl Sync for AnnotationSlot {}
+
+impl AnnotationSlot {
+    /// Creates a slot named `name` that holds up to `capacity` bytes.
+    ///
+    /// The slot does not appear in reports until a value is set.
+    ///
+    /// # Errors
+    /// Returns `InvalidConfiguration` if the name is empty, too long or
+    /// contains a NUL byte, or if `capacity` is 0 or exceeds
+    /// [`AnnotationSlot::max_capacity`].
+    pub fn new(name: &str, capacity: usize) -> Result<Self> {
+        let name_c = CString::new(name).map_err(|_| {
+            CrashpadError::InvalidConfiguration("Invalid annotation name".to_string())
+        })?;
+
+        let handle = unsafe { crashpad_annotation_new(name_c.as_ptr(), capacity) };
+        if handle.is_null() {
+            return Err(CrashpadError::InvalidConfiguration(format!(
+                "Invalid annotation slot '{name}' with capacity {capacity}"
+            )));
+        }
+
+        Ok(AnnotationSlot { handle, capacity })
+    }
+
+    /// Largest capacity a single slot can have
+    pub fn max_capacity() -> usize {
+        unsafe { crashpad_annotation_max_value_size() }
+    }
+
+    /// Capacity of this slot in bytes
+    pub fn capacity(&self) -> usize {
+        self.capacity
+    }
+
+    /// Replaces the value, truncating it to the slot's capacity.
+    ///
+    /// Truncation happens on a character boundary so the stored value stays
+    /// valid UTF-8. Concurrent writers to the same slot may leave a mix of
+    /// both values in a report; give each thread its own slot if that matters.
+    pub fn set(&self, value: &str) {
+        let value = truncate_to_char_boundary(value, self.capacity);
+        self.set_bytes(value.as_bytes());
+    }
+
+    /// Replaces the value with raw bytes, truncating to the slot's capacity.
+    pub fn set_bytes(&self, value: &[u8]) {
+        unsafe { crashpad_annotation_set(self.handle, value.as_ptr() as *const _, value.len()) }
+    }
+
+    /// Removes the value from future crash reports.
+    pub fn clear(&self) {
+        unsafe { crashpad_annotation_clear(self.handle) }
+    }
+}
+
+/// A fixed-size crash annotation stored in a static buffer.
+///
+/// `Annotation<N>` is the static counterpart of [`AnnotationSlot`]: the `N`
+/// byte value buffer lives inside the annotation itself, so declaring one as a
+/// `static` reserves its storage at compile time and the handler reads it
+/// straight out of process memory at crash time. The buffer is registered
+/// with Crashpad on first use; after that an update is a copy into the buffer
+/// with no allocation.
+///
+/// `N` must be between 1 and 20479 bytes, the same limit as
+/// [`AnnotationSlot::max_capacity`], and the name must be shorter than 256
+/// bytes without NUL bytes; both are checked at compile time when the
+/// annotation is a `static`:
+///
+/// ```compile_fail
+/// # use crashpad_rs::Annotation;
+/// static TOO_LARGE: Annotation<20480> = Annotation::new("too_large");
+/// ```
+///
+/// Writers to the same annotation are serialized by a spin flag that is
+/// uncontended in the common case of one writer per annotation.
+///
+/// # Example
+/// ```no_run
+/// use crashpad_rs::Annotation;
+///
+/// static SHARD: Annotation<16> = Annotation::new("shard");
+///
+/// SHARD.set("eu-west-3");
+/// SHARD.set_fmt(format_args!("shard-{}", 42));
+/// ```
+pub struct Annotation<const N: usize> {
+    name: &'static str,
+    value: UnsafeCell<[u8; N]>,
+    writing: AtomicBool,
+    handle: OnceLock<Option<Handle>>,
+}
+
+struct Handle(crashpad_annotation_t);
+
+// SAFETY: the handle refers to a Crashpad-owned slot that is never freed.
+unsafe impl Send for Handle {}
+unsafe impl Sync for Handle {}
+
+// SAFETY: the value buffer is only written while holding the `writing` flag.
+unsafe impl<const N: usize> Sync for Annotation<N> {}
+
+impl<const N: usize> Annotation<N> {
+    const VALID_SIZE: () = assert!(
+        N > 0 && N <= MAX_VALUE_SIZE,
+        "annotation size must be between 1 and 20479 bytes"
+    );
+
+    /// Declares an annotation named `name` with an `N` byte value.
+    ///
+    /// # Panics
+    /// Panics (at compile time in a `static`) if `N` or `name` is invalid.
+    pub const fn new(name: &'static str) -> Self {
+        #[allow(clippy::let_unit_value)]
+        let () = Self::VALID_SIZE;
+
+        assert!(
+            !name.is_empty() && name.len() < MAX_NAME_LENGTH,
+            "annotation name must be 1 to 255 bytes"
+        );
+        let bytes = name.as_bytes();
+        let mut i = 0;
+        while i < bytes.len() {
+            assert!(bytes[i] != 0, "annotation name must not contain NUL");
+            i += 1;
+        }
+
+        Annotation {
+            name,
+            value: UnsafeCell::new([0; N]),
+            writing: AtomicBool::new(false),
+            handle: OnceLock::new(),
+        }
+    }
+
+    /// Name of the annotation
+    pub fn name(&self) -> &'static str {
+        self.name
+    }
+
+    /// Replaces the value, truncating it to `N` bytes on a character boundary.
+    pub fn set(&'static self, value: &str) {
+        let value = truncate_to_char_boundary(value, N);
+        self.write(|buffer| {
+            buffer[..value.len()].copy_from_slice(value.as_bytes());
+            value.len()
+        });
+    }
+
+    /// Formats `args` directly into the value buffer, truncating to `N` bytes.
+    ///
+    /// Avoids the temporary `String` of `set(&format!(...))`.
+    pub fn set_fmt(&'static self, args: fmt::Arguments<'_>) {
+        self.write(|buffer| {
+            let mut writer = BufferWriter { buffer, len: 0 };
+            // An error only means the value was truncated
+            let _ = fmt::write(&mut writer, args);
+            writer.len
+        });
+    }
+
+    /// Removes the value from future crash reports.
+    pub fn clear(&'static self) {
+        self.write(|_| 0);
+    }
+
+    fn write(&'static self, fill: impl FnOnce(&mut [u8]) -> usize) {
+        let Some(handle) = self.handle() else {
+            return;
+        };
+
+        let _guard = WriteGuard::acquire(&self.writing);
+        // SAFETY: the write flag gives exclusive access to the buffer
+        let len = fill(unsafe { &mut *self.value.get() });
+        unsafe { crashpad_annotation_set_size(handle.0, len) };
+    }
+
+    fn handle(&'static self) -> Option<&'static Handle> {
+        self.handle
+            .get_or_init(|| {
+                let name = CString::new(self.name).ok()?;
+                let handle = unsafe {
+                    crashpad_annotation_register(name.as_ptr(), self.value.get() as *mut c_void, N)
+                };
+                (!handle.is_null()).then_some(Handle(handle))
+            })
+            .as_ref()
+    }
+}
+
+impl<const N: usize> fmt::Debug for Annotation<N> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("Annotation")
+            .field("name", &self.name)
+            .field("size", &N)
+            .finish()
+    }
+}
+
+/// Holds an annotation's write flag, releasing it even if formatting panics
+struct WriteGuard<'a>(&'a AtomicBool);
+
+impl<'a> WriteGuard<'a> {
+    fn acquire(flag: &'a AtomicBool) -> Self {
+        while flag
+            .compare_exchange_weak(false, true, Ordering::Acquire, Ordering::Relaxed)
+            .is_err()
+        {
+            hint::spin_loop();
+        }
+        WriteGuard(flag)
+    }
+}
+
+impl Drop for WriteGuard<'_> {
+    fn drop(&mut self) {
+        self.0.store(false, Ordering::Release);
+    }
+}
+
+/// `fmt::Write` sink over a fixed buffer that truncates on character
+/// boundaries
+pub(crate) struct BufferWriter<'a> {
+    pub(crate) buffer: &'a mut [u8],
+    pub(crate) len: usize,
+}
+
+impl fmt::Write for BufferWriter<'_> {
+    fn write_str(&mut self, s: &str) -> fmt::Result {
+        let available = self.buffer.len() - self.len;
+        let chunk = truncate_to_char_boundary(s, available);
+        self.buffer[self.len..self.len + chunk.len()].copy_from_slice(chunk.as_bytes());
+        self.len += chunk.len();
+        if chunk.len() < s.len() {
+            Err(fmt::Error)
+        } else {
+            Ok(())
+        }
+    }
+}
+
+/// Longest prefix of `value` that fits in `max` bytes without splitting a
+/// character
+pub(crate) fn truncate_to_char_boundary(value: &str, max: usize) -> &str {
+    if value.len() <= max {
+        return value;
+    }
+    let mut end = max;
+    while !value.is_char_boundary(end) {
+        end -= 1;
+    }
+    &value[..end]
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_truncate_to_char_boundary() {
+        assert_eq!(truncate_to_char_boundary("shard-7", 16), "shard-7");
+        assert_eq!(truncate_to_char_boundary("shard-7", 5), "shard");
+        assert_eq!(truncate_to_char_boundary("", 0), "");
+        // "é" is two bytes; never cut it in half
+        assert_eq!(truncate_to_char_boundary("aé", 2), "a");
+        assert_eq!(truncate_to_char_boundary("aé", 3), "aé");
+    }
+
+    #[test]
+    fn test_buffer_writer_truncates() {
+        use std::fmt::Write;
+
+        let mut buffer = [0u8; 8];
+        let mut writer = BufferWriter {
+            buffer: &mut buffer,
+            len: 0,
+        };
+        assert!(write!(writer, "id-{}", 42).is_ok());
+        assert_eq!(writer.len, 5);
+        assert!(write!(writer, "éé").is_err());
+        assert_eq!(writer.len, 7);
+        assert_eq!(&buffer[..7], "id-42é".as_bytes());
+    }
+}
@@ -0,0 +1,389 @@
+use std::collections::HashSet;
+use std::fmt;
+use std::fs;
+use std::io;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::JoinHandle;
+use std::time::{Duration, SystemTime};
+
+use crate::client::path_to_cstring;
+use crate::{CrashpadError, Result};
+use crashpad_rs_sys::*;
+
+/// Directory in the database holding one directory of copies per process
+///
+/// Outside Crashpad's own layout, and per process so that processes sharing a
+/// database never write each other's copies.
+const STAGING_DIR: &str = "staged-attachments";
+
+/// A file copied into crash reports, see
+/// [`crate::CrashpadConfigBuilder::attachment`]
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub(crate) struct Attachment {
+    path: PathBuf,
+    max_bytes: u64,
+    tail_only: bool,
+}
+
+impl Attachment {
+    pub(crate) fn new(path: PathBuf, max_bytes: u64, tail_only: bool) -> Self {
+        Attachment {
+            path,
+            max_bytes,
+            tail_only,
+        }
+    }
+
+    pub(crate) fn path(&self) -> &Path {
+        &self.path
+    }
+
+    pub(crate) fn max_bytes(&self) -> u64 {
+        self.max_bytes
+    }
+
+    pub(crate) fn tail_only(&self) -> bool {
+        self.tail_only
+    }
+}
+
+/// Capped copies of the configured attachments, which are what the handler
+/// is told to attach
+///
+/// The handler reads attachments whole at crash time. Handing it a bounded
+/// copy instead keeps a runaway log from inflating every report.
+#[derive(Debug)]
+pub(crate) struct StagedAttachments {
+    dir: PathBuf,
+    entries: Vec<(Attachment, PathBuf)>,
+    compress: bool,
+    /// Size and modification time of each source as of its latest copy
+    copied: Mutex<Vec<Option<FileStamp>>>,
+}
+
+/// What a source file looked like when it was copied
+type FileStamp = (u64, Option<SystemTime>);
+
+fn file_stamp(path: &Path) -> Option<FileStamp> {
+    let metadata = fs::metadata(path).ok()?;
+    Some((metadata.len(), metadata.modified().ok()))
+}
+
+impl StagedAttachments {
+    /// Stages `attachments` in this process's directory under
+    /// `database_path` and copies them for the first time.
+    ///
+    /// Fails only if attachments are unsupported. A copy that fails is
+    /// reported on stderr and retried on the next refresh, so attachments
+    /// never keep the handler from starting.
+    pub(crate) fn stage(
+        attachments: &[Attachment],
+        database_path: &Path,
+        compress: bool,
+    ) -> Result<Self> {
+        if !attachments.is_empty() && !unsafe { crashpad_attachments_supported() } {
+            return Err(CrashpadError::InvalidConfiguration(
+                "Attachments are not supported on this platform".to_string(),
+            ));
+        }
+
+        let root = database_path.join(STAGING_DIR);
+        let dir = root.join(std::process::id().to_string());
+        if !attachments.is_empty() {
+            remove_exited(&root);
+        }
+        let mut names = HashSet::new();
+        let entries = attachments
+            .iter()
+            .map(|attachment| {
+                let name = staged_name(attachment.path(), compress, &mut names);
+                (attachment.clone(), dir.join(name))
+            })
+            .collect();
+
+        let staged = StagedAttachments {
+            copied: Mutex::new(vec![None; attachments.len()]),
+            dir,
+            entries,
+            compress,
+        };
+        if let Err(error) = staged.refresh() {
+            eprintln!("crashpad-rs: warning: {error}; retrying on the next refresh");
+        }
+        Ok(staged)
+    }
+
+    pub(crate) fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    /// Copies the current contents of every attachment.
+    ///
+    /// An attachment whose file does not exist is left out until it does.
+    /// A failed copy does not stop the others; the error names every
+    /// attachment that failed.
+    pub(crate) fn refresh(&self) -> Result<()> {
+        self.copy(false)
+    }
+
+    /// Copies the attachments whose size or modification time changed since
+    /// their latest copy.
+    pub(crate) fn refresh_changed(&self) -> Result<()> {
+        self.copy(true)
+    }
+
+    fn copy(&self, changed_only: bool) -> Result<()> {
+        if self.entries.is_empty() {
+            return Ok(());
+        }
+        // Recreated if something removed it since the last refresh
+        fs::create_dir_all(&self.dir)?;
+
+        let mut copied = self.copied.lock().unwrap_or_else(|e| e.into_inner());
+        let mut failed = Vec::new();
+        for ((attachment, staged), last) in self.entries.iter().zip(copied.iter_mut()) {
+            let stamp = file_stamp(attachment.path());
+            if changed_only && stamp == *last {
+                continue;
+            }
+            *last = stamp;
+
+            if stage_copy(attachment, staged, self.compress) {
+                continue;
+            }
+            if !attachment.path().exists() {
+                let _ = fs::remove_file(staged);
+                continue;
+            }
+            // Retried on the next refresh
+            *last = None;
+            failed.push(attachment.path().display().to_string());
+        }
+        if failed.is_empty() {
+            return Ok(());
+        }
+        Err(CrashpadError::IoError(io::Error::new(
+            io::ErrorKind::Other,
+            format!("Failed to copy attachments {}", failed.join(", ")),
+        )))
+    }
+
+    /// Paths of the capped copies, to pass to the handler
+    #[cfg_attr(
+        any(target_os = "ios", target_os = "tvos", target_os = "watchos"),
+        allow(dead_code)
+    )]
+    pub(crate) fn paths(&self) -> Vec<&Path> {
+        self.entries
+            .iter()
+            .map(|(_, staged)| staged.as_path())
+            .collect()
+    }
+}
+
+/// Copies one attachment to `staged`; returns whether the copy succeeded
+fn stage_copy(attachment: &Attachment, staged: &Path, compress: bool) -> bool {
+    let (Ok(source), Ok(destination)) =
+        (path_to_cstring(attachment.path()), path_to_cstring(staged))
+    else {
+        return false;
+    };
+    let copied = unsafe {
+        crashpad_stage_attachment(
+            source.as_ptr(),
+            destination.as_ptr(),
+            attachment.max_bytes(),
+            attachment.tail_only(),
+            compress,
+        )
+    };
+    copied >= 0
+}
+
+/// Removes the copies of processes that have exited from `root`
+///
+/// Their handlers took what they needed when they wrote their reports.
+fn remove_exited(root: &Path) {
+    let Ok(entries) = fs::read_dir(root) else {
+        return;
+    };
+    let current = std::process::id();
+    for entry in entries.flatten() {
+        let Some(pid) = entry
+            .file_name()
+            .to_str()
+            .and_then(|name| name.parse::<u32>().ok())
+        else {
+            continue;
+        };
+        if pid != current && !unsafe { crashpad_process_exists(pid as i64) } {
+            let _ = fs::remove_dir_all(entry.path());
+        }
+    }
+}
+
+/// Refreshes changed attachments on a background thread
+///
+/// Crash reports are written from the copies, so without this they would
+/// carry an attached log as of the latest explicit refresh.
+pub(crate) struct AttachmentRefresher {
+    stop: Arc<(Mutex<bool>, Condvar)>,
+    worker: Option<JoinHandle<()>>,
+}
+
+impl AttachmentRefresher {
+    /// Checks `attachments` for changes every `interval`.
+    pub(crate) fn start(attachments: Arc<StagedAttachments>, interval: Duration) -> Result<Self> {
+        let stop = Arc::new((Mutex::new(false), Condvar::new()));
+        let worker_stop = Arc::clone(&stop);
+        let worker = std::thread::Builder::new()
+            .name("crashpad-attachments".to_string())
+            .spawn(move || {
+                let (stopped, cvar) = &*worker_stop;
+                loop {
+                    let guard = stopped.lock().unwrap_or_else(|e| e.into_inner());
+                    let (guard, _) = cvar
+                        .wait_timeout_while(guard, interval, |stopped| !*stopped)
+                        .unwrap_or_else(|e| e.into_inner());
+                    if *guard {
+                        return;
+                    }
+                    drop(guard);
+                    // A failed copy keeps the previous one and is retried
+                    let _ = attachments.refresh_changed();
+                }
+            })?;
+
+        Ok(AttachmentRefresher {
+            stop,
+            worker: Some(worker),
+        })
+    }
+}
+
+impl Drop for AttachmentRefresher {
+    fn drop(&mut self) {
+        let (stopped, cvar) = &*self.stop;
+        *stopped.lock().unwrap_or_else(|e| e.into_inner()) = true;
+        cvar.notify_all();
+        if let Some(worker) = self.worker.take() {
+            let _ = worker.join();
+        }
+    }
+}
+
+impl fmt::Debug for AttachmentRefresher {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("AttachmentRefresher")
+            .finish_non_exhaustive()
+    }
+}
+
+/// File name of the copy of `path`, unique among `taken`
+///
+/// The handler names each attachment in the report after its file.
+fn staged_name(path: &Path, compress: bool, taken: &mut HashSet<String>) -> String {
+    let base = path
+        .file_name()
+        .map(|name| name.to_string_lossy().into_owned())
+        .unwrap_or_else(|| "attachment".to_string());
+    let suffix = if compress { ".gz" } else { "" };
+
+    let mut name = format!("{base}{suffix}");
+    let mut index = 1;
+    while !taken.insert(name.clone()) {
+        index += 1;
+        name = format!("{base}.{index}{suffix}");
+    }
+    name
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_staged_names() {
+        let mut taken = HashSet::new();
+        assert_eq!(
+            staged_name(Path::new("/var/log/app.log"), false, &mut taken),
+            "app.log"
+        );
+        assert_eq!(
+            staged_name(Path::new("/tmp/app.log"), false, &mut taken),
+            "app.log.2"
+        );
+        assert_eq!(
+            staged_name(Path::new("/etc/app.toml"), true, &mut taken),
+            "app.toml.gz"
+        );
+        assert_eq!(staged_name(Path::new("/"), false, &mut taken), "attachment");
+    }
+
+    #[test]
+    #[cfg(not(any(target_os = "ios", target_os = "tvos", target_os = "watchos")))]
+    fn test_refresh_changed() {
+        let dir = tempfile::TempDir::new().unwrap();
+        let log = dir.path().join("app.log");
+        fs::write(&log, "first").unwrap();
+
+        let attachments = [Attachment::new(log.clone(), 1024, true)];
+        let staged = StagedAttachments::stage(&attachments, dir.path(), false).unwrap();
+        let copy = staged.paths()[0].to_path_buf();
+        assert_eq!(fs::read_to_string(&copy).unwrap(), "first");
+
+        // Unchanged files are not copied again
+        fs::write(&copy, "stale").unwrap();
+        staged.refresh_changed().unwrap();
+        assert_eq!(fs::read_to_string(&copy).unwrap(), "stale");
+
+        fs::write(&log, "first, then more").unwrap();
+        staged.refresh_changed().unwrap();
+        assert_eq!(fs::read_to_string(&copy).unwrap(), "first, then more");
+    }
+
+    #[test]
+    #[cfg(not(any(target_os = "ios", target_os = "tvos", target_os = "watchos")))]
+    fn test_stage_per_process() {
+        let dir = tempfile::TempDir::new().unwrap();
+        let log = dir.path().join("app.log");
+        fs::write(&log, "log").unwrap();
+        // Left behind by a process that has exited
+        let exited = dir.path().join(STAGING_DIR).join(i32::MAX.to_string());
+        fs::create_dir_all(&exited).unwrap();
+
+        let attachments = [Attachment::new(log, 1024, false)];
+        let staged = StagedAttachments::stage(&attachments, dir.path(), false).unwrap();
+        assert_eq!(
+            staged.paths()[0],
+            dir.path()
+                .join(STAGING_DIR)
+                .join(std::process::id().to_string())
+                .join("app.log")
+        );
+        assert!(!exited.exists());
+    }
+
+    #[test]
+    #[cfg(not(any(target_os = "ios", target_os = "tvos", target_os = "watchos")))]
+    fn test_refresh_continues_past_failures() {
+        let dir = tempfile::TempDir::new().unwrap();
+        // Exists, but cannot be copied
+        let unreadable = dir.path().join("logs");
+        fs::create_dir(&unreadable).unwrap();
+        let log = dir.path().join("app.log");
+        fs::write(&log, "log").unwrap();
+
+        let attachments = [
+            Attachment::new(unreadable.clone(), 1024, false),
+            Attachment::new(log, 1024, false),
+        ];
+        // Staging still succeeds
+        let staged = StagedAttachments::stage(&attachments, dir.path(), false).unwrap();
+        assert_eq!(fs::read_to_string(staged.paths()[1]).unwrap(), "log");
+
+        let error = staged.refresh().unwrap_err().to_string();
+        assert!(error.contains(&unreadable.display().to_string()), "{error}");
+    }
+}
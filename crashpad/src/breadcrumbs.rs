@@ -0,0 +1,458 @@
+use std::fmt;
+use std::sync::atomic::{self, AtomicBool, AtomicU64, Ordering};
+
+use crate::annotations::{truncate_to_char_boundary, BufferWriter};
+use crate::{CrashpadError, Result};
+use crashpad_rs_sys::*;
+
+/// Marks the start of a breadcrumb buffer in captured memory ("CPBRDCRB")
+const MAGIC: u64 = u64::from_le_bytes(*b"CPBRDCRB");
+
+/// Words per slot: sequence word, stamped length, then the message
+///
+/// The sequence word is `stamp << 1`, with the low bit set while a writer
+/// fills the slot.
+const SLOT_WORDS: usize = 16;
+
+/// Words before the first slot: magic, slot count, write cursor, slot words
+const HEADER_WORDS: usize = 4;
+
+/// Longest breadcrumb message in bytes; longer messages are truncated
+pub const BREADCRUMB_MAX_LEN: usize = (SLOT_WORDS - 2) * 8;
+
+#[repr(C)]
+struct Slot {
+    words: [AtomicU64; SLOT_WORDS],
+}
+
+#[allow(clippy::declare_interior_mutable_const)]
+const ZERO: AtomicU64 = AtomicU64::new(0);
+
+#[allow(clippy::declare_interior_mutable_const)]
+const EMPTY_SLOT: Slot = Slot {
+    words: [ZERO; SLOT_WORDS],
+};
+
+/// Fixed-capacity ring of recent application breadcrumbs, captured in every
+/// crash dump.
+///
+/// Once [registered](BreadcrumbBuffer::register), the whole buffer is added to
+/// the dump as an extra memory range, so the last `SLOTS` messages are
+/// available after a crash without writing log files. Use
+/// [`Breadcrumb::decode`] to read them back out of the captured memory.
+///
+/// Recording is wait-free and allocation-free, so any number of threads can
+/// record concurrently from hot paths and signal handlers: a writer claims a
+/// slot with a single atomic increment and fills it with plain atomic
+/// stores. Each slot is a seqlock. A writer never waits for another: if the
+/// ring has wrapped onto a slot another writer is still filling, which
+/// includes a thread it interrupted or one that was mid-write when the
+/// process forked, the breadcrumb is dropped and counted in
+/// [`dropped`](BreadcrumbBuffer::dropped). Readers, and the decoder for a
+/// slot that was being written when the crash happened, skip slots that are
+/// mid-write.
+///
+/// # Example
+/// ```no_run
+/// use crashpad_rs::BreadcrumbBuffer;
+///
+/// static BREADCRUMBS: BreadcrumbBuffer<64> = BreadcrumbBuffer::new();
+///
+/// BREADCRUMBS.register()?;
+/// BREADCRUMBS.record("cache warmed");
+/// BREADCRUMBS.record_fmt(format_args!("request {} started", 42));
+/// # Ok::<(), crashpad_rs::CrashpadError>(())
+/// ```
+#[repr(C)]
+pub struct BreadcrumbBuffer<const SLOTS: usize> {
+    magic: u64,
+    slot_count: u64,
+    next: AtomicU64,
+    slot_words: u64,
+    slots: [Slot; SLOTS],
+    registered: AtomicBool,
+    dropped: AtomicU64,
+}
+
+impl<const SLOTS: usize> BreadcrumbBuffer<SLOTS> {
+    /// Bytes captured in dumps: the header and slots, not the local state
+    const CAPTURED_LEN: usize = (HEADER_WORDS + SLOTS * SLOT_WORDS) * 8;
+
+    /// Creates an empty buffer holding the last `SLOTS` breadcrumbs.
+    pub const fn new() -> Self {
+        assert!(SLOTS > 0, "breadcrumb buffer needs at least one slot");
+
+        BreadcrumbBuffer {
+            magic: MAGIC,
+            slot_count: SLOTS as u64,
+            next: AtomicU64::new(0),
+            slot_words: SLOT_WORDS as u64,
+            slots: [EMPTY_SLOT; SLOTS],
+            registered: AtomicBool::new(false),
+            dropped: AtomicU64::new(0),
+        }
+    }
+
+    /// Includes this buffer in all future crash dumps.
+    ///
+    /// Calling it again is a no-op.
+    ///
+    /// # Errors
+    /// Returns `InvalidConfiguration` if Crashpad's extra memory range table
+    /// is full.
+    pub fn register(&'static self) -> Result<()> {
+        if self.registered.swap(true, Ordering::AcqRel) {
+            return Ok(());
+        }
+
+        let added = unsafe {
+            crashpad_add_extra_memory_range(self as *const Self as *const _, Self::CAPTURED_LEN)
+        };
+        if added {
+            Ok(())
+        } else {
+            self.registered.store(false, Ordering::Release);
+            Err(CrashpadError::InvalidConfiguration(
+                "Too many extra memory ranges registered".to_string(),
+            ))
+        }
+    }
+
+    /// Stops including this buffer in crash dumps.
+    pub fn unregister(&'static self) {
+        if self.registered.swap(false, Ordering::AcqRel) {
+            unsafe {
+                crashpad_remove_extra_memory_range(
+                    self as *const Self as *const _,
+                    Self::CAPTURED_LEN,
+                );
+            }
+        }
+    }
+
+    /// Number of breadcrumbs the buffer retains
+    pub const fn capacity(&self) -> usize {
+        SLOTS
+    }
+
+    /// Breadcrumbs dropped because their slot was still being written
+    pub fn dropped(&self) -> u64 {
+        self.dropped.load(Ordering::Relaxed)
+    }
+
+    /// Records a breadcrumb, truncated to [`BREADCRUMB_MAX_LEN`] bytes on a
+    /// character boundary.
+    pub fn record(&self, message: &str) {
+        let message = truncate_to_char_boundary(message, BREADCRUMB_MAX_LEN);
+        self.record_bytes(message.as_bytes());
+    }
+
+    /// Formats a breadcrumb without allocating, truncated to
+    /// [`BREADCRUMB_MAX_LEN`] bytes.
+    pub fn record_fmt(&self, args: fmt::Arguments<'_>) {
+        let mut buffer = [0u8; BREADCRUMB_MAX_LEN];
+        let mut writer = BufferWriter {
+            buffer: &mut buffer,
+            len: 0,
+        };
+        // An error only means the message was truncated
+        let _ = fmt::write(&mut writer, args);
+        let len = writer.len;
+        self.record_bytes(&buffer[..len]);
+    }
+
+    /// Reads the breadcrumbs currently in the buffer, oldest first.
+    pub fn entries(&self) -> Vec<Breadcrumb> {
+        let mut entries: Vec<Breadcrumb> = self
+            .slots
+            .iter()
+            .filter_map(|slot| {
+                let mut words = [0u64; SLOT_WORDS];
+                words[0] = slot.words[0].load(Ordering::Acquire);
+                for (word, value) in words.iter_mut().zip(&slot.words).skip(1) {
+                    *word = value.load(Ordering::Relaxed);
+                }
+                // A writer that started meanwhile may have torn the copy
+                atomic::fence(Ordering::Acquire);
+                if slot.words[0].load(Ordering::Relaxed) != words[0] {
+                    return None;
+                }
+                parse_slot(&words)
+            })
+            .collect();
+        entries.sort_by_key(|entry| entry.sequence);
+        entries
+    }
+
+    fn record_bytes(&self, message: &[u8]) {
+        // Stamps start at 1 so that 0 marks an empty slot
+        let stamp = self.next.fetch_add(1, Ordering::Relaxed) + 1;
+        let slot = &self.slots[((stamp - 1) % SLOTS as u64) as usize];
+
+        // Take the slot by making its sequence word odd. A failed exchange
+        // means another writer took it, so this runs at most twice.
+        let mut current = slot.words[0].load(Ordering::Relaxed);
+        loop {
+            if current >> 1 >= stamp {
+                // A newer breadcrumb already owns the slot
+                return;
+            }
+            if current & 1 == 1 {
+                // Still being filled, possibly by a thread this one
+                // interrupted or one that did not survive a fork
+                self.dropped.fetch_add(1, Ordering::Relaxed);
+                return;
+            }
+            match slot.words[0].compare_exchange(
+                current,
+                stamp << 1 | 1,
+                Ordering::Acquire,
+                Ordering::Relaxed,
+            ) {
+                Ok(_) => break,
+                Err(actual) => current = actual,
+            }
+        }
+        atomic::fence(Ordering::Release);
+
+        for (word, chunk) in slot.words[2..].iter().zip(message.chunks(8)) {
+            let mut bytes = [0u8; 8];
+            bytes[..chunk.len()].copy_from_slice(chunk);
+            word.store(u64::from_le_bytes(bytes), Ordering::Relaxed);
+        }
+        slot.words[1].store(stamp << 8 | message.len() as u64, Ordering::Relaxed);
+        slot.words[0].store(stamp << 1, Ordering::Release);
+    }
+}
+
+impl<const SLOTS: usize> Default for BreadcrumbBuffer<SLOTS> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<const SLOTS: usize> fmt::Debug for BreadcrumbBuffer<SLOTS> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("BreadcrumbBuffer")
+            .field("capacity", &SLOTS)
+            .field("recorded", &self.next.load(Ordering::Relaxed))
+            .field("dropped", &self.dropped())
+            .finish()
+    }
+}
+
+/// A breadcrumb read back from a [`BreadcrumbBuffer`]
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Breadcrumb {
+    sequence: u64,
+    message: String,
+}
+
+impl Breadcrumb {
+    /// Position in recording order, starting at 1
+    pub fn sequence(&self) -> u64 {
+        self.sequence
+    }
+
+    /// The recorded message; invalid UTF-8 is replaced
+    pub fn message(&self) -> &str {
+        &self.message
+    }
+
+    /// Decodes breadcrumbs from memory captured in a crash dump, oldest first.
+    ///
+    /// `bytes` may be any memory region containing a [`BreadcrumbBuffer`];
+    /// it is located by its header. The dump must come from a machine with
+    /// the same byte order. Returns `None` if no complete buffer is found.
+    pub fn decode(bytes: &[u8]) -> Option<Vec<Breadcrumb>> {
+        decode(bytes)
+    }
+}
+
+/// Parses one slot, rejecting empty slots and slots a writer was filling
+fn parse_slot(words: &[u64; SLOT_WORDS]) -> Option<Breadcrumb> {
+    let stamp = words[0] >> 1;
+    let len = (words[1] & 0xff) as usize;
+    if words[0] & 1 == 1 || stamp == 0 || words[1] >> 8 != stamp || len > BREADCRUMB_MAX_LEN {
+        return None;
+    }
+
+    let bytes: Vec<u8> = words[2..]
+        .iter()
+        .flat_map(|word| word.to_le_bytes())
+        .take(len)
+        .collect();
+    Some(Breadcrumb {
+        sequence: stamp,
+        message: String::from_utf8_lossy(&bytes).into_owned(),
+    })
+}
+
+fn decode(bytes: &[u8]) -> Option<Vec<Breadcrumb>> {
+    let word_at = |offset: usize| -> Option<u64> {
+        let end = offset.checked_add(8)?;
+        Some(u64::from_le_bytes(bytes.get(offset..end)?.try_into().ok()?))
+    };
+
+    let start =
+        (0..bytes.len().saturating_sub(7)).find(|&offset| word_at(offset) == Some(MAGIC))?;
+    let slot_count = word_at(start + 8)? as usize;
+    if word_at(start + 24)? != SLOT_WORDS as u64 {
+        return None;
+    }
+
+    let slots_start = start + HEADER_WORDS * 8;
+    let slots_len = slot_count.checked_mul(SLOT_WORDS * 8)?;
+    if bytes.len() < slots_start.checked_add(slots_len)? {
+        return None;
+    }
+
+    let mut entries: Vec<Breadcrumb> = (0..slot_count)
+        .filter_map(|index| {
+            let slot_start = slots_start + index * SLOT_WORDS * 8;
+            let mut words = [0u64; SLOT_WORDS];
+            for (i, word) in words.iter_mut().enumerate() {
+                *word = word_at(slot_start + i * 8)?;
+            }
+            parse_slot(&words)
+        })
+        .collect();
+    entries.sort_by_key(|entry| entry.sequence);
+    Some(entries)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn as_bytes<const SLOTS: usize>(buffer: &BreadcrumbBuffer<SLOTS>) -> Vec<u8> {
+        // SAFETY: no writers are active and the captured prefix has no padding
+        unsafe {
+            std::slice::from_raw_parts(
+                buffer as *const _ as *const u8,
+                BreadcrumbBuffer::<SLOTS>::CAPTURED_LEN,
+            )
+        }
+        .to_vec()
+    }
+
+    fn messages(entries: &[Breadcrumb]) -> Vec<&str> {
+        entries.iter().map(Breadcrumb::message).collect()
+    }
+
+    #[test]
+    fn test_breadcrumb_ring_wraps() {
+        let buffer = BreadcrumbBuffer::<4>::new();
+        assert!(buffer.entries().is_empty());
+
+        for i in 1..=6 {
+            buffer.record_fmt(format_args!("event {i}"));
+        }
+
+        let entries = buffer.entries();
+        assert_eq!(
+            messages(&entries),
+            ["event 3", "event 4", "event 5", "event 6"]
+        );
+        assert_eq!(entries[0].sequence(), 3);
+    }
+
+    #[test]
+    fn test_breadcrumb_truncation() {
+        let buffer = BreadcrumbBuffer::<2>::new();
+        let long = "é".repeat(BREADCRUMB_MAX_LEN);
+        buffer.record(&long);
+
+        let entries = buffer.entries();
+        assert_eq!(entries[0].message().len(), BREADCRUMB_MAX_LEN);
+        assert!(long.starts_with(entries[0].message()));
+    }
+
+    #[test]
+    fn test_breadcrumb_decode() {
+        let buffer = BreadcrumbBuffer::<8>::new();
+        buffer.record("start");
+        buffer.record("request 42");
+
+        // The buffer may sit anywhere inside a captured memory region
+        let mut region = vec![0xAAu8; 13];
+        region.extend(as_bytes(&buffer));
+        region.extend([0u8; 5]);
+
+        let entries = Breadcrumb::decode(&region).unwrap();
+        assert_eq!(entries, buffer.entries());
+        assert_eq!(messages(&entries), ["start", "request 42"]);
+
+        // Truncated or missing buffers are rejected
+        assert!(Breadcrumb::decode(&region[..100]).is_none());
+        assert!(Breadcrumb::decode(&[0u8; 64]).is_none());
+    }
+
+    #[test]
+    fn test_breadcrumb_torn_slot_skipped() {
+        let buffer = BreadcrumbBuffer::<2>::new();
+        buffer.record("complete");
+        buffer.record("interrupted");
+
+        // Simulate a crash between claiming the slot and finishing the write
+        buffer.slots[1].words[0].store(3 << 1 | 1, Ordering::Relaxed);
+
+        assert_eq!(messages(&buffer.entries()), ["complete"]);
+        assert_eq!(
+            messages(&Breadcrumb::decode(&as_bytes(&buffer)).unwrap()),
+            ["complete"]
+        );
+    }
+
+    #[test]
+    fn test_breadcrumb_concurrent_writers() {
+        let buffer = BreadcrumbBuffer::<64>::new();
+        std::thread::scope(|scope| {
+            for thread in 0..4 {
+                let buffer = &buffer;
+                scope.spawn(move || {
+                    for i in 0..1000 {
+                        buffer.record_fmt(format_args!("thread {thread} event {i:04}"));
+                    }
+                });
+            }
+
+            // Concurrent readers never see a mix of two writers' messages
+            let buffer = &buffer;
+            scope.spawn(move || {
+                for _ in 0..200 {
+                    for entry in buffer.entries() {
+                        let message = entry.message();
+                        assert_eq!(message.len(), "thread 0 event 0000".len(), "{message}");
+                        assert!(message.starts_with("thread "), "{message}");
+                    }
+                }
+            });
+        });
+
+        // Every slot ends up with a complete breadcrumb; the newest one is
+        // only missing if it found its slot mid-write and was dropped
+        let entries = buffer.entries();
+        assert_eq!(entries.len(), 64);
+        if buffer.dropped() == 0 {
+            assert_eq!(entries.last().unwrap().sequence(), 4000);
+        }
+    }
+
+    #[test]
+    fn test_breadcrumb_never_waits_for_stuck_slot() {
+        let buffer = BreadcrumbBuffer::<2>::new();
+        buffer.record("first");
+
+        // A writer that never finishes, e.g. one that was mid-write in the
+        // parent when the process forked
+        buffer.slots[1].words[0].store(1 << 1 | 1, Ordering::Relaxed);
+
+        buffer.record("second");
+        buffer.record("third");
+        buffer.record("fourth");
+
+        assert_eq!(buffer.dropped(), 2);
+        assert_eq!(messages(&buffer.entries()), ["third"]);
+    }
+}
@@ -1,9 +1,42 @@
 use std::collections::HashMap;
 use std::ffi::CString;
+use std::hash::Hash;
+#[cfg(any(target_os = "linux", target_os = "android"))]
+use std::os::fd::{FromRawFd, IntoRawFd, OwnedFd, RawFd};
+use std::os::raw::c_char;
+#[cfg(any(target_os = "linux", target_os = "android"))]
+use std::os::raw::c_int;
+#[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+use std::os::raw::c_void;
 use std::path::Path;
+#[cfg(any(target_os = "linux", target_os = "android"))]
+use std::path::PathBuf;
 use std::ptr;
+use std::sync::{Arc, Condvar, Mutex, MutexGuard, OnceLock};
+use std::thread::JoinHandle;
+use std::time::Duration;
 
-use crate::{CrashpadConfig, CrashpadError, Result};
+use crate::attachments::{AttachmentRefresher, StagedAttachments};
+#[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+use crate::conversion::{self, InProcessConverter};
+#[cfg(any(target_os = "linux", target_os = "android"))]
+use crate::first_chance::{self, FirstChanceHandler};
+use crate::health;
+use crate::latency;
+#[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+use crate::observer::{self, ReportObserver};
+use crate::panic_hook;
+use crate::token::TokenKind;
+#[cfg(not(any(target_os = "ios", target_os = "tvos", target_os = "watchos")))]
+use crate::HandlerStartMode;
+#[cfg(any(target_os = "linux", target_os = "android"))]
+use crate::IoPriority;
+#[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+use crate::{CrashDatabase, DumpConversion, IntermediateDumpProcessing, ReportEvent};
+use crate::{
+    CrashpadConfig, CrashpadError, DumpLatency, DumpOutcome, DumpThrottle, HandlerStatus,
+    HandlerToken, Result, SamplingPolicy,
+};
 
 // Import FFI bindings
 use crashpad_rs_sys::*;
@@ -11,6 +44,17 @@ use crashpad_rs_sys::*;
 /// A Crashpad client that can be used to capture and report crashes.
 pub struct CrashpadClient {
     handle: crashpad_client_t,
+    startup: Mutex<Option<HandlerStartup>>,
+    startup_thread: Mutex<Option<JoinHandle<()>>>,
+    #[cfg(target_os = "macos")]
+    mach_service: Mutex<Option<String>>,
+    #[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+    dump_conversion: Mutex<Option<DumpConversion>>,
+    #[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+    report_observer: Arc<ReportObserver>,
+    sampling: OnceLock<SamplingPolicy>,
+    attachments: Mutex<Option<Arc<StagedAttachments>>>,
+    attachment_refresher: Mutex<Option<AttachmentRefresher>>,
 }
 
 impl CrashpadClient {
@@ -20,7 +64,93 @@ impl CrashpadClient {
         if handle.is_null() {
             return Err(CrashpadError::InitializationFailed);
         }
-        Ok(CrashpadClient { handle })
+        Ok(CrashpadClient {
+            handle,
+            startup: Mutex::new(None),
+            startup_thread: Mutex::new(None),
+            #[cfg(target_os = "macos")]
+            mach_service: Mutex::new(None),
+            #[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+            dump_conversion: Mutex::new(None),
+            #[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+            report_observer: Arc::new(ReportObserver::new()),
+            sampling: OnceLock::new(),
+            attachments: Mutex::new(None),
+            attachment_refresher: Mutex::new(None),
+        })
+    }
+
+    /// Returns the completion handle of a [`HandlerStartMode::Background`] start.
+    ///
+    /// `None` if the client was not started in background mode.
+    pub fn handler_startup(&self) -> Option<HandlerStartup> {
+        lock(&self.startup).clone()
+    }
+
+    /// Returns the health of the handler serving this process.
+    ///
+    /// Reads state the wrapper keeps up to date as the handler starts,
+    /// connects and goes away, so it never blocks or talks to the handler
+    /// and is cheap enough to poll from health checks. The state is
+    /// process-wide: every client reports the same handler. A child forked
+    /// while the handler was running starts out with its parent's state and
+    /// watches the inherited connection from its first call on
+    /// (Linux/Android).
+    ///
+    /// # Example
+    /// ```no_run
+    /// # use crashpad_rs::CrashpadClient;
+    /// # let client = CrashpadClient::new()?;
+    /// let status = client.handler_status();
+    /// if !status.is_alive() {
+    ///     eprintln!("crash handler is {:?}", status.state());
+    /// }
+    /// # Ok::<(), crashpad_rs::CrashpadError>(())
+    /// ```
+    pub fn handler_status(&self) -> HandlerStatus {
+        health::status()
+    }
+
+    /// Returns the background conversion of earlier sessions' crashes
+    /// (iOS only).
+    ///
+    /// `None` unless the client was started with
+    /// [`IntermediateDumpProcessing::Background`] or
+    /// [`IntermediateDumpProcessing::Deferred`].
+    #[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+    pub fn dump_conversion(&self) -> Option<DumpConversion> {
+        lock(&self.dump_conversion).clone()
+    }
+
+    /// Calls `callback` with what changed in the report database each time
+    /// the in-process handler finishes a pass over pending reports (iOS only).
+    ///
+    /// Passes run after the handler starts, after intermediate dumps are
+    /// converted, and after uploads, on Crashpad's upload thread. Reports
+    /// already in the database when the handler starts are not announced.
+    /// Combined with [`CrashDatabase::set_uploads_enabled`], this lets an app
+    /// keep uploads to the windows where it has network and battery to spare.
+    ///
+    /// May be called before or after starting; a later call replaces the
+    /// callback.
+    ///
+    /// # Example
+    /// ```no_run
+    /// # use crashpad_rs::{CrashpadClient, ReportEvent};
+    /// # let client = CrashpadClient::new()?;
+    /// client.observe_reports(|event| {
+    ///     if let ReportEvent::Uploaded(report) = event {
+    ///         println!("uploaded {}", report.uuid());
+    ///     }
+    /// });
+    /// # Ok::<(), crashpad_rs::CrashpadError>(())
+    /// ```
+    #[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+    pub fn observe_reports<F>(&self, callback: F)
+    where
+        F: FnMut(ReportEvent) + Send + 'static,
+    {
+        self.report_observer.set_callback(Box::new(callback));
     }
 
     /// Starts the Crashpad handler with a configuration.
@@ -29,9 +159,35 @@ impl CrashpadClient {
         config: &CrashpadConfig,
         annotations: &HashMap<String, String>,
     ) -> Result<()> {
+        apply_dump_settings(config);
+        if let Some(capture) = config.panic_capture() {
+            panic_hook::install(capture);
+        }
+        if let Some(policy) = config.sampling() {
+            // The first started configuration keeps its policy
+            let _ = self.sampling.set(policy.clone());
+        }
+        let attachments = Arc::new(StagedAttachments::stage(
+            config.attachments(),
+            config.database_path(),
+            config.compress_attachments(),
+        )?);
+        let interval = config.attachment_refresh_interval();
+        *lock(&self.attachment_refresher) = if attachments.is_empty() || interval.is_zero() {
+            None
+        } else {
+            Some(AttachmentRefresher::start(
+                Arc::clone(&attachments),
+                interval,
+            )?)
+        };
+
         // iOS/tvOS/watchOS use in-process handler
         #[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
         {
+            // Empty: staging fails for attachments here
+            *lock(&self.attachments) = Some(attachments);
+
             // Get paths
             let database_path = config.database_path();
             let metrics_path = config.metrics_path();
@@ -50,7 +206,13 @@ impl CrashpadClient {
             // See https://crashpad.chromium.org/bug/23
 
             // For iOS, start in-process handler
-            self.start_in_process_handler(database_path, metrics_path, url, annotations)
+            self.start_in_process_handler(
+                database_path,
+                metrics_path,
+                url,
+                annotations,
+                config.intermediate_dump_processing(),
+            )
         }
 
         #[cfg(not(any(target_os = "ios", target_os = "tvos", target_os = "watchos")))]
@@ -72,15 +234,117 @@ impl CrashpadClient {
                 std::fs::create_dir_all(parent)?;
             }
 
-            self.start_handler_with_arguments(
+            let launch_args = HandlerLaunchArgs::new(
                 &handler_path,
                 database_path,
                 metrics_path,
                 url,
                 annotations,
                 handler_arguments,
-            )
+                &attachments.paths(),
+            )?;
+            *lock(&self.attachments) = Some(attachments);
+
+            match config.handler_start_mode() {
+                #[cfg(any(target_os = "linux", target_os = "android"))]
+                HandlerStartMode::AtCrash => {
+                    launch_args.start(self.handle, crashpad_client_start_handler_at_crash)
+                }
+                #[cfg(any(target_os = "linux", target_os = "android"))]
+                HandlerStartMode::Background => {
+                    self.start_in_background(launch_args, HandlerIsolation::from_config(config))
+                }
+                // Other platforms already start asynchronously or not at all,
+                // so background mode only needs a completed handle
+                #[cfg(not(any(target_os = "linux", target_os = "android")))]
+                HandlerStartMode::Background => {
+                    let result = launch_args.start(self.handle, crashpad_client_start_handler);
+                    #[cfg(target_os = "windows")]
+                    let result = result.and_then(|()| self.register_configured_wer_module(config));
+                    *lock(&self.startup) = Some(HandlerStartup::completed(result.is_ok()));
+                    result
+                }
+                // Lazy start is Linux/Android only, other platforms fall back
+                // to a resident handler
+                _ => {
+                    launch_args.start(self.handle, crashpad_client_start_handler)?;
+                    #[cfg(any(target_os = "linux", target_os = "android"))]
+                    HandlerIsolation::from_config(config)
+                        .apply()
+                        .map_err(CrashpadError::InvalidConfiguration)?;
+                    #[cfg(target_os = "windows")]
+                    self.register_configured_wer_module(config)?;
+                    Ok(())
+                }
+            }
+        }
+    }
+
+    /// Copies the current contents of the configured attachments for the
+    /// handler to attach.
+    ///
+    /// Changed files are also copied in the background, see
+    /// [`crate::CrashpadConfigBuilder::attachment_refresh_interval`]. Call
+    /// this after writing something to an attached file that a report must
+    /// not miss. Each copy is streamed and capped, see
+    /// [`crate::CrashpadConfigBuilder::attachment`].
+    pub fn refresh_attachments(&self) -> Result<()> {
+        match &*lock(&self.attachments) {
+            Some(attachments) => attachments.refresh(),
+            None => Ok(()),
+        }
+    }
+
+    /// Runs the blocking handler spawn and handshake on a helper thread.
+    #[cfg(any(target_os = "linux", target_os = "android"))]
+    fn start_in_background(
+        &self,
+        launch_args: HandlerLaunchArgs,
+        isolation: HandlerIsolation,
+    ) -> Result<()> {
+        let mut startup_thread = lock(&self.startup_thread);
+        if startup_thread
+            .as_ref()
+            .is_some_and(|thread| !thread.is_finished())
+        {
+            return Err(CrashpadError::InvalidConfiguration(
+                "Handler start already in progress".to_string(),
+            ));
+        }
+        // An earlier start has completed, successful or not, so a retry may
+        // take its place
+        if let Some(thread) = startup_thread.take() {
+            let _ = thread.join();
+        }
+
+        // The helper thread installs the signal handlers and only gets its
+        // own alternate signal stack; set one up for the calling thread too so
+        // stack overflows here are still reported.
+        unsafe {
+            crashpad_client_initialize_signal_stack_for_thread();
         }
+
+        let startup = HandlerStartup::pending();
+        let completion = startup.clone();
+        let client = ClientHandle(self.handle);
+
+        let thread = std::thread::Builder::new()
+            .name("crashpad-start".to_string())
+            .spawn(move || {
+                let client = client;
+                let outcome = match launch_args.start(client.0, crashpad_client_start_handler) {
+                    Ok(()) => match isolation.apply() {
+                        Ok(()) => StartupOutcome::Started,
+                        Err(message) => StartupOutcome::NotIsolated(message),
+                    },
+                    Err(_) => StartupOutcome::Failed,
+                };
+                completion.complete(outcome);
+            })?;
+
+        *startup_thread = Some(thread);
+        *lock(&self.startup) = Some(startup);
+        Ok(())
     }
 
     /// Starts the Crashpad handler process.
@@ -128,76 +392,16 @@ impl CrashpadClient {
         annotations: &HashMap<String, String>,
         handler_arguments: &[String],
     ) -> Result<()> {
-        // Convert paths to C strings
-        let handler_path_c = path_to_cstring(handler_path)?;
-        let database_path_c = path_to_cstring(database_path)?;
-        let metrics_path_c = path_to_cstring(metrics_path)?;
-
-        let url_c = match url {
-            Some(u) => Some(
-                CString::new(u)
-                    .map_err(|_| CrashpadError::InvalidConfiguration("Invalid URL".to_string()))?,
-            ),
-            None => None,
-        };
-
-        // Convert annotations to C-compatible arrays
-        let mut keys: Vec<CString> = Vec::new();
-        let mut values: Vec<CString> = Vec::new();
-
-        for (k, v) in annotations {
-            keys.push(CString::new(k.as_str()).map_err(|_| {
-                CrashpadError::InvalidConfiguration("Invalid annotation key".to_string())
-            })?);
-            values.push(CString::new(v.as_str()).map_err(|_| {
-                CrashpadError::InvalidConfiguration("Invalid annotation value".to_string())
-            })?);
-        }
-
-        // Convert to raw pointers
-        let keys_ptrs: Vec<*const std::os::raw::c_char> = keys.iter().map(|k| k.as_ptr()).collect();
-        let values_ptrs: Vec<*const std::os::raw::c_char> =
-            values.iter().map(|v| v.as_ptr()).collect();
-
-        // Convert handler arguments to C strings
-        let handler_args: Vec<CString> = handler_arguments
-            .iter()
-            .map(|arg| {
-                CString::new(arg.as_str()).map_err(|_| {
-                    CrashpadError::InvalidConfiguration(
-                        "Handler argument contains null byte".to_string(),
-                    )
-                })
-            })
-            .collect::<Result<Vec<_>>>()?;
-
-        let handler_args_ptrs: Vec<*const std::os::raw::c_char> =
-            handler_args.iter().map(|arg| arg.as_ptr()).collect();
-
-        let success = unsafe {
-            crashpad_client_start_handler(
-                self.handle,
-                handler_path_c.as_ptr(),
-                database_path_c.as_ptr(),
-                metrics_path_c.as_ptr(),
-                url_c.as_ref().map_or(ptr::null(), |u| u.as_ptr()),
-                keys_ptrs.as_ptr() as *mut *const std::os::raw::c_char,
-                values_ptrs.as_ptr() as *mut *const std::os::raw::c_char,
-                annotations.len(),
-                if handler_args_ptrs.is_empty() {
-                    ptr::null_mut()
-                } else {
-                    handler_args_ptrs.as_ptr() as *mut *const std::os::raw::c_char
-                },
-                handler_args_ptrs.len(),
-            )
-        };
-
-        if success {
-            Ok(())
-        } else {
-            Err(CrashpadError::HandlerStartFailed)
-        }
+        HandlerLaunchArgs::new(
+            handler_path,
+            database_path,
+            metrics_path,
+            url,
+            annotations,
+            handler_arguments,
+            &[],
+        )?
+        .start(self.handle, crashpad_client_start_handler)
     }
 
     /// Starts the in-process handler (iOS/tvOS/watchOS only).
@@ -208,11 +412,24 @@ impl CrashpadClient {
         metrics_path: &Path,
         url: Option<&str>,
         annotations: &HashMap<String, String>,
+        processing: IntermediateDumpProcessing,
     ) -> Result<()> {
         // Convert paths to C strings
         let database_path_c = path_to_cstring(database_path)?;
         let _metrics_path_c = path_to_cstring(metrics_path)?;
 
+        // Starting the handler adds this session's dump to the same
+        // directory, so earlier sessions' dumps are listed first
+        let (budget, deferred) = match processing {
+            IntermediateDumpProcessing::Immediate => (None, false),
+            IntermediateDumpProcessing::Background { budget } => (Some(budget), false),
+            IntermediateDumpProcessing::Deferred { budget } => (Some(budget), true),
+        };
+        let leftovers = match budget {
+            Some(_) => conversion::leftover_intermediate_dumps(database_path),
+            None => Vec::new(),
+        };
+
         let url_c = match url {
             Some(u) => Some(
                 CString::new(u)
@@ -235,9 +452,16 @@ impl CrashpadClient {
         }
 
         // Convert to raw pointers
-        let keys_ptrs: Vec<*const std::os::raw::c_char> = keys.iter().map(|k| k.as_ptr()).collect();
-        let values_ptrs: Vec<*const std::os::raw::c_char> =
-            values.iter().map(|v| v.as_ptr()).collect();
+        let keys_ptrs: Vec<*const c_char> = keys.iter().map(|k| k.as_ptr()).collect();
+        let values_ptrs: Vec<*const c_char> = values.iter().map(|v| v.as_ptr()).collect();
+
+        // Snapshot the database before the first pass can report on it. The
+        // handler keeps its callback for the life of the process, so the
+        // observer it points at is never released.
+        if let Ok(database) = CrashDatabase::open(database_path) {
+            self.report_observer.attach(database);
+        }
+        let observer_context = Arc::into_raw(Arc::clone(&self.report_observer));
 
         // For iOS, we start the in-process handler
         let success = unsafe {
@@ -245,9 +469,11 @@ impl CrashpadClient {
                 self.handle,
                 database_path_c.as_ptr(),
                 url_c.as_ref().map_or(ptr::null(), |u| u.as_ptr()),
-                keys_ptrs.as_ptr() as *mut *const std::os::raw::c_char,
-                values_ptrs.as_ptr() as *mut *const std::os::raw::c_char,
+                keys_ptrs.as_ptr() as *mut *const c_char,
+                values_ptrs.as_ptr() as *mut *const c_char,
                 annotations.len(),
+                Some(observer::pending_reports_processed),
+                observer_context as *mut c_void,
             )
         };
 
@@ -259,9 +485,18 @@ impl CrashpadClient {
 
             // Then process any intermediate dumps from previous sessions
             // This needs to be called after StartProcessingPendingReports
-            unsafe {
-                crashpad_rs_sys::crashpad_client_process_intermediate_dumps();
+            let Some(budget) = budget else {
+                unsafe {
+                    crashpad_rs_sys::crashpad_client_process_intermediate_dumps();
+                }
+                return Ok(());
+            };
+
+            let conversion = DumpConversion::new(leftovers, budget, Box::new(InProcessConverter));
+            if !deferred {
+                conversion.start()?;
             }
+            *lock(&self.dump_conversion) = Some(conversion);
             Ok(())
         } else {
             Err(CrashpadError::HandlerStartFailed)
@@ -285,6 +520,121 @@ impl CrashpadClient {
         }
     }
 
+    /// Registers the Crashpad WER module at `path` (Windows only).
+    ///
+    /// Lets Windows Error Reporting hand fast-fail and stack overflow
+    /// crashes to the handler, which dumps the process from outside. Call
+    /// after the handler has started or [`set_handler_ipc_pipe`] succeeded,
+    /// or configure it with [`crate::CrashpadConfigBuilder::wer_module`],
+    /// which also describes the registry entry WER requires.
+    ///
+    /// [`set_handler_ipc_pipe`]: Self::set_handler_ipc_pipe
+    #[cfg(target_os = "windows")]
+    pub fn register_wer_module<P: AsRef<Path>>(&self, path: P) -> Result<()> {
+        use std::os::windows::ffi::OsStrExt;
+
+        let path = path.as_ref();
+        let wide: Vec<u16> = path.as_os_str().encode_wide().chain(Some(0)).collect();
+
+        let success = unsafe { crashpad_client_register_wer_module(self.handle, wide.as_ptr()) };
+
+        if success {
+            Ok(())
+        } else {
+            Err(CrashpadError::InvalidConfiguration(format!(
+                "Failed to register WER module {}",
+                path.display()
+            )))
+        }
+    }
+
+    #[cfg(target_os = "windows")]
+    fn register_configured_wer_module(&self, config: &CrashpadConfig) -> Result<()> {
+        match config.wer_module() {
+            Some(module) => self.register_wer_module(module),
+            None => Ok(()),
+        }
+    }
+
+    /// Returns the connection to the handler started by this process (Linux/Android only).
+    ///
+    /// Children created with `fork()` inherit this connection automatically,
+    /// so a prefork server only needs to start the handler once in the
+    /// parent; their [`CrashpadClient::handler_status`] follows it too. Children that `exec` have to be handed a descriptor from
+    /// [`HandlerSocket::dup_inheritable`] and attach with
+    /// [`CrashpadClient::set_handler_socket`].
+    #[cfg(any(target_os = "linux", target_os = "android"))]
+    pub fn handler_socket(&self) -> Result<HandlerSocket> {
+        let mut fd = -1;
+        let mut pid = -1;
+        let success = unsafe { crashpad_client_get_handler_socket(&mut fd, &mut pid) };
+
+        if success {
+            Ok(HandlerSocket { fd, pid })
+        } else {
+            Err(CrashpadError::HandlerStartFailed)
+        }
+    }
+
+    /// Attaches to a handler that is already running (Linux/Android only).
+    ///
+    /// Installs the crash signal handlers and reports crashes over `socket`
+    /// without spawning a handler process. `handler_pid` may be `None`, in
+    /// which case the pid is queried from the handler.
+    ///
+    /// Only call this in a process that has not started or inherited a
+    /// handler: forked children are already connected.
+    #[cfg(any(target_os = "linux", target_os = "android"))]
+    pub fn set_handler_socket(&self, socket: OwnedFd, handler_pid: Option<i32>) -> Result<()> {
+        // Crashpad takes ownership of the descriptor
+        let success = unsafe {
+            crashpad_client_set_handler_socket(
+                self.handle,
+                socket.into_raw_fd(),
+                handler_pid.unwrap_or(-1),
+            )
+        };
+
+        if success {
+            Ok(())
+        } else {
+            Err(CrashpadError::HandlerStartFailed)
+        }
+    }
+
+    /// Installs a handler that sees crash signals before Crashpad does
+    /// (Linux/Android only).
+    ///
+    /// Signals the application handles itself, such as guard-page faults in
+    /// a JIT or garbage collector, then return straight to the faulting code
+    /// without any dump being requested. `None` removes the handler. Applies
+    /// to the whole process, not just this client.
+    ///
+    /// Crashpad consults the handler from its signal handler, which a start
+    /// or attach installs. A handler set before that is kept and takes
+    /// effect when any client in the process starts or attaches.
+    ///
+    /// # Example
+    /// ```no_run
+    /// use crashpad_rs::{CrashpadClient, SignalInfo};
+    ///
+    /// fn is_guard_page(address: usize) -> bool {
+    ///     // Check the runtime's guard page table without allocating
+    ///     # let _ = address;
+    ///     false
+    /// }
+    ///
+    /// fn first_chance(info: &SignalInfo) -> bool {
+    ///     info.signal() == libc::SIGSEGV && is_guard_page(info.fault_address())
+    /// }
+    ///
+    /// CrashpadClient::set_first_chance_handler(Some(first_chance));
+    /// ```
+    #[cfg(any(target_os = "linux", target_os = "android"))]
+    pub fn set_first_chance_handler(handler: Option<FirstChanceHandler>) {
+        first_chance::set_handler(handler);
+    }
+
     /// Sets the handler Mach service (macOS/iOS only).
     #[cfg(any(target_os = "macos", target_os = "ios"))]
     pub fn set_handler_mach_service(&self, service_name: &str) -> Result<()> {
@@ -296,12 +646,117 @@ impl CrashpadClient {
         };
 
         if success {
+            // Remembered so the connection can be exported as a HandlerToken
+            #[cfg(target_os = "macos")]
+            {
+                *lock(&self.mach_service) = Some(service_name.to_string());
+            }
             Ok(())
         } else {
             Err(CrashpadError::HandlerStartFailed)
         }
     }
 
+    /// Exports a token other processes can use to attach to this handler.
+    ///
+    /// Pass the token's string form to a child process (see
+    /// [`HandlerToken::ENV_VAR`]) and call [`CrashpadClient::attach`] there,
+    /// so a multi-process application runs a single handler.
+    ///
+    /// # Platform Behavior
+    /// - **Windows**: The handler's IPC pipe name
+    /// - **Linux/Android**: A new inheritable duplicate of the handler socket.
+    ///   The descriptor stays open for the lifetime of the process so that
+    ///   children spawned later can inherit it; export once and reuse it.
+    /// - **macOS**: The Mach service name set with
+    ///   [`CrashpadClient::set_handler_mach_service`]. A handler started with
+    ///   `start_with_config` has no bootstrap name; children inherit its
+    ///   exception ports automatically and need no token.
+    /// - **iOS/tvOS/watchOS**: Not supported (in-process handler)
+    pub fn export_handler_token(&self) -> Result<HandlerToken> {
+        #[cfg(target_os = "windows")]
+        {
+            use std::ffi::OsString;
+            use std::os::windows::ffi::OsStringExt;
+
+            let len =
+                unsafe { crashpad_client_get_handler_ipc_pipe(self.handle, ptr::null_mut(), 0) };
+            if len == 0 {
+                return Err(CrashpadError::HandlerStartFailed);
+            }
+
+            let mut buffer = vec![0u16; len + 1];
+            let copied = unsafe {
+                crashpad_client_get_handler_ipc_pipe(self.handle, buffer.as_mut_ptr(), buffer.len())
+            };
+            buffer.truncate(copied);
+
+            let name = OsString::from_wide(&buffer).into_string().map_err(|_| {
+                CrashpadError::InvalidConfiguration("Invalid IPC pipe name".to_string())
+            })?;
+            Ok(HandlerToken::new(TokenKind::Pipe(name)))
+        }
+
+        #[cfg(any(target_os = "linux", target_os = "android"))]
+        {
+            let socket = self.handler_socket()?;
+            let fd = socket.dup_inheritable()?.into_raw_fd();
+            Ok(HandlerToken::new(TokenKind::Socket {
+                fd,
+                pid: socket.pid(),
+            }))
+        }
+
+        #[cfg(target_os = "macos")]
+        {
+            lock(&self.mach_service)
+                .clone()
+                .map(|name| HandlerToken::new(TokenKind::MachService(name)))
+                .ok_or_else(|| {
+                    CrashpadError::InvalidConfiguration(
+                        "Handler has no Mach service name; child processes inherit its exception ports"
+                            .to_string(),
+                    )
+                })
+        }
+
+        #[cfg(not(any(
+            target_os = "windows",
+            target_os = "linux",
+            target_os = "android",
+            target_os = "macos"
+        )))]
+        {
+            Err(CrashpadError::InvalidConfiguration(
+                "Handler tokens are not supported on this platform".to_string(),
+            ))
+        }
+    }
+
+    /// Connects to the handler referenced by `token` without launching one.
+    ///
+    /// Returns `InvalidConfiguration` if the token was exported on a different
+    /// platform.
+    pub fn attach(&self, token: &HandlerToken) -> Result<()> {
+        match token.kind() {
+            #[cfg(target_os = "windows")]
+            TokenKind::Pipe(name) => self.set_handler_ipc_pipe(name),
+            #[cfg(target_os = "macos")]
+            TokenKind::MachService(name) => self.set_handler_mach_service(name),
+            #[cfg(any(target_os = "linux", target_os = "android"))]
+            TokenKind::Socket { fd, pid } => {
+                // SAFETY: the token names a descriptor inherited from the
+                // exporting process; ownership passes to Crashpad.
+                let socket = unsafe { OwnedFd::from_raw_fd(*fd) };
+                self.set_handler_socket(socket, Some(*pid))
+            }
+            #[allow(unreachable_patterns)]
+            _ => Err(CrashpadError::InvalidConfiguration(format!(
+                "Handler token {token} is not usable on this platform"
+            ))),
+        }
+    }
+
     /// Use system default crash handler (macOS only).
     #[cfg(target_os = "macos")]
     pub fn use_system_default_handler(&self) -> Result<()> {
@@ -355,15 +810,160 @@ impl CrashpadClient {
     ///
     /// A handler must have been installed before calling this method.
     /// The captured context will be from the point where this function is called.
-    pub fn dump_without_crash(&self) {
-        unsafe {
-            crashpad_rs_sys::crashpad_dump_without_crash();
+    ///
+    /// # Concurrency
+    ///
+    /// Only one dump is taken at a time. When another thread's dump is in
+    /// flight, the configured [`DumpPolicy`](crate::DumpPolicy) decides
+    /// whether this call waits for its own dump, shares the in-flight one or
+    /// returns without a dump; the returned [`DumpOutcome`] says which
+    /// happened.
+    pub fn dump_without_crash(&self) -> DumpOutcome {
+        let mut timing = crashpad_dump_timing_t {
+            wait_ns: 0,
+            capture_ns: 0,
+            request_ns: 0,
+        };
+        let outcome = DumpOutcome::from_raw(unsafe {
+            crashpad_rs_sys::crashpad_dump_without_crash_timed(&mut timing)
+        });
+        if outcome == DumpOutcome::Dumped {
+            latency::record(
+                Duration::from_nanos(timing.wait_ns),
+                Duration::from_nanos(timing.capture_ns),
+                Duration::from_nanos(timing.request_ns),
+            );
+        }
+        outcome
+    }
+
+    /// Latency of the diagnostic dumps this process has taken since it
+    /// started
+    ///
+    /// Covers [`CrashpadClient::dump_without_crash`] and its sampled and
+    /// throttled variants, and [`crate::AsyncDumper`] dumps, from every
+    /// client. See [`DumpLatency`] for what each phase measures.
+    pub fn dump_latency() -> DumpLatency {
+        latency::snapshot()
+    }
+
+    /// Leaves `len` bytes at `address` out of crash dumps.
+    ///
+    /// Meant for large buffers that are useless in a dump, such as caches,
+    /// tensor buffers and allocator arenas. It takes a lock and, on
+    /// Linux/Android, makes an `madvise` call for each run of pages not
+    /// already excluded, so an allocator can call it for every arena it
+    /// maps. The memory itself is never touched. Remove the exclusion with
+    /// [`CrashpadClient::remove_excluded_memory_range`] before the memory is
+    /// unmapped or reused.
+    ///
+    /// An exclusion covers only these two things:
+    /// - extra memory ranges, such as a registered
+    ///   [`BreadcrumbBuffer`](crate::BreadcrumbBuffer): the overlapping part
+    ///   is not captured
+    /// - kernel core dumps (Linux/Android): whole pages in the range are
+    ///   marked `MADV_DONTDUMP` while an exclusion covers them. Removing the
+    ///   last exclusion over a page marks it `MADV_DODUMP` again; pages no
+    ///   exclusion covered are never touched
+    ///
+    /// It does not change what Crashpad captures itself: the handler has no
+    /// exclusion hook, so thread stacks are captured in full, and heap memory
+    /// referenced from them is gathered by the handler and can still reach
+    /// excluded memory. Turn that off or bound it with
+    /// [`gather_indirect_memory`](crate::CrashpadConfigBuilder::gather_indirect_memory).
+    ///
+    /// # Example
+    /// ```no_run
+    /// # use crashpad_rs::CrashpadClient;
+    /// let cache = vec![0u8; 1 << 30];
+    /// CrashpadClient::exclude_memory_range(cache.as_ptr(), cache.len())?;
+    /// // ...
+    /// CrashpadClient::remove_excluded_memory_range(cache.as_ptr(), cache.len());
+    /// drop(cache);
+    /// # Ok::<(), crashpad_rs::CrashpadError>(())
+    /// ```
+    ///
+    /// # Errors
+    /// Returns `InvalidConfiguration` if `len` is 0 or 256 ranges are
+    /// already excluded.
+    pub fn exclude_memory_range(address: *const u8, len: usize) -> Result<()> {
+        if unsafe { crashpad_exclude_memory_range(address.cast(), len) } {
+            Ok(())
+        } else if len == 0 {
+            Err(CrashpadError::InvalidConfiguration(
+                "Excluded memory range is empty".to_string(),
+            ))
+        } else {
+            Err(CrashpadError::InvalidConfiguration(
+                "Too many excluded memory ranges".to_string(),
+            ))
+        }
+    }
+
+    /// Drops an exclusion added with
+    /// [`CrashpadClient::exclude_memory_range`] with the same address and
+    /// length.
+    ///
+    /// Returns `false` if the range was not excluded.
+    pub fn remove_excluded_memory_range(address: *const u8, len: usize) -> bool {
+        unsafe { crashpad_remove_excluded_memory_range(address.cast(), len) }
+    }
+
+    /// Capture a diagnostic dump if the configured sampling policy selects it
+    ///
+    /// `signature` identifies the failure for per-signature sample rates (see
+    /// [`SamplingPolicy`]). A call that is not sampled returns `false`
+    /// without capturing context or contacting the handler. Without a
+    /// policy in the started configuration every call is sampled.
+    pub fn dump_without_crash_sampled(&self, signature: &str) -> bool {
+        let sampled = match self.sampling.get() {
+            Some(policy) => policy.should_sample(signature),
+            None => true,
+        };
+        if sampled {
+            self.dump_without_crash();
+        }
+        sampled
+    }
+
+    /// Capture a diagnostic dump unless `throttle` rejects it
+    ///
+    /// Repeats from the same call site are deduplicated within the
+    /// throttle's dedup window. A rejected dump costs a clock read and a few
+    /// atomic operations. Returns whether a dump was taken.
+    #[track_caller]
+    pub fn dump_without_crash_throttled(&self, throttle: &DumpThrottle) -> bool {
+        let allowed = throttle.allow();
+        if allowed {
+            self.dump_without_crash();
+        }
+        allowed
+    }
+
+    /// Capture a diagnostic dump unless `throttle` rejects it, deduplicating
+    /// on `key` instead of the call site
+    ///
+    /// Use a key such as an error code when one call site reports several
+    /// distinct failures. Returns whether a dump was taken.
+    pub fn dump_without_crash_keyed<K: Hash + ?Sized>(
+        &self,
+        throttle: &DumpThrottle,
+        key: &K,
+    ) -> bool {
+        let allowed = throttle.allow_keyed(key);
+        if allowed {
+            self.dump_without_crash();
         }
+        allowed
     }
 }
 
 impl Drop for CrashpadClient {
     fn drop(&mut self) {
+        // A background start still uses the handle, finish it first
+        if let Some(thread) = lock(&self.startup_thread).take() {
+            let _ = thread.join();
+        }
         unsafe {
             crashpad_client_delete(self.handle);
         }
@@ -374,7 +974,392 @@ impl Drop for CrashpadClient {
 unsafe impl Send for CrashpadClient {}
 unsafe impl Sync for CrashpadClient {}
 
-fn path_to_cstring(path: &Path) -> Result<CString> {
+/// Completion handle for a handler started with [`HandlerStartMode::Background`].
+///
+/// Cloning the handle is cheap; all clones observe the same startup.
+#[derive(Clone)]
+pub struct HandlerStartup {
+    state: Arc<(Mutex<Option<StartupOutcome>>, Condvar)>,
+}
+
+/// How a handler start ended
+#[derive(Debug, Clone, PartialEq, Eq)]
+#[cfg_attr(
+    any(target_os = "ios", target_os = "tvos", target_os = "watchos"),
+    allow(dead_code)
+)]
+enum StartupOutcome {
+    Started,
+    Failed,
+    /// Running, but the isolation settings were not all applied
+    #[cfg_attr(not(any(target_os = "linux", target_os = "android")), allow(dead_code))]
+    NotIsolated(String),
+}
+
+impl HandlerStartup {
+    fn pending() -> Self {
+        HandlerStartup {
+            state: Arc::new((Mutex::new(None), Condvar::new())),
+        }
+    }
+
+    #[cfg(not(any(target_os = "linux", target_os = "android")))]
+    fn completed(success: bool) -> Self {
+        let startup = Self::pending();
+        startup.complete(if success {
+            StartupOutcome::Started
+        } else {
+            StartupOutcome::Failed
+        });
+        startup
+    }
+
+    fn complete(&self, outcome: StartupOutcome) {
+        let (result, cond) = &*self.state;
+        *lock(result) = Some(outcome);
+        cond.notify_all();
+    }
+
+    /// Returns `true` once the handshake with the handler has finished.
+    pub fn is_complete(&self) -> bool {
+        lock(&self.state.0).is_some()
+    }
+
+    /// Blocks until the handler has started.
+    ///
+    /// Returns `InvalidConfiguration` if the handler is running but some of
+    /// its isolation settings, such as
+    /// [`handler_nice`](crate::CrashpadConfigBuilder::handler_nice), could
+    /// not be applied.
+    pub fn wait(&self) -> Result<()> {
+        let (result, cond) = &*self.state;
+        let mut guard = lock(result);
+        while guard.is_none() {
+            guard = cond.wait(guard).unwrap_or_else(|e| e.into_inner());
+        }
+        startup_result(guard.clone())
+    }
+
+    /// Blocks for at most `timeout` waiting for the handler to start.
+    ///
+    /// Returns `None` if the startup is still in progress.
+    pub fn wait_timeout(&self, timeout: Duration) -> Option<Result<()>> {
+        let (result, cond) = &*self.state;
+        let guard = lock(result);
+        let (guard, _) = cond
+            .wait_timeout_while(guard, timeout, |r| r.is_none())
+            .unwrap_or_else(|e| e.into_inner());
+        guard.clone().map(|outcome| startup_result(Some(outcome)))
+    }
+}
+
+impl std::fmt::Debug for HandlerStartup {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("HandlerStartup")
+            .field("result", &*lock(&self.state.0))
+            .finish()
+    }
+}
+
+fn startup_result(result: Option<StartupOutcome>) -> Result<()> {
+    match result {
+        Some(StartupOutcome::Started) => Ok(()),
+        Some(StartupOutcome::NotIsolated(message)) => {
+            Err(CrashpadError::InvalidConfiguration(message))
+        }
+        _ => Err(CrashpadError::HandlerStartFailed),
+    }
+}
+
+/// Connection to a running handler (Linux/Android only).
+///
+/// The descriptor is owned by Crashpad and stays valid while the handler
+/// connection of this process is alive.
+#[cfg(any(target_os = "linux", target_os = "android"))]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct HandlerSocket {
+    fd: RawFd,
+    pid: i32,
+}
+
+#[cfg(any(target_os = "linux", target_os = "android"))]
+impl HandlerSocket {
+    /// Socket descriptor connected to the handler.
+    pub fn fd(&self) -> RawFd {
+        self.fd
+    }
+
+    /// Process id of the handler.
+    pub fn pid(&self) -> i32 {
+        self.pid
+    }
+
+    /// Duplicates the socket without close-on-exec.
+    ///
+    /// The new descriptor is inherited across `exec`, so its number can be
+    /// passed to a child (e.g. through an environment variable) which then
+    /// attaches with [`CrashpadClient::set_handler_socket`].
+    pub fn dup_inheritable(&self) -> Result<OwnedFd> {
+        let fd = unsafe { crashpad_handler_socket_dup_inheritable(self.fd) };
+        if fd < 0 {
+            return Err(std::io::Error::last_os_error().into());
+        }
+        // SAFETY: `fd` is a freshly duplicated descriptor owned by nobody else
+        Ok(unsafe { OwnedFd::from_raw_fd(fd) })
+    }
+}
+
+/// Scheduling and cgroup settings for the handler process (Linux/Android only)
+#[cfg(any(target_os = "linux", target_os = "android"))]
+struct HandlerIsolation {
+    nice: Option<i32>,
+    io_priority: Option<IoPriority>,
+    cpus: Vec<c_int>,
+    cgroup: Option<PathBuf>,
+}
+
+#[cfg(any(target_os = "linux", target_os = "android"))]
+impl HandlerIsolation {
+    fn from_config(config: &CrashpadConfig) -> Self {
+        HandlerIsolation {
+            nice: config.handler_nice(),
+            io_priority: config.handler_io_priority(),
+            cpus: config
+                .handler_cpu_affinity()
+                .iter()
+                .filter_map(|&cpu| c_int::try_from(cpu).ok())
+                .collect(),
+            cgroup: config.handler_cgroup().map(Path::to_path_buf),
+        }
+    }
+
+    /// Applies the settings to the connected handler.
+    ///
+    /// Every setting is tried; the error names the ones the system refused.
+    /// The handler keeps running either way.
+    fn apply(&self) -> std::result::Result<(), String> {
+        if self.nice.is_none()
+            && self.io_priority.is_none()
+            && self.cpus.is_empty()
+            && self.cgroup.is_none()
+        {
+            return Ok(());
+        }
+        let pid = unsafe { crashpad_client_get_handler_pid() };
+        if pid <= 0 {
+            return Err(
+                "Handler settings not applied: the handler process id is unknown".to_string(),
+            );
+        }
+
+        let mut failures = Vec::new();
+        // Join the cgroup first, so the affinity is set within its cpuset
+        if let Some(cgroup) = &self.cgroup {
+            if let Err(e) = std::fs::write(cgroup.join("cgroup.procs"), pid.to_string()) {
+                failures.push(format!("cgroup {} ({e})", cgroup.display()));
+            }
+        }
+        if let Some(nice) = self.nice {
+            if !unsafe { crashpad_process_set_nice(pid, nice) } {
+                failures.push(format!("nice {nice}"));
+            }
+        }
+        if let Some(priority) = self.io_priority {
+            // Class values from linux/ioprio.h
+            let (class, level) = match priority {
+                IoPriority::BestEffort(level) => (2, c_int::from(level.min(7))),
+                IoPriority::Idle => (3, 0),
+            };
+            if !unsafe { crashpad_process_set_io_priority(pid, class, level) } {
+                failures.push(format!("I/O priority {priority:?}"));
+            }
+        }
+        if !self.cpus.is_empty()
+            && !unsafe { crashpad_process_set_affinity(pid, self.cpus.as_ptr(), self.cpus.len()) }
+        {
+            failures.push(format!("CPU affinity {:?}", self.cpus));
+        }
+
+        if failures.is_empty() {
+            Ok(())
+        } else {
+            Err(format!(
+                "Handler started, but these settings could not be applied: {}",
+                failures.join(", ")
+            ))
+        }
+    }
+}
+
+/// Raw client handle moved to the background start thread.
+#[cfg(any(target_os = "linux", target_os = "android"))]
+struct ClientHandle(crashpad_client_t);
+
+// The client outlives the thread: Drop joins it before deleting the handle
+#[cfg(any(target_os = "linux", target_os = "android"))]
+unsafe impl Send for ClientHandle {}
+
+/// Locks a mutex, ignoring poisoning (state stays consistent across panics).
+fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    mutex.lock().unwrap_or_else(|e| e.into_inner())
+}
+
+/// Apply the config's dump content settings to this process's CrashpadInfo
+fn apply_dump_settings(config: &CrashpadConfig) {
+    if let Some(limit) = config.indirect_memory_limit() {
+        unsafe { crashpad_info_set_gather_indirectly_referenced_memory(limit > 0, limit) };
+    }
+    if let Some(enabled) = config.system_crash_reporter_forwarding() {
+        unsafe { crashpad_info_set_system_crash_reporter_forwarding(enabled) };
+    }
+    latency::set_stamp_annotation(config.dump_latency_annotation());
+    if let Some(policy) = config.dump_policy() {
+        unsafe { crashpad_set_dump_policy(policy.as_raw()) };
+    }
+}
+
+/// Signature shared by the wrapper functions that launch an external handler
+type StartHandlerFn = unsafe extern "C" fn(
+    crashpad_client_t,
+    *const c_char,
+    *const c_char,
+    *const c_char,
+    *const c_char,
+    *mut *const c_char,
+    *mut *const c_char,
+    usize,
+    *mut *const c_char,
+    usize,
+    *mut *const c_char,
+    usize,
+) -> bool;
+
+/// Handler start parameters converted to C strings.
+///
+/// Owns every `CString` so the pointer arrays handed to the wrapper stay
+/// valid for the duration of the call.
+struct HandlerLaunchArgs {
+    handler_path: CString,
+    database_path: CString,
+    metrics_path: CString,
+    url: Option<CString>,
+    annotation_keys: Vec<CString>,
+    annotation_values: Vec<CString>,
+    arguments: Vec<CString>,
+    attachments: Vec<CString>,
+}
+
+impl HandlerLaunchArgs {
+    fn new(
+        handler_path: &Path,
+        database_path: &Path,
+        metrics_path: &Path,
+        url: Option<&str>,
+        annotations: &HashMap<String, String>,
+        handler_arguments: &[String],
+        attachments: &[&Path],
+    ) -> Result<Self> {
+        // Convert paths to C strings
+        let handler_path = path_to_cstring(handler_path)?;
+        let database_path = path_to_cstring(database_path)?;
+        let metrics_path = path_to_cstring(metrics_path)?;
+
+        let url = match url {
+            Some(u) => Some(
+                CString::new(u)
+                    .map_err(|_| CrashpadError::InvalidConfiguration("Invalid URL".to_string()))?,
+            ),
+            None => None,
+        };
+
+        // Convert annotations to C-compatible arrays
+        let mut annotation_keys: Vec<CString> = Vec::with_capacity(annotations.len());
+        let mut annotation_values: Vec<CString> = Vec::with_capacity(annotations.len());
+
+        for (k, v) in annotations {
+            annotation_keys.push(CString::new(k.as_str()).map_err(|_| {
+                CrashpadError::InvalidConfiguration("Invalid annotation key".to_string())
+            })?);
+            annotation_values.push(CString::new(v.as_str()).map_err(|_| {
+                CrashpadError::InvalidConfiguration("Invalid annotation value".to_string())
+            })?);
+        }
+
+        // Convert handler arguments to C strings
+        let arguments = handler_arguments
+            .iter()
+            .map(|arg| {
+                CString::new(arg.as_str()).map_err(|_| {
+                    CrashpadError::InvalidConfiguration(
+                        "Handler argument contains null byte".to_string(),
+                    )
+                })
+            })
+            .collect::<Result<Vec<_>>>()?;
+        let attachments = attachments
+            .iter()
+            .map(|path| path_to_cstring(path))
+            .collect::<Result<Vec<_>>>()?;
+
+        Ok(Self {
+            handler_path,
+            database_path,
+            metrics_path,
+            url,
+            annotation_keys,
+            annotation_values,
+            arguments,
+            attachments,
+        })
+    }
+
+    /// Invokes one of the wrapper start functions with these parameters.
+    fn start(&self, client: crashpad_client_t, start_fn: StartHandlerFn) -> Result<()> {
+        // Convert to raw pointers
+        let keys_ptrs: Vec<*const c_char> =
+            self.annotation_keys.iter().map(|k| k.as_ptr()).collect();
+        let values_ptrs: Vec<*const c_char> =
+            self.annotation_values.iter().map(|v| v.as_ptr()).collect();
+        let args_ptrs: Vec<*const c_char> = self.arguments.iter().map(|a| a.as_ptr()).collect();
+        let attachment_ptrs: Vec<*const c_char> =
+            self.attachments.iter().map(|a| a.as_ptr()).collect();
+
+        // SAFETY: every pointer refers to a CString owned by `self`, which
+        // outlives the call. The wrapper copies the strings before returning.
+        let success = unsafe {
+            start_fn(
+                client,
+                self.handler_path.as_ptr(),
+                self.database_path.as_ptr(),
+                self.metrics_path.as_ptr(),
+                self.url.as_ref().map_or(ptr::null(), |u| u.as_ptr()),
+                keys_ptrs.as_ptr() as *mut *const c_char,
+                values_ptrs.as_ptr() as *mut *const c_char,
+                keys_ptrs.len(),
+                if args_ptrs.is_empty() {
+                    ptr::null_mut()
+                } else {
+                    args_ptrs.as_ptr() as *mut *const c_char
+                },
+                args_ptrs.len(),
+                if attachment_ptrs.is_empty() {
+                    ptr::null_mut()
+                } else {
+                    attachment_ptrs.as_ptr() as *mut *const c_char
+                },
+                attachment_ptrs.len(),
+            )
+        };
+
+        if success {
+            Ok(())
+        } else {
+            Err(CrashpadError::HandlerStartFailed)
+        }
+    }
+}
+
+pub(crate) fn path_to_cstring(path: &Path) -> Result<CString> {
     let path_str = path
         .to_str()
         .ok_or_else(|| CrashpadError::InvalidConfiguration("Invalid path".to_string()))?;
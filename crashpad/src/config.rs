@@ -1,8 +1,33 @@
+use crate::attachments::Attachment;
 #[cfg(not(any(target_os = "ios", target_os = "tvos", target_os = "watchos")))]
 use crate::CrashpadError;
-use crate::Result;
+use crate::{DumpPolicy, IntermediateDumpProcessing, PanicCapture, Result, SamplingPolicy};
 use std::env;
 use std::path::{Path, PathBuf};
+use std::time::Duration;
+
+/// How the out-of-process handler is launched
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum HandlerStartMode {
+    /// Spawn a resident handler while starting the client
+    #[default]
+    Eager,
+    /// Only install the crash handlers; the handler process is spawned when a
+    /// crash or dump request happens (Linux/Android only)
+    AtCrash,
+    /// Return from `start_with_config` immediately and finish the handler
+    /// spawn and handshake on a helper thread
+    Background,
+}
+
+/// I/O scheduling class for the handler process (Linux/Android only)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum IoPriority {
+    /// Best-effort class at a level from 0 (highest) to 7 (lowest)
+    BestEffort(u8),
+    /// Only gets disk time when no other process needs it
+    Idle,
+}
 
 /// Configuration for Crashpad client
 #[derive(Debug, Clone)]
@@ -12,6 +37,22 @@ pub struct CrashpadConfig {
     metrics_path: PathBuf,
     url: Option<String>,
     handler_arguments: Vec<String>,
+    handler_start_mode: HandlerStartMode,
+    indirect_memory_limit: Option<u32>,
+    system_crash_reporter_forwarding: Option<bool>,
+    dump_latency_annotation: bool,
+    dump_policy: Option<DumpPolicy>,
+    panic_capture: Option<PanicCapture>,
+    attachments: Vec<Attachment>,
+    compress_attachments: bool,
+    attachment_refresh_interval: Duration,
+    sampling: Option<SamplingPolicy>,
+    handler_nice: Option<i32>,
+    handler_io_priority: Option<IoPriority>,
+    handler_cpu_affinity: Vec<usize>,
+    handler_cgroup: Option<PathBuf>,
+    wer_module: Option<PathBuf>,
+    intermediate_dump_processing: IntermediateDumpProcessing,
 }
 
 impl Default for CrashpadConfig {
@@ -27,6 +68,22 @@ impl Default for CrashpadConfig {
             metrics_path: exe_dir.join("crashpad_metrics"),
             url: None,
             handler_arguments: Vec::new(),
+            handler_start_mode: HandlerStartMode::default(),
+            indirect_memory_limit: None,
+            system_crash_reporter_forwarding: None,
+            dump_latency_annotation: false,
+            dump_policy: None,
+            panic_capture: None,
+            attachments: Vec::new(),
+            compress_attachments: false,
+            attachment_refresh_interval: Duration::from_secs(5),
+            sampling: None,
+            handler_nice: None,
+            handler_io_priority: None,
+            handler_cpu_affinity: Vec::new(),
+            handler_cgroup: None,
+            wer_module: None,
+            intermediate_dump_processing: IntermediateDumpProcessing::default(),
         }
     }
 }
@@ -144,6 +201,75 @@ impl CrashpadConfig {
     pub(crate) fn handler_arguments(&self) -> &[String] {
         &self.handler_arguments
     }
+
+    pub(crate) fn handler_start_mode(&self) -> HandlerStartMode {
+        self.handler_start_mode
+    }
+
+    pub(crate) fn indirect_memory_limit(&self) -> Option<u32> {
+        self.indirect_memory_limit
+    }
+
+    pub(crate) fn system_crash_reporter_forwarding(&self) -> Option<bool> {
+        self.system_crash_reporter_forwarding
+    }
+
+    pub(crate) fn dump_latency_annotation(&self) -> bool {
+        self.dump_latency_annotation
+    }
+
+    pub(crate) fn dump_policy(&self) -> Option<DumpPolicy> {
+        self.dump_policy
+    }
+
+    pub(crate) fn panic_capture(&self) -> Option<PanicCapture> {
+        self.panic_capture
+    }
+
+    pub(crate) fn attachments(&self) -> &[Attachment] {
+        &self.attachments
+    }
+
+    pub(crate) fn compress_attachments(&self) -> bool {
+        self.compress_attachments
+    }
+
+    pub(crate) fn attachment_refresh_interval(&self) -> Duration {
+        self.attachment_refresh_interval
+    }
+
+    pub(crate) fn sampling(&self) -> Option<&SamplingPolicy> {
+        self.sampling.as_ref()
+    }
+
+    pub(crate) fn handler_nice(&self) -> Option<i32> {
+        self.handler_nice
+    }
+
+    pub(crate) fn handler_io_priority(&self) -> Option<IoPriority> {
+        self.handler_io_priority
+    }
+
+    pub(crate) fn handler_cpu_affinity(&self) -> &[usize] {
+        &self.handler_cpu_affinity
+    }
+
+    pub(crate) fn handler_cgroup(&self) -> Option<&Path> {
+        self.handler_cgroup.as_deref()
+    }
+
+    #[cfg_attr(not(target_os = "windows"), allow(dead_code))]
+    pub(crate) fn wer_module(&self) -> Option<&Path> {
+        self.wer_module.as_deref()
+    }
+
+    #[cfg_attr(
+        not(any(target_os = "ios", target_os = "tvos", target_os = "watchos")),
+        allow(dead_code)
+    )]
+    pub(crate) fn intermediate_dump_processing(&self) -> IntermediateDumpProcessing {
+        self.intermediate_dump_processing
+    }
 }
 
 /// Builder for CrashpadConfig
@@ -166,6 +292,11 @@ impl CrashpadConfigBuilder {
     }
 
     /// Set the metrics path
+    ///
+    /// Passed to the handler as its metrics directory. The standalone
+    /// handler is built without Chromium's histogram persistence and leaves
+    /// it empty; [`crate::CrashDatabase::counters`] reports the handler's
+    /// work from the report database instead.
     pub fn metrics_path<P: AsRef<Path>>(mut self, path: P) -> Self {
         self.config.metrics_path = path.as_ref().to_path_buf();
         self
@@ -289,6 +420,318 @@ impl CrashpadConfigBuilder {
         self
     }
 
+    /// Select how the handler process is launched
+    ///
+    /// [`HandlerStartMode::AtCrash`] keeps idle processes free of a resident
+    /// handler: only the signal handlers are installed up front and the
+    /// handler is spawned by the process that crashes or requests a dump.
+    /// Every dump then pays the handler launch, and uploads only happen while
+    /// a handler is running.
+    ///
+    /// [`HandlerStartMode::Background`] keeps a resident handler but takes the
+    /// fork/exec and socket handshake off the launch path. Progress is
+    /// reported through [`crate::CrashpadClient::handler_startup`]. Crashpad installs
+    /// its signal handlers as part of the handshake, so a crash before the
+    /// handshake completes is not captured; use `AtCrash` when coverage from
+    /// the first instruction matters more than a resident handler.
+    ///
+    /// # Platform Behavior
+    /// - **Linux/Android**: `AtCrash` uses Crashpad's `StartHandlerAtCrash`,
+    ///   `Background` starts the handler on a helper thread
+    /// - **macOS/Windows**: `AtCrash` falls back to [`HandlerStartMode::Eager`];
+    ///   `Background` starts the handler as usual (already asynchronous) and
+    ///   reports a completed startup
+    /// - **iOS/tvOS/watchOS**: Ignored (in-process handler)
+    ///
+    /// # Default
+    /// [`HandlerStartMode::Eager`]
+    pub fn handler_start_mode(mut self, mode: HandlerStartMode) -> Self {
+        self.config.handler_start_mode = mode;
+        self
+    }
+
+    /// Capture heap memory referenced from thread stacks, up to `limit_bytes`
+    ///
+    /// Indirect memory makes heap objects reachable from stack pointers
+    /// visible in the debugger, but for processes with many threads it
+    /// dominates dump size, capture time and upload bandwidth. The limit
+    /// bounds the total bytes gathered across all threads; pass `0` to turn
+    /// gathering off explicitly.
+    ///
+    /// Crashpad always captures every thread's stack; there is no per-thread
+    /// stack filter.
+    ///
+    /// # Default
+    /// Not set (Crashpad default: not gathered)
+    pub fn gather_indirect_memory(mut self, limit_bytes: u32) -> Self {
+        self.config.indirect_memory_limit = Some(limit_bytes);
+        self
+    }
+
+    /// Also forward crashes to the system crash reporter
+    ///
+    /// # Platform Behavior
+    /// - **macOS**: ReportCrash also produces a report
+    /// - **Windows**: Windows Error Reporting also handles the crash
+    /// - **Linux/Android/iOS**: No system crash reporter; ignored
+    ///
+    /// # Default
+    /// Not set (Crashpad default)
+    pub fn system_crash_reporter_forwarding(mut self, enabled: bool) -> Self {
+        self.config.system_crash_reporter_forwarding = Some(enabled);
+        self
+    }
+
+    /// Stamp diagnostic dump latency into a `crashpad_dump_latency_us`
+    /// annotation
+    ///
+    /// After every timed dump (see [`crate::DumpLatency`]) the annotation is
+    /// updated with the count and the last, p50, p99 and max total latency
+    /// in microseconds, so later reports, including crashes, show what dumps
+    /// of this process cost. A report never contains its own latency.
+    ///
+    /// # Default
+    /// `false`
+    pub fn dump_latency_annotation(mut self, enabled: bool) -> Self {
+        self.config.dump_latency_annotation = enabled;
+        self
+    }
+
+    /// What a diagnostic dump requested while another thread's dump is in
+    /// flight does, see [`DumpPolicy`]
+    ///
+    /// Process-wide; set by the most recently started configuration that
+    /// sets it.
+    ///
+    /// # Default
+    /// [`DumpPolicy::Queue`]
+    pub fn dump_policy(mut self, policy: DumpPolicy) -> Self {
+        self.config.dump_policy = Some(policy);
+        self
+    }
+
+    /// Attach at most `max_bytes` of the file at `path` to every report
+    ///
+    /// The handler attaches a copy of the file taken with a streaming read,
+    /// keeping the first `max_bytes` bytes or, with `tail_only`, the last
+    /// ones, e.g. the newest lines of a log. Copies are written to this
+    /// process's directory under `staged-attachments` in the database when
+    /// the handler starts, whenever
+    /// [`crate::CrashpadClient::refresh_attachments`] is called, and by a
+    /// background thread when the file's size or modification time changes,
+    /// see [`attachment_refresh_interval`](Self::attachment_refresh_interval).
+    /// A report carries the latest copy, so it can miss what was written to
+    /// the file within the last interval before the crash. A file that does
+    /// not exist yet is attached once it does. A copy that fails when the
+    /// handler starts is reported on stderr and retried later rather than
+    /// failing the start. May be called more than once.
+    ///
+    /// # Platform Behavior
+    /// - **Windows/macOS/Linux/Android**: Attached by the handler
+    /// - **iOS/tvOS/watchOS**: Not supported; starting fails with
+    ///   [`crate::CrashpadError::InvalidConfiguration`]
+    ///
+    /// # Example
+    /// ```rust
+    /// # use crashpad_rs::CrashpadConfig;
+    /// let config = CrashpadConfig::builder()
+    ///     .attachment("/var/log/app.log", 1024 * 1024, true)
+    ///     .attachment("/etc/app/config.toml", 64 * 1024, false)
+    ///     .build();
+    /// ```
+    pub fn attachment<P: AsRef<Path>>(mut self, path: P, max_bytes: u64, tail_only: bool) -> Self {
+        self.config.attachments.push(Attachment::new(
+            path.as_ref().to_path_buf(),
+            max_bytes,
+            tail_only,
+        ));
+        self
+    }
+
+    /// Gzip the copies of [`attachment`](Self::attachment)s
+    ///
+    /// Compressed attachments get a `.gz` suffix in the report.
+    ///
+    /// # Default
+    /// `false`
+    pub fn compress_attachments(mut self, enabled: bool) -> Self {
+        self.config.compress_attachments = enabled;
+        self
+    }
+
+    /// How often the copies of [`attachment`](Self::attachment)s are checked
+    /// for changes
+    ///
+    /// A `crashpad-attachments` thread compares each file's size and
+    /// modification time with its latest copy at this interval and copies
+    /// the files that changed. This bounds how stale an attachment in a
+    /// report can be. `Duration::ZERO` disables the thread, leaving refreshes
+    /// to [`crate::CrashpadClient::refresh_attachments`]. No thread is started
+    /// without attachments.
+    ///
+    /// # Default
+    /// 5 seconds
+    pub fn attachment_refresh_interval(mut self, interval: Duration) -> Self {
+        self.config.attachment_refresh_interval = interval;
+        self
+    }
+
+    /// Capture Rust panics with a panic hook, see [`PanicCapture`]
+    ///
+    /// The hook is installed when the handler is started and wraps the hook
+    /// that was installed before it. It records the panic without
+    /// allocating, so it works when the panic comes from memory
+    /// exhaustion. Installing another hook afterwards replaces it.
+    ///
+    /// # Default
+    /// Not set (panics are not captured)
+    pub fn capture_panics(mut self, capture: PanicCapture) -> Self {
+        self.config.panic_capture = Some(capture);
+        self
+    }
+
+    /// Sample non-fatal dumps taken with
+    /// [`crate::CrashpadClient::dump_without_crash_sampled`]
+    ///
+    /// Crashes are always captured; only explicitly requested dumps are
+    /// subject to sampling.
+    ///
+    /// # Default
+    /// Not set (every dump is taken)
+    pub fn sampling(mut self, policy: SamplingPolicy) -> Self {
+        self.config.sampling = Some(policy);
+        self
+    }
+
+    /// Run the handler at nice value `nice` (-20 to 19, higher is lower
+    /// priority)
+    ///
+    /// Dumping walks the crashed process's memory and writes it to disk. On a
+    /// busy host a lower priority keeps that work from competing with the
+    /// processes that are still serving. Raising the priority above the
+    /// client's own requires privileges.
+    ///
+    /// Like the other handler isolation settings, this is applied to every
+    /// handler thread once the handler has connected. A setting the system
+    /// refuses leaves the handler running as spawned, and the start returns
+    /// [`crate::CrashpadError::InvalidConfiguration`] naming what failed;
+    /// with [`HandlerStartMode::Background`] the error comes from
+    /// [`crate::HandlerStartup::wait`].
+    ///
+    /// # Platform Behavior
+    /// - **Linux/Android**: Applied with `setpriority`; not applied with
+    ///   [`HandlerStartMode::AtCrash`], where the handler only exists during a
+    ///   crash
+    /// - **Other platforms**: Ignored (Crashpad does not expose the handler
+    ///   process)
+    ///
+    /// # Default
+    /// Not set (the handler inherits the client's priority)
+    pub fn handler_nice(mut self, nice: i32) -> Self {
+        self.config.handler_nice = Some(nice.clamp(-20, 19));
+        self
+    }
+
+    /// Run the handler in I/O scheduling class `priority`
+    ///
+    /// [`IoPriority::Idle`] defers dump writes and uploads to idle disk
+    /// time, which suits hosts where latency matters more than how quickly a
+    /// report is written.
+    ///
+    /// # Platform Behavior
+    /// - **Linux/Android**: Applied with `ioprio_set`, like
+    ///   [`handler_nice`](Self::handler_nice); no effect with
+    ///   [`HandlerStartMode::AtCrash`]
+    /// - **Other platforms**: Ignored
+    ///
+    /// # Default
+    /// Not set (the handler inherits the client's I/O priority)
+    pub fn handler_io_priority(mut self, priority: IoPriority) -> Self {
+        self.config.handler_io_priority = Some(priority);
+        self
+    }
+
+    /// Restrict the handler to the given CPU cores
+    ///
+    /// Pinning the handler to housekeeping cores keeps it off the cores that
+    /// latency-sensitive work is pinned to.
+    ///
+    /// # Platform Behavior
+    /// - **Linux/Android**: Applied with `sched_setaffinity`, like
+    ///   [`handler_nice`](Self::handler_nice); no effect with
+    ///   [`HandlerStartMode::AtCrash`]
+    /// - **Other platforms**: Ignored
+    ///
+    /// # Default
+    /// Not set (the handler inherits the client's affinity)
+    pub fn handler_cpu_affinity<I: IntoIterator<Item = usize>>(mut self, cpus: I) -> Self {
+        self.config.handler_cpu_affinity = cpus.into_iter().collect();
+        self
+    }
+
+    /// Move the handler into a cgroup
+    ///
+    /// `cgroup` is the cgroup's directory; a relative path is resolved under
+    /// `/sys/fs/cgroup`. The cgroup must already exist and be writable by the
+    /// client. Its CPU, memory and I/O limits then bound the post-crash work.
+    ///
+    /// # Platform Behavior
+    /// - **Linux/Android**: The handler's pid is written to `cgroup.procs`,
+    ///   like [`handler_nice`](Self::handler_nice); no effect with
+    ///   [`HandlerStartMode::AtCrash`]
+    /// - **Other platforms**: Ignored
+    ///
+    /// # Default
+    /// Not set (the handler stays in the client's cgroup)
+    pub fn handler_cgroup<P: AsRef<Path>>(mut self, cgroup: P) -> Self {
+        self.config.handler_cgroup = Some(Path::new("/sys/fs/cgroup").join(cgroup));
+        self
+    }
+
+    /// Register the Crashpad WER module at `path` once the handler starts
+    ///
+    /// Fast-fail (`__fastfail`) crashes and some stack overflows terminate
+    /// the process without running its exception handler. With the module
+    /// registered, Windows Error Reporting loads it in the WER process and
+    /// it asks the handler to dump the crashed process from outside, so
+    /// nothing runs on the broken thread. The build copies
+    /// `crashpad_wer.dll` next to the handler (`CRASHPAD_WER_MODULE_PATH`).
+    ///
+    /// WER only loads modules listed as a DWORD value named after the DLL's
+    /// full path under
+    /// `HKLM\SOFTWARE\Microsoft\Windows\Windows Error Reporting\RuntimeExceptionHelperModules`
+    /// (or the `HKCU` equivalent), normally written by the installer.
+    ///
+    /// # Platform Behavior
+    /// - **Windows**: Registered with `CrashpadClient::RegisterWerModule`;
+    ///   starting fails if registration does
+    /// - **Other platforms**: Ignored
+    ///
+    /// # Default
+    /// Not set (no WER module)
+    pub fn wer_module<P: AsRef<Path>>(mut self, path: P) -> Self {
+        self.config.wer_module = Some(path.as_ref().to_path_buf());
+        self
+    }
+
+    /// When crashes from earlier sessions are converted to minidumps
+    ///
+    /// [`IntermediateDumpProcessing::Background`] and
+    /// [`IntermediateDumpProcessing::Deferred`] take the conversion off the
+    /// launch path; follow it through
+    /// [`crate::CrashpadClient::dump_conversion`].
+    ///
+    /// # Platform Behavior
+    /// - **iOS/tvOS/watchOS**: Applied by the in-process handler start
+    /// - **Other platforms**: Ignored (the handler writes minidumps directly)
+    ///
+    /// # Default
+    /// [`IntermediateDumpProcessing::Immediate`]
+    pub fn intermediate_dump_processing(mut self, processing: IntermediateDumpProcessing) -> Self {
+        self.config.intermediate_dump_processing = processing;
+        self
+    }
+
     /// Build the configuration
     pub fn build(self) -> CrashpadConfig {
         self.config
@@ -437,6 +880,126 @@ mod tests {
             .contains(&"--no-upload-gzip".to_string()));
     }
 
+    #[test]
+    fn test_handler_start_mode() {
+        let config = CrashpadConfig::default();
+        assert_eq!(config.handler_start_mode(), HandlerStartMode::Eager);
+
+        let config = CrashpadConfig::builder()
+            .handler_start_mode(HandlerStartMode::AtCrash)
+            .build();
+        assert_eq!(config.handler_start_mode(), HandlerStartMode::AtCrash);
+        // Start mode is not passed as a handler argument
+        assert!(config.handler_arguments.is_empty());
+    }
+
+    #[test]
+    fn test_dump_contents() {
+        let config = CrashpadConfig::default();
+        assert_eq!(config.indirect_memory_limit(), None);
+        assert_eq!(config.system_crash_reporter_forwarding(), None);
+        assert!(!config.dump_latency_annotation());
+        assert_eq!(config.dump_policy(), None);
+        assert_eq!(config.panic_capture(), None);
+
+        let config = CrashpadConfig::builder()
+            .gather_indirect_memory(4 * 1024 * 1024)
+            .system_crash_reporter_forwarding(false)
+            .dump_latency_annotation(true)
+            .dump_policy(DumpPolicy::Coalesce)
+            .capture_panics(PanicCapture::Abort)
+            .build();
+        assert_eq!(config.indirect_memory_limit(), Some(4 * 1024 * 1024));
+        assert_eq!(config.system_crash_reporter_forwarding(), Some(false));
+        assert!(config.dump_latency_annotation());
+        assert_eq!(config.dump_policy(), Some(DumpPolicy::Coalesce));
+        assert_eq!(config.panic_capture(), Some(PanicCapture::Abort));
+    }
+
+    #[test]
+    fn test_attachment_config() {
+        let config = CrashpadConfig::default();
+        assert!(config.attachments().is_empty());
+        assert!(!config.compress_attachments());
+        assert_eq!(config.attachment_refresh_interval(), Duration::from_secs(5));
+
+        let config = CrashpadConfig::builder()
+            .attachment("/var/log/app.log", 4096, true)
+            .attachment("config.toml", 512, false)
+            .compress_attachments(true)
+            .attachment_refresh_interval(Duration::from_millis(500))
+            .build();
+        let attachments = config.attachments();
+        assert_eq!(attachments.len(), 2);
+        assert_eq!(attachments[0].path(), Path::new("/var/log/app.log"));
+        assert_eq!(attachments[0].max_bytes(), 4096);
+        assert!(attachments[0].tail_only());
+        assert!(!attachments[1].tail_only());
+        assert!(config.compress_attachments());
+        assert_eq!(
+            config.attachment_refresh_interval(),
+            Duration::from_millis(500)
+        );
+    }
+
+    #[test]
+    fn test_sampling_config() {
+        assert!(CrashpadConfig::default().sampling().is_none());
+
+        let config = CrashpadConfig::builder()
+            .sampling(SamplingPolicy::new(0.1).rate("fatal-ish", 1.0))
+            .build();
+        let policy = config.sampling().unwrap();
+        assert_eq!(policy.rate_for("fatal-ish"), 1.0);
+        assert_eq!(policy.rate_for("other"), 0.1);
+    }
+
+    #[test]
+    fn test_handler_isolation() {
+        let config = CrashpadConfig::default();
+        assert_eq!(config.handler_nice(), None);
+        assert!(config.handler_cpu_affinity().is_empty());
+
+        let config = CrashpadConfig::builder()
+            .handler_nice(40)
+            .handler_io_priority(IoPriority::Idle)
+            .handler_cpu_affinity([0, 1])
+            .handler_cgroup("crashpad")
+            .build();
+        assert_eq!(config.handler_nice(), Some(19));
+        assert_eq!(config.handler_io_priority(), Some(IoPriority::Idle));
+        assert_eq!(config.handler_cpu_affinity(), &[0, 1]);
+        assert_eq!(
+            config.handler_cgroup(),
+            Some(Path::new("/sys/fs/cgroup/crashpad"))
+        );
+
+        // Absolute cgroup paths are used as given
+        let config = CrashpadConfig::builder()
+            .handler_cgroup("/sys/fs/cgroup/system.slice/crashpad")
+            .build();
+        assert_eq!(
+            config.handler_cgroup(),
+            Some(Path::new("/sys/fs/cgroup/system.slice/crashpad"))
+        );
+    }
+
+    #[test]
+    fn test_intermediate_dump_processing() {
+        assert_eq!(
+            CrashpadConfig::default().intermediate_dump_processing(),
+            IntermediateDumpProcessing::Immediate
+        );
+
+        let processing = IntermediateDumpProcessing::Deferred {
+            budget: std::time::Duration::from_millis(200),
+        };
+        let config = CrashpadConfig::builder()
+            .intermediate_dump_processing(processing)
+            .build();
+        assert_eq!(config.intermediate_dump_processing(), processing);
+    }
+
     #[test]
     fn test_handler_arguments_default() {
         // Test that default config has no handler arguments
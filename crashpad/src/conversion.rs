@@ -0,0 +1,431 @@
+use std::fmt;
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+use std::time::{Duration, Instant, SystemTime};
+
+use crate::Result;
+
+/// Directory of the database holding intermediate dumps, as named by the
+/// in-process handler
+const INTERMEDIATE_DUMP_DIR: &str = "pending-serialized-ios-dump";
+
+/// Extension of intermediate dumps still owned by a running process
+const LOCKED_EXTENSION: &str = "locked";
+
+/// When leftover intermediate dumps are converted to minidumps (iOS only)
+///
+/// The in-process handler writes crashes as intermediate dumps, which have to
+/// be converted into minidumps before they can be uploaded. After a crash
+/// loop there can be many of them, and converting them all while starting
+/// delays app launch.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum IntermediateDumpProcessing {
+    /// Convert every leftover dump while starting the handler
+    #[default]
+    Immediate,
+    /// Convert leftover dumps on a low-priority background thread, one per
+    /// step, until `budget` has been spent; the rest wait for the next
+    /// launch
+    Background {
+        /// Total conversion time allowed for this launch
+        budget: Duration,
+    },
+    /// Like `Background`, but only once
+    /// [`DumpConversion::start`] is called, for example after the first
+    /// frame has been drawn
+    Deferred {
+        /// Total conversion time allowed for this launch
+        budget: Duration,
+    },
+}
+
+/// Outcome of a background [`DumpConversion`]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct DumpConversionSummary {
+    converted: usize,
+    remaining: usize,
+    elapsed: Duration,
+}
+
+impl DumpConversionSummary {
+    /// Intermediate dumps converted to minidumps
+    pub fn converted(&self) -> usize {
+        self.converted
+    }
+
+    /// Dumps left for the next launch because the budget ran out
+    pub fn remaining(&self) -> usize {
+        self.remaining
+    }
+
+    /// Time spent converting
+    pub fn elapsed(&self) -> Duration {
+        self.elapsed
+    }
+}
+
+/// Handle to the background conversion of leftover intermediate dumps.
+///
+/// Returned by [`crate::CrashpadClient::dump_conversion`] when the client was
+/// started with [`IntermediateDumpProcessing::Background`] or
+/// [`IntermediateDumpProcessing::Deferred`]. Cloning the handle is cheap; all
+/// clones observe the same conversion.
+#[derive(Clone)]
+pub struct DumpConversion {
+    shared: Arc<Shared>,
+}
+
+struct Shared {
+    state: Mutex<State>,
+    done: Condvar,
+}
+
+type Callback = Box<dyn FnOnce(DumpConversionSummary) + Send>;
+
+struct State {
+    /// Work not yet handed to a thread; taken by `start`
+    job: Option<Job>,
+    summary: Option<DumpConversionSummary>,
+    callbacks: Vec<Callback>,
+}
+
+struct Job {
+    dumps: Vec<PathBuf>,
+    budget: Duration,
+    converter: Box<dyn Converter>,
+}
+
+/// Conversion steps, separated from the handler for testing
+pub(crate) trait Converter: Send + 'static {
+    /// Lowers the priority of the calling (conversion) thread
+    fn lower_priority(&self) {}
+
+    /// Converts one intermediate dump
+    fn convert(&self, dump: &Path);
+
+    /// Runs after every listed dump was converted within budget
+    fn finish(&self) {}
+}
+
+impl DumpConversion {
+    pub(crate) fn new(
+        dumps: Vec<PathBuf>,
+        budget: Duration,
+        converter: Box<dyn Converter>,
+    ) -> Self {
+        DumpConversion {
+            shared: Arc::new(Shared {
+                state: Mutex::new(State {
+                    job: Some(Job {
+                        dumps,
+                        budget,
+                        converter,
+                    }),
+                    summary: None,
+                    callbacks: Vec::new(),
+                }),
+                done: Condvar::new(),
+            }),
+        }
+    }
+
+    /// Starts converting on a background thread.
+    ///
+    /// Only needed with [`IntermediateDumpProcessing::Deferred`]; later
+    /// calls have no effect.
+    pub fn start(&self) -> Result<()> {
+        let Some(job) = lock(&self.shared.state).job.take() else {
+            return Ok(());
+        };
+
+        let shared = Arc::clone(&self.shared);
+        std::thread::Builder::new()
+            .name("crashpad-convert".to_string())
+            .spawn(move || {
+                let summary = job.run();
+                shared.complete(summary);
+            })?;
+        Ok(())
+    }
+
+    /// Calls `callback` with the summary once the conversion has finished.
+    ///
+    /// The callback runs on the conversion thread, or right away on the
+    /// calling thread if the conversion has already finished. Callbacks
+    /// registered before completion have run by the time [`wait`](Self::wait)
+    /// returns or [`is_complete`](Self::is_complete) turns `true`.
+    pub fn on_complete<F>(&self, callback: F)
+    where
+        F: FnOnce(DumpConversionSummary) + Send + 'static,
+    {
+        let mut state = lock(&self.shared.state);
+        match state.summary {
+            Some(summary) => {
+                drop(state);
+                callback(summary);
+            }
+            None => state.callbacks.push(Box::new(callback)),
+        }
+    }
+
+    /// Returns `true` once the conversion has finished.
+    pub fn is_complete(&self) -> bool {
+        lock(&self.shared.state).summary.is_some()
+    }
+
+    /// Blocks until the conversion has finished.
+    ///
+    /// A deferred conversion has to be started first, or this never returns.
+    pub fn wait(&self) -> DumpConversionSummary {
+        let state = lock(&self.shared.state);
+        let state = self
+            .shared
+            .done
+            .wait_while(state, |state| state.summary.is_none())
+            .unwrap_or_else(|e| e.into_inner());
+        state.summary.expect("conversion summary is set")
+    }
+
+    /// Blocks for at most `timeout` waiting for the conversion to finish.
+    ///
+    /// Returns `None` if the conversion is still in progress.
+    pub fn wait_timeout(&self, timeout: Duration) -> Option<DumpConversionSummary> {
+        let state = lock(&self.shared.state);
+        let (state, _) = self
+            .shared
+            .done
+            .wait_timeout_while(state, timeout, |state| state.summary.is_none())
+            .unwrap_or_else(|e| e.into_inner());
+        state.summary
+    }
+}
+
+impl fmt::Debug for DumpConversion {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        let state = lock(&self.shared.state);
+        f.debug_struct("DumpConversion")
+            .field("started", &state.job.is_none())
+            .field("summary", &state.summary)
+            .finish()
+    }
+}
+
+impl Shared {
+    /// Runs the callbacks, then publishes the summary to waiters.
+    fn complete(&self, summary: DumpConversionSummary) {
+        loop {
+            let callbacks = {
+                let mut state = lock(&self.state);
+                if state.callbacks.is_empty() {
+                    state.summary = Some(summary);
+                    break;
+                }
+                std::mem::take(&mut state.callbacks)
+            };
+            // Callbacks registered meanwhile are picked up by the next pass
+            for callback in callbacks {
+                callback(summary);
+            }
+        }
+        self.done.notify_all();
+    }
+}
+
+impl Job {
+    fn run(self) -> DumpConversionSummary {
+        self.converter.lower_priority();
+
+        let started = Instant::now();
+        let total = self.dumps.len();
+        let mut converted = 0;
+        for dump in &self.dumps {
+            // Always make progress, even with a zero budget
+            if converted > 0 && started.elapsed() >= self.budget {
+                break;
+            }
+            self.converter.convert(dump);
+            converted += 1;
+        }
+        if converted == total {
+            self.converter.finish();
+        }
+
+        DumpConversionSummary {
+            converted,
+            remaining: total - converted,
+            elapsed: started.elapsed(),
+        }
+    }
+}
+
+/// Intermediate dumps left by earlier sessions, newest first
+///
+/// Must be listed before the in-process handler starts: it then creates the
+/// current session's dump in the same directory. Dumps still locked by
+/// another running process, such as an app extension, are skipped.
+pub(crate) fn leftover_intermediate_dumps(database_path: &Path) -> Vec<PathBuf> {
+    let Ok(entries) = fs::read_dir(database_path.join(INTERMEDIATE_DUMP_DIR)) else {
+        return Vec::new();
+    };
+
+    let mut dumps: Vec<(SystemTime, PathBuf)> = entries
+        .filter_map(|entry| entry.ok())
+        .filter(|entry| entry.file_type().is_ok_and(|kind| kind.is_file()))
+        .map(|entry| entry.path())
+        .filter(|path| !matches!(path.extension(), Some(ext) if ext == LOCKED_EXTENSION))
+        .map(|path| {
+            let modified = fs::metadata(&path)
+                .and_then(|metadata| metadata.modified())
+                .unwrap_or(SystemTime::UNIX_EPOCH);
+            (modified, path)
+        })
+        .collect();
+    dumps.sort_by(|a, b| b.0.cmp(&a.0));
+    dumps.into_iter().map(|(_, path)| path).collect()
+}
+
+/// Converts through the in-process handler (iOS only)
+#[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+pub(crate) struct InProcessConverter;
+
+#[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+impl Converter for InProcessConverter {
+    fn lower_priority(&self) {
+        unsafe { crashpad_rs_sys::crashpad_thread_set_background_qos() };
+    }
+
+    fn convert(&self, dump: &Path) {
+        if let Ok(path) = crate::client::path_to_cstring(dump) {
+            unsafe { crashpad_rs_sys::crashpad_client_process_intermediate_dump(path.as_ptr()) };
+        }
+    }
+
+    fn finish(&self) {
+        // Picks up dumps that were locked when listed and have since been
+        // released; with nothing left this is only a directory scan
+        unsafe { crashpad_rs_sys::crashpad_client_process_intermediate_dumps() };
+    }
+}
+
+/// Locks a mutex, ignoring poisoning (callbacks run outside the lock).
+fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    mutex.lock().unwrap_or_else(|e| e.into_inner())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+
+    struct Recorder {
+        converted: Arc<Mutex<Vec<PathBuf>>>,
+        finished: Arc<AtomicUsize>,
+        delay: Duration,
+    }
+
+    impl Converter for Recorder {
+        fn convert(&self, dump: &Path) {
+            std::thread::sleep(self.delay);
+            self.converted.lock().unwrap().push(dump.to_path_buf());
+        }
+
+        fn finish(&self) {
+            self.finished.fetch_add(1, Ordering::SeqCst);
+        }
+    }
+
+    fn conversion(
+        count: usize,
+        budget: Duration,
+        delay: Duration,
+    ) -> (DumpConversion, Arc<Mutex<Vec<PathBuf>>>, Arc<AtomicUsize>) {
+        let converted = Arc::new(Mutex::new(Vec::new()));
+        let finished = Arc::new(AtomicUsize::new(0));
+        let dumps = (0..count)
+            .map(|i| PathBuf::from(format!("dump-{i}")))
+            .collect();
+        let recorder = Recorder {
+            converted: Arc::clone(&converted),
+            finished: Arc::clone(&finished),
+            delay,
+        };
+        (
+            DumpConversion::new(dumps, budget, Box::new(recorder)),
+            converted,
+            finished,
+        )
+    }
+
+    #[test]
+    fn test_conversion_within_budget() {
+        let (conversion, converted, finished) =
+            conversion(3, Duration::from_secs(60), Duration::ZERO);
+
+        // Nothing happens until started
+        assert!(conversion.wait_timeout(Duration::from_millis(20)).is_none());
+        conversion.start().unwrap();
+        let summary = conversion.wait();
+
+        assert_eq!(summary.converted(), 3);
+        assert_eq!(summary.remaining(), 0);
+        assert_eq!(converted.lock().unwrap().len(), 3);
+        assert_eq!(finished.load(Ordering::SeqCst), 1);
+        assert!(conversion.is_complete());
+    }
+
+    #[test]
+    fn test_conversion_budget_exhausted() {
+        let (conversion, converted, finished) =
+            conversion(10, Duration::from_millis(25), Duration::from_millis(20));
+        conversion.start().unwrap();
+        let summary = conversion.wait();
+
+        assert!(summary.converted() >= 1 && summary.converted() < 10);
+        assert_eq!(summary.converted() + summary.remaining(), 10);
+        assert_eq!(converted.lock().unwrap()[0], PathBuf::from("dump-0"));
+        // Leftovers wait for the next launch
+        assert_eq!(finished.load(Ordering::SeqCst), 0);
+    }
+
+    #[test]
+    fn test_conversion_callbacks() {
+        let (conversion, _, _) = conversion(2, Duration::from_secs(60), Duration::ZERO);
+        let calls = Arc::new(AtomicUsize::new(0));
+
+        let before = Arc::clone(&calls);
+        conversion.on_complete(move |summary| {
+            assert_eq!(summary.converted(), 2);
+            before.fetch_add(1, Ordering::SeqCst);
+        });
+        conversion.start().unwrap();
+        conversion.start().unwrap();
+        conversion.wait();
+        // Callbacks have run before waiters are released
+        assert_eq!(calls.load(Ordering::SeqCst), 1);
+
+        // Registered after completion: runs immediately
+        let after = Arc::clone(&calls);
+        conversion.on_complete(move |_| {
+            after.fetch_add(1, Ordering::SeqCst);
+        });
+        assert_eq!(calls.load(Ordering::SeqCst), 2);
+    }
+
+    #[test]
+    fn test_leftover_dumps() {
+        let dir = tempfile::TempDir::new().unwrap();
+        assert!(leftover_intermediate_dumps(dir.path()).is_empty());
+
+        let dumps = dir.path().join(INTERMEDIATE_DUMP_DIR);
+        fs::create_dir_all(&dumps).unwrap();
+        fs::write(dumps.join("app@1"), b"").unwrap();
+        fs::write(dumps.join("extension@2.locked"), b"").unwrap();
+        fs::create_dir(dumps.join("subdir")).unwrap();
+
+        assert_eq!(
+            leftover_intermediate_dumps(dir.path()),
+            vec![dumps.join("app@1")]
+        );
+    }
+}
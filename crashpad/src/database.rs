@@ -0,0 +1,576 @@
+use std::ffi::{CStr, CString};
+use std::fmt;
+use std::os::raw::{c_char, c_int};
+use std::path::Path;
+use std::ptr;
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+
+use crate::client::path_to_cstring;
+use crate::{CrashpadError, Result};
+use crashpad_rs_sys::*;
+
+/// Access to the crash report database written by the handler.
+///
+/// Lists, deletes and prunes reports under a client's `database_path`. The
+/// database can be managed while a handler is running; Crashpad coordinates
+/// access between processes.
+///
+/// Listing is a single call into Crashpad that returns the metadata of every
+/// report at once, so managing databases with thousands of reports stays
+/// cheap.
+///
+/// # Example
+/// ```no_run
+/// use std::time::Duration;
+/// use crashpad_rs::{CrashDatabase, RetentionPolicy};
+///
+/// let database = CrashDatabase::open("./crashes")?;
+/// let policy = RetentionPolicy::new()
+///     .max_age(Duration::from_secs(7 * 24 * 60 * 60))
+///     .max_total_size(64 * 1024 * 1024)
+///     .max_count(100);
+/// let removed = database.prune(&policy)?;
+/// # Ok::<(), crashpad_rs::CrashpadError>(())
+/// ```
+pub struct CrashDatabase {
+    handle: crashpad_database_t,
+}
+
+// SAFETY: the database handle may be used from any thread, one at a time.
+unsafe impl Send for CrashDatabase {}
+
+impl CrashDatabase {
+    /// Opens the database at `path`, creating it if it does not exist.
+    pub fn open<P: AsRef<Path>>(path: P) -> Result<Self> {
+        let path = path.as_ref();
+        let path_c = path_to_cstring(path)?;
+
+        let handle = unsafe { crashpad_database_open(path_c.as_ptr()) };
+        if handle.is_null() {
+            return Err(CrashpadError::InvalidConfiguration(format!(
+                "Cannot open crash database at {}",
+                path.display()
+            )));
+        }
+
+        Ok(CrashDatabase { handle })
+    }
+
+    /// All reports, pending and completed
+    pub fn reports(&self) -> Result<Vec<ReportInfo>> {
+        self.list(CRASHPAD_REPORTS_PENDING | CRASHPAD_REPORTS_COMPLETED)
+    }
+
+    /// Reports waiting to be uploaded
+    pub fn pending_reports(&self) -> Result<Vec<ReportInfo>> {
+        self.list(CRASHPAD_REPORTS_PENDING)
+    }
+
+    /// Reports that were uploaded or will not be uploaded
+    pub fn completed_reports(&self) -> Result<Vec<ReportInfo>> {
+        self.list(CRASHPAD_REPORTS_COMPLETED)
+    }
+
+    /// Counters over every report, computed in one pass without listing
+    /// them
+    ///
+    /// Cheap enough to scrape every few seconds: no per-report data crosses
+    /// into Rust. Counts cover the reports currently in the database, so
+    /// they drop when reports are pruned or deleted.
+    pub fn counters(&self) -> Result<DatabaseCounters> {
+        let mut raw = crashpad_database_counters_t {
+            pending: 0,
+            completed: 0,
+            uploaded: 0,
+            upload_requested: 0,
+            upload_failed: 0,
+            upload_skipped: 0,
+            upload_attempts: 0,
+            total_size: 0,
+            last_upload_attempt_time: 0,
+            uploads_enabled: false,
+        };
+        if !unsafe { crashpad_database_get_counters(self.handle, &mut raw) } {
+            return Err(CrashpadError::InvalidConfiguration(
+                "Failed to read crash database".to_string(),
+            ));
+        }
+        Ok(DatabaseCounters::from_raw(&raw))
+    }
+
+    /// Deletes the given reports; returns how many were deleted.
+    ///
+    /// Reports that no longer exist are skipped.
+    pub fn delete<'a, I>(&self, reports: I) -> usize
+    where
+        I: IntoIterator<Item = &'a ReportInfo>,
+    {
+        let mut uuids = uuid_ptrs(reports);
+        if uuids.is_empty() {
+            return 0;
+        }
+
+        unsafe { crashpad_database_delete_reports(self.handle, uuids.as_mut_ptr(), uuids.len()) }
+    }
+
+    /// Enables or disables automatic uploads by the handler.
+    ///
+    /// While uploads are disabled the handler keeps new reports without
+    /// uploading them; [`CrashDatabase::request_upload`] still releases
+    /// individual reports.
+    pub fn set_uploads_enabled(&self, enabled: bool) -> Result<()> {
+        if unsafe { crashpad_database_set_uploads_enabled(self.handle, enabled) } {
+            Ok(())
+        } else {
+            Err(CrashpadError::InvalidConfiguration(
+                "Failed to update crash database settings".to_string(),
+            ))
+        }
+    }
+
+    /// Marks reports for upload, even while uploads are disabled; returns how
+    /// many were marked.
+    ///
+    /// The handler uploads marked reports on its next pass over pending
+    /// reports. Reports that were already uploaded are skipped. Reports
+    /// compressed with [`CrashDatabase::compress`] are restored first.
+    pub fn request_upload<'a, I>(&self, reports: I) -> usize
+    where
+        I: IntoIterator<Item = &'a ReportInfo>,
+    {
+        let mut uuids = uuid_ptrs(reports);
+        if uuids.is_empty() {
+            return 0;
+        }
+
+        unsafe {
+            crashpad_database_decompress_reports(self.handle, uuids.as_mut_ptr(), uuids.len());
+            crashpad_database_request_uploads(self.handle, uuids.as_mut_ptr(), uuids.len())
+        }
+    }
+
+    /// Gzip-compresses the minidumps of reports on disk; returns how many were
+    /// compressed.
+    ///
+    /// Minidumps compress to a fraction of their size, which keeps a database
+    /// that cannot upload (for example on a host cut off from the network)
+    /// from filling the disk. `level` is a zlib level from 0 (fastest) to 9
+    /// (smallest).
+    ///
+    /// The handler parses a minidump before uploading it, so only reports it
+    /// will not upload on its own are compressed: pending reports and reports
+    /// marked for upload are skipped, as are reports already compressed.
+    /// [`CrashDatabase::request_upload`] restores a report before marking it.
+    pub fn compress<'a, I>(&self, reports: I, level: u32) -> usize
+    where
+        I: IntoIterator<Item = &'a ReportInfo>,
+    {
+        let reports = reports
+            .into_iter()
+            .filter(|report| !report.is_pending() && !report.upload_explicitly_requested());
+        let mut uuids = uuid_ptrs(reports);
+        if uuids.is_empty() {
+            return 0;
+        }
+
+        let level = level.min(9) as c_int;
+        unsafe {
+            crashpad_database_compress_reports(self.handle, uuids.as_mut_ptr(), uuids.len(), level)
+        }
+    }
+
+    /// Restores reports compressed with [`CrashDatabase::compress`]; returns
+    /// how many were restored.
+    pub fn decompress<'a, I>(&self, reports: I) -> usize
+    where
+        I: IntoIterator<Item = &'a ReportInfo>,
+    {
+        let mut uuids = uuid_ptrs(reports);
+        if uuids.is_empty() {
+            return 0;
+        }
+
+        unsafe {
+            crashpad_database_decompress_reports(self.handle, uuids.as_mut_ptr(), uuids.len())
+        }
+    }
+
+    /// Deletes reports outside `policy`; returns how many were deleted.
+    ///
+    /// Reports are considered newest first. A report is kept while it is
+    /// within the count limit, younger than the age limit and fits in what
+    /// remains of the size budget. Everything listed is fetched in one call
+    /// and deleted in one call.
+    pub fn prune(&self, policy: &RetentionPolicy) -> Result<usize> {
+        let reports = self.reports()?;
+        let expired = policy.select_expired(reports, SystemTime::now());
+        Ok(self.delete(&expired))
+    }
+
+    /// Removes files left behind by interrupted writes, and locks older than
+    /// `lockfile_ttl`; returns the number of files removed.
+    pub fn clean(&self, lockfile_ttl: Duration) -> usize {
+        let ttl = i64::try_from(lockfile_ttl.as_secs()).unwrap_or(i64::MAX);
+        let removed = unsafe { crashpad_database_clean(self.handle, ttl) };
+        usize::try_from(removed).unwrap_or(0)
+    }
+
+    fn list(&self, sets: u32) -> Result<Vec<ReportInfo>> {
+        let mut reports: *mut crashpad_report_info_t = ptr::null_mut();
+        let mut count = 0;
+
+        let success = unsafe {
+            crashpad_database_list_reports(self.handle, sets as c_int, &mut reports, &mut count)
+        };
+        if !success {
+            return Err(CrashpadError::InvalidConfiguration(
+                "Failed to read crash database".to_string(),
+            ));
+        }
+        if reports.is_null() {
+            return Ok(Vec::new());
+        }
+
+        // SAFETY: the wrapper returned `count` initialized entries
+        let infos = unsafe { std::slice::from_raw_parts(reports, count) }
+            .iter()
+            .map(ReportInfo::from_raw)
+            .collect();
+        unsafe { crashpad_report_list_free(reports) };
+
+        Ok(infos)
+    }
+}
+
+impl Drop for CrashDatabase {
+    fn drop(&mut self) {
+        unsafe { crashpad_database_close(self.handle) };
+    }
+}
+
+impl fmt::Debug for CrashDatabase {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("CrashDatabase").finish_non_exhaustive()
+    }
+}
+
+/// Metadata of one report in a [`CrashDatabase`]
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct ReportInfo {
+    uuid: String,
+    uuid_c: CString,
+    pending: bool,
+    uploaded: bool,
+    upload_explicitly_requested: bool,
+    upload_attempts: u32,
+    creation_time: SystemTime,
+    last_upload_attempt_time: Option<SystemTime>,
+    total_size: u64,
+}
+
+impl ReportInfo {
+    fn from_raw(raw: &crashpad_report_info_t) -> Self {
+        // SAFETY: the wrapper always NUL-terminates the UUID
+        let uuid_c = unsafe { CStr::from_ptr(raw.uuid.as_ptr()) }.to_owned();
+        ReportInfo {
+            uuid: uuid_c.to_string_lossy().into_owned(),
+            uuid_c,
+            pending: raw.pending,
+            uploaded: raw.uploaded,
+            upload_explicitly_requested: raw.upload_explicitly_requested,
+            upload_attempts: u32::try_from(raw.upload_attempts).unwrap_or(0),
+            creation_time: from_unix(raw.creation_time),
+            last_upload_attempt_time: (raw.last_upload_attempt_time > 0)
+                .then(|| from_unix(raw.last_upload_attempt_time)),
+            total_size: raw.total_size,
+        }
+    }
+
+    /// Report UUID, as used in upload and symbolication tooling
+    pub fn uuid(&self) -> &str {
+        &self.uuid
+    }
+
+    /// Whether the report is still waiting for upload
+    pub fn is_pending(&self) -> bool {
+        self.pending
+    }
+
+    /// Whether the report has been uploaded
+    pub fn is_uploaded(&self) -> bool {
+        self.uploaded
+    }
+
+    /// Whether an upload was requested despite uploads being disabled
+    pub fn upload_explicitly_requested(&self) -> bool {
+        self.upload_explicitly_requested
+    }
+
+    /// Number of upload attempts so far
+    pub fn upload_attempts(&self) -> u32 {
+        self.upload_attempts
+    }
+
+    /// When the crash was captured
+    pub fn creation_time(&self) -> SystemTime {
+        self.creation_time
+    }
+
+    /// When an upload was last attempted, if ever
+    pub fn last_upload_attempt_time(&self) -> Option<SystemTime> {
+        self.last_upload_attempt_time
+    }
+
+    /// Bytes the report occupies on disk, including attachments
+    pub fn total_size(&self) -> u64 {
+        self.total_size
+    }
+}
+
+/// Report counters of a [`CrashDatabase`], from [`CrashDatabase::counters`]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct DatabaseCounters {
+    pending: u64,
+    completed: u64,
+    uploaded: u64,
+    upload_requested: u64,
+    upload_failed: u64,
+    upload_skipped: u64,
+    upload_attempts: u64,
+    total_size: u64,
+    last_upload_attempt_time: Option<SystemTime>,
+    uploads_enabled: bool,
+}
+
+impl DatabaseCounters {
+    fn from_raw(raw: &crashpad_database_counters_t) -> Self {
+        DatabaseCounters {
+            pending: raw.pending,
+            completed: raw.completed,
+            uploaded: raw.uploaded,
+            upload_requested: raw.upload_requested,
+            upload_failed: raw.upload_failed,
+            upload_skipped: raw.upload_skipped,
+            upload_attempts: raw.upload_attempts,
+            total_size: raw.total_size,
+            last_upload_attempt_time: (raw.last_upload_attempt_time > 0)
+                .then(|| from_unix(raw.last_upload_attempt_time)),
+            uploads_enabled: raw.uploads_enabled,
+        }
+    }
+
+    /// Reports written by the handler and still in the database
+    pub fn reports(&self) -> u64 {
+        self.pending + self.completed
+    }
+
+    /// Reports waiting for upload
+    pub fn pending(&self) -> u64 {
+        self.pending
+    }
+
+    /// Reports that were uploaded or will not be uploaded
+    pub fn completed(&self) -> u64 {
+        self.completed
+    }
+
+    /// Reports uploaded successfully
+    pub fn uploaded(&self) -> u64 {
+        self.uploaded
+    }
+
+    /// Pending reports whose upload was explicitly requested
+    pub fn upload_requested(&self) -> u64 {
+        self.upload_requested
+    }
+
+    /// Reports given up on after failed upload attempts
+    pub fn upload_failed(&self) -> u64 {
+        self.upload_failed
+    }
+
+    /// Reports completed without an upload attempt, e.g. while uploads were
+    /// disabled
+    pub fn upload_skipped(&self) -> u64 {
+        self.upload_skipped
+    }
+
+    /// Upload attempts over all reports
+    pub fn upload_attempts(&self) -> u64 {
+        self.upload_attempts
+    }
+
+    /// Bytes on disk, including attachments
+    pub fn total_size(&self) -> u64 {
+        self.total_size
+    }
+
+    /// When the handler last attempted an upload, if ever
+    pub fn last_upload_attempt_time(&self) -> Option<SystemTime> {
+        self.last_upload_attempt_time
+    }
+
+    /// Whether the handler uploads reports automatically
+    pub fn uploads_enabled(&self) -> bool {
+        self.uploads_enabled
+    }
+}
+
+/// Borrowed C strings of the reports' UUIDs
+fn uuid_ptrs<'a, I>(reports: I) -> Vec<*const c_char>
+where
+    I: IntoIterator<Item = &'a ReportInfo>,
+{
+    reports
+        .into_iter()
+        .map(|report| report.uuid_c.as_ptr())
+        .collect()
+}
+
+fn from_unix(seconds: i64) -> SystemTime {
+    UNIX_EPOCH + Duration::from_secs(u64::try_from(seconds).unwrap_or(0))
+}
+
+/// Limits on what a [`CrashDatabase`] keeps; unset limits are not enforced
+///
+/// The handler's own periodic pruning (see
+/// [`crate::CrashpadConfigBuilder::periodic_tasks`]) applies Crashpad's
+/// defaults independently of this policy.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct RetentionPolicy {
+    max_age: Option<Duration>,
+    max_total_size: Option<u64>,
+    max_count: Option<usize>,
+}
+
+impl RetentionPolicy {
+    /// A policy that keeps everything
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Delete reports older than `age`
+    pub fn max_age(mut self, age: Duration) -> Self {
+        self.max_age = Some(age);
+        self
+    }
+
+    /// Keep at most `bytes` of reports, dropping the oldest first
+    pub fn max_total_size(mut self, bytes: u64) -> Self {
+        self.max_total_size = Some(bytes);
+        self
+    }
+
+    /// Keep at most `count` reports, dropping the oldest first
+    pub fn max_count(mut self, count: usize) -> Self {
+        self.max_count = Some(count);
+        self
+    }
+
+    /// Reports that fall outside the policy at `now`
+    fn select_expired(&self, mut reports: Vec<ReportInfo>, now: SystemTime) -> Vec<ReportInfo> {
+        reports.sort_by(|a, b| b.creation_time.cmp(&a.creation_time));
+
+        let mut kept = 0usize;
+        let mut kept_size = 0u64;
+        reports
+            .into_iter()
+            .filter(|report| {
+                let too_many = self.max_count.is_some_and(|max| kept >= max);
+                let too_old = self.max_age.is_some_and(|max| {
+                    now.duration_since(report.creation_time)
+                        .is_ok_and(|age| age > max)
+                });
+                let size = kept_size.saturating_add(report.total_size);
+                let too_big = self.max_total_size.is_some_and(|max| size > max);
+
+                let expired = too_many || too_old || too_big;
+                if !expired {
+                    kept += 1;
+                    kept_size = size;
+                }
+                expired
+            })
+            .collect()
+    }
+}
+
+#[cfg(test)]
+impl ReportInfo {
+    /// A pending report created `age_secs` before `now`
+    pub(crate) fn for_test(uuid: &str, age_secs: u64, size: u64, now: SystemTime) -> Self {
+        ReportInfo {
+            uuid: uuid.to_string(),
+            uuid_c: CString::new(uuid).unwrap(),
+            pending: true,
+            uploaded: false,
+            upload_explicitly_requested: false,
+            upload_attempts: 0,
+            creation_time: now - Duration::from_secs(age_secs),
+            last_upload_attempt_time: None,
+            total_size: size,
+        }
+    }
+
+    pub(crate) fn set_pending_for_test(&mut self, pending: bool) {
+        self.pending = pending;
+    }
+
+    /// Records one upload attempt, as the handler does when it finishes one
+    pub(crate) fn record_upload_for_test(&mut self, uploaded: bool) {
+        self.pending = false;
+        self.uploaded = uploaded;
+        self.upload_attempts += 1;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn report(uuid: &str, age_secs: u64, size: u64, now: SystemTime) -> ReportInfo {
+        ReportInfo::for_test(uuid, age_secs, size, now)
+    }
+
+    fn uuids(reports: &[ReportInfo]) -> Vec<&str> {
+        let mut uuids: Vec<&str> = reports.iter().map(ReportInfo::uuid).collect();
+        uuids.sort_unstable();
+        uuids
+    }
+
+    #[test]
+    fn test_retention_keeps_everything_by_default() {
+        let now = SystemTime::now();
+        let reports = vec![report("a", 10, 100, now), report("b", 1_000_000, 100, now)];
+        assert!(RetentionPolicy::new()
+            .select_expired(reports, now)
+            .is_empty());
+    }
+
+    #[test]
+    fn test_retention_limits() {
+        let now = SystemTime::now();
+        let reports = vec![
+            report("newest", 10, 400, now),
+            report("middle", 20, 400, now),
+            report("old", 30, 400, now),
+            report("ancient", 10_000, 1, now),
+        ];
+
+        let by_count = RetentionPolicy::new().max_count(2);
+        assert_eq!(
+            uuids(&by_count.select_expired(reports.clone(), now)),
+            ["ancient", "old"]
+        );
+
+        let by_age = RetentionPolicy::new().max_age(Duration::from_secs(60));
+        assert_eq!(
+            uuids(&by_age.select_expired(reports.clone(), now)),
+            ["ancient"]
+        );
+
+        // Smaller old reports may still fit after a large one is dropped
+        let by_size = RetentionPolicy::new().max_total_size(1000);
+        assert_eq!(uuids(&by_size.select_expired(reports, now)), ["old"]);
+    }
+}
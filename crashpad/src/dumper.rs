@@ -0,0 +1,347 @@
+use std::fmt;
+use std::os::raw::c_void;
+use std::sync::mpsc::{self, Receiver, SyncSender, TrySendError};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::JoinHandle;
+use std::time::{Duration, Instant};
+
+use crate::latency;
+use crate::Result;
+use crashpad_rs_sys::*;
+
+/// Requests that may wait for the dumper thread before new ones are refused
+const QUEUE_DEPTH: usize = 16;
+
+/// Most bytes of the caller's stack copied per request, innermost frames first
+const STACK_COPY_LIMIT: usize = 64 * 1024;
+
+/// What a dump request does while another thread's dump is in flight
+///
+/// The handler writes one dump at a time, and a dump already suspends every
+/// thread of the process and records all of their stacks. Requests from
+/// different threads are therefore serialized: only one dump is requested
+/// from the handler at a time, and the policy decides what the others do.
+/// It applies to [`CrashpadClient::dump_without_crash`](crate::CrashpadClient::dump_without_crash)
+/// and its variants and to [`AsyncDumper`]. Crashes are not affected: a
+/// crashing thread always requests its own dump.
+///
+/// Set with [`crate::CrashpadConfigBuilder::dump_policy`].
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub enum DumpPolicy {
+    /// Wait for the in-flight dump, then take a separate one.
+    ///
+    /// Every request gets a report of its own; under contention callers
+    /// block for as many dumps as are ahead of them.
+    #[default]
+    Queue,
+    /// Wait for the in-flight dump and share it.
+    ///
+    /// A burst of requests costs one report and callers block for at most
+    /// one dump. That report shows the waiting threads blocked in the dump
+    /// call, or wherever they were when the dump suspended the process if
+    /// they asked later.
+    Coalesce,
+    /// Return immediately without a dump.
+    Drop,
+}
+
+impl DumpPolicy {
+    pub(crate) fn as_raw(self) -> i32 {
+        (match self {
+            DumpPolicy::Queue => CRASHPAD_DUMP_POLICY_QUEUE,
+            DumpPolicy::Coalesce => CRASHPAD_DUMP_POLICY_COALESCE,
+            DumpPolicy::Drop => CRASHPAD_DUMP_POLICY_DROP,
+        }) as i32
+    }
+}
+
+/// Result of a dump request, see [`DumpPolicy`]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum DumpOutcome {
+    /// A dump was written for this request
+    Dumped,
+    /// Another thread's dump was in flight and covered this request
+    Coalesced,
+    /// Another thread's dump was in flight; nothing was written
+    Dropped,
+}
+
+impl DumpOutcome {
+    pub(crate) fn from_raw(outcome: i32) -> Self {
+        match outcome as u32 {
+            CRASHPAD_DUMP_COALESCED => DumpOutcome::Coalesced,
+            CRASHPAD_DUMP_DROPPED => DumpOutcome::Dropped,
+            _ => DumpOutcome::Dumped,
+        }
+    }
+}
+
+/// Takes diagnostic dumps on a dedicated thread.
+///
+/// [`CrashpadClient::dump_without_crash`](crate::CrashpadClient::dump_without_crash)
+/// blocks the caller while the handler suspends the process and writes the
+/// minidump, which can take hundreds of milliseconds. `AsyncDumper::dump`
+/// only captures the calling thread's CPU context and a copy of its stack
+/// (up to 64 KiB from the stack pointer, innermost frames first) and queues
+/// them; a worker thread then asks the handler for the dump, so the caller
+/// continues immediately.
+///
+/// The dump itself is requested by the `crashpad-dump` worker, so Crashpad
+/// names the worker as the requesting thread: the exception record carries
+/// the caller's captured registers under the worker's thread id. The caller
+/// is not held still and its live stack has moved on by then, so the copy
+/// taken at `dump()` is recorded as an extra memory range of that dump, and
+/// the `crashpad_stack_copy` annotation holds
+/// `tid=<caller> sp=0x<stack pointer> copy=0x<address of the copy> size=<bytes>`.
+/// Unwinding the caller means reading stack addresses from `sp` onwards out
+/// of the copy instead; debuggers that are not told to do so unwind from
+/// the caller's current stack. Use the synchronous call when the dump should
+/// show the requesting thread directly.
+///
+/// A handler must be running before dumps are requested.
+///
+/// # Example
+/// ```no_run
+/// use std::time::Duration;
+/// use crashpad_rs::AsyncDumper;
+///
+/// let dumper = AsyncDumper::new()?;
+/// if let Some(pending) = dumper.dump() {
+///     // Keep serving; optionally check on the dump later
+///     pending.wait_timeout(Duration::from_secs(5));
+/// }
+/// # Ok::<(), crashpad_rs::CrashpadError>(())
+/// ```
+pub struct AsyncDumper {
+    sender: Option<SyncSender<DumpRequest>>,
+    worker: Option<JoinHandle<()>>,
+}
+
+struct DumpRequest {
+    context: CpuContext,
+    stack: StackCopy,
+    capture: Duration,
+    done: PendingDump,
+}
+
+impl AsyncDumper {
+    /// Starts the dumper thread.
+    pub fn new() -> Result<Self> {
+        let (sender, receiver) = mpsc::sync_channel(QUEUE_DEPTH);
+        let worker = std::thread::Builder::new()
+            .name("crashpad-dump".to_string())
+            .spawn(move || run_worker(receiver))?;
+
+        Ok(AsyncDumper {
+            sender: Some(sender),
+            worker: Some(worker),
+        })
+    }
+
+    /// Captures the calling thread's context and stack and queues a dump of
+    /// them.
+    ///
+    /// Returns `None` without capturing anything if too many dumps are
+    /// already waiting.
+    pub fn dump(&self) -> Option<PendingDump> {
+        let sender = self.sender.as_ref()?;
+
+        let mut context = CpuContext::new();
+        let start = Instant::now();
+        unsafe { crashpad_capture_context(context.as_mut_ptr()) };
+        let stack = StackCopy::capture(&context);
+        let capture = start.elapsed();
+
+        let done = PendingDump::new();
+        let request = DumpRequest {
+            context,
+            stack,
+            capture,
+            done: done.clone(),
+        };
+        match sender.try_send(request) {
+            Ok(()) => Some(done),
+            Err(TrySendError::Full(_)) | Err(TrySendError::Disconnected(_)) => None,
+        }
+    }
+}
+
+impl Drop for AsyncDumper {
+    fn drop(&mut self) {
+        // Closing the channel lets the worker finish queued dumps and exit
+        self.sender.take();
+        if let Some(worker) = self.worker.take() {
+            let _ = worker.join();
+        }
+    }
+}
+
+impl fmt::Debug for AsyncDumper {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("AsyncDumper").finish_non_exhaustive()
+    }
+}
+
+fn run_worker(receiver: Receiver<DumpRequest>) {
+    for mut request in receiver {
+        let mut timing = crashpad_dump_timing_t {
+            wait_ns: 0,
+            capture_ns: 0,
+            request_ns: 0,
+        };
+        let outcome = unsafe {
+            crashpad_dump_without_crash_with_stack_timed(
+                request.context.as_mut_ptr(),
+                request.stack.buffer.as_ptr() as *const c_void,
+                &request.stack.copy,
+                &mut timing,
+            )
+        };
+        if DumpOutcome::from_raw(outcome) == DumpOutcome::Dumped {
+            latency::record(
+                Duration::from_nanos(timing.wait_ns),
+                request.capture,
+                Duration::from_nanos(timing.request_ns),
+            );
+        }
+        request.done.complete();
+    }
+}
+
+/// Completion handle for a dump queued on an [`AsyncDumper`]
+#[derive(Clone)]
+pub struct PendingDump {
+    state: Arc<(Mutex<bool>, Condvar)>,
+}
+
+impl PendingDump {
+    fn new() -> Self {
+        PendingDump {
+            state: Arc::new((Mutex::new(false), Condvar::new())),
+        }
+    }
+
+    fn complete(&self) {
+        let (done, cvar) = &*self.state;
+        *done.lock().unwrap_or_else(|e| e.into_inner()) = true;
+        cvar.notify_all();
+    }
+
+    /// Whether the handler has finished writing the dump
+    pub fn is_complete(&self) -> bool {
+        *self.state.0.lock().unwrap_or_else(|e| e.into_inner())
+    }
+
+    /// Blocks until the dump is written.
+    pub fn wait(&self) {
+        let (done, cvar) = &*self.state;
+        let guard = done.lock().unwrap_or_else(|e| e.into_inner());
+        let _guard = cvar
+            .wait_while(guard, |done| !*done)
+            .unwrap_or_else(|e| e.into_inner());
+    }
+
+    /// Blocks until the dump is written or `timeout` elapses; returns whether
+    /// the dump completed.
+    pub fn wait_timeout(&self, timeout: Duration) -> bool {
+        let (done, cvar) = &*self.state;
+        let guard = done.lock().unwrap_or_else(|e| e.into_inner());
+        let (guard, _) = cvar
+            .wait_timeout_while(guard, timeout, |done| !*done)
+            .unwrap_or_else(|e| e.into_inner());
+        *guard
+    }
+}
+
+impl fmt::Debug for PendingDump {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("PendingDump")
+            .field("complete", &self.is_complete())
+            .finish()
+    }
+}
+
+/// Heap buffer for a native CPU context with the alignment CONTEXT needs
+struct CpuContext {
+    storage: Vec<Aligned>,
+}
+
+#[repr(C, align(16))]
+#[derive(Clone, Copy)]
+struct Aligned([u8; 16]);
+
+impl CpuContext {
+    fn new() -> Self {
+        let size = unsafe { crashpad_cpu_context_size() };
+        // usize::div_ceil is newer than the crate's MSRV
+        #[allow(clippy::manual_div_ceil)]
+        CpuContext {
+            storage: vec![Aligned([0; 16]); (size + 15) / 16],
+        }
+    }
+
+    fn as_ptr(&self) -> *const c_void {
+        self.storage.as_ptr() as *const c_void
+    }
+
+    fn as_mut_ptr(&mut self) -> *mut c_void {
+        self.storage.as_mut_ptr() as *mut c_void
+    }
+}
+
+/// The requesting thread's stack as it was when its context was captured
+struct StackCopy {
+    buffer: Vec<u8>,
+    copy: crashpad_stack_copy_t,
+}
+
+impl StackCopy {
+    /// Copies the calling thread's stack from the stack pointer in `context`,
+    /// which the calling thread must have captured.
+    ///
+    /// The copy is empty when the stack bounds are unknown; the dump then
+    /// still records the thread id.
+    fn capture(context: &CpuContext) -> Self {
+        let mut buffer = vec![0u8; STACK_COPY_LIMIT];
+        let mut copy = crashpad_stack_copy_t {
+            thread_id: 0,
+            stack_address: 0,
+            size: 0,
+        };
+        unsafe {
+            crashpad_capture_stack(
+                context.as_ptr(),
+                buffer.as_mut_ptr() as *mut c_void,
+                buffer.len(),
+                &mut copy,
+            );
+        }
+        buffer.truncate(copy.size);
+        StackCopy { buffer, copy }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_stack_copy_holds_caller_frame() {
+        // Escapes, so it lives in this frame above the captured stack pointer
+        let marker: u64 = std::hint::black_box(0x5afe_57ac_ca11_e700);
+        let marker_ref = std::hint::black_box(&marker);
+
+        let mut context = CpuContext::new();
+        unsafe { crashpad_capture_context(context.as_mut_ptr()) };
+        let stack = StackCopy::capture(&context);
+
+        assert_ne!(stack.copy.thread_id, 0);
+        assert!(stack.copy.size > 0 && stack.copy.size <= STACK_COPY_LIMIT);
+        assert_eq!(stack.buffer.len(), stack.copy.size);
+        let bytes = marker_ref.to_ne_bytes();
+        assert!(
+            stack.buffer.windows(bytes.len()).any(|w| w == bytes),
+            "copy should contain the caller's locals"
+        );
+    }
+}
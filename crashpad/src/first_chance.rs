@@ -0,0 +1,103 @@
+use std::os::raw::{c_int, c_void};
+use std::panic::{self, AssertUnwindSafe};
+use std::ptr;
+use std::sync::atomic::{AtomicPtr, Ordering};
+
+use crashpad_rs_sys::*;
+
+/// Handler consulted for a crash signal before Crashpad requests a dump
+/// (Linux/Android only)
+///
+/// Returns `true` if the signal was handled, in which case execution resumes
+/// where it faulted and the handler process is never contacted. Returns
+/// `false` to let Crashpad report the crash as usual.
+///
+/// The handler runs inside the signal handler, so it must be
+/// async-signal-safe: no allocation, no locks, no I/O beyond raw syscalls.
+pub type FirstChanceHandler = fn(&SignalInfo) -> bool;
+
+/// A crash signal seen by a [`FirstChanceHandler`]
+#[derive(Debug)]
+pub struct SignalInfo {
+    signal: c_int,
+    siginfo: *mut c_void,
+    context: *mut c_void,
+}
+
+impl SignalInfo {
+    /// Signal number, e.g. `SIGSEGV`
+    pub fn signal(&self) -> c_int {
+        self.signal
+    }
+
+    /// Faulting address (`si_addr`) for `SIGSEGV`, `SIGBUS`, `SIGILL` and
+    /// `SIGFPE`
+    pub fn fault_address(&self) -> usize {
+        unsafe { crashpad_siginfo_fault_address(self.siginfo) as usize }
+    }
+
+    /// The signal's `siginfo_t`
+    pub fn siginfo(&self) -> *mut c_void {
+        self.siginfo
+    }
+
+    /// The interrupted thread's `ucontext_t`, which may be modified to
+    /// resume somewhere else
+    pub fn context(&self) -> *mut c_void {
+        self.context
+    }
+}
+
+/// The installed handler, as a `FirstChanceHandler` cast to a pointer
+static HANDLER: AtomicPtr<()> = AtomicPtr::new(ptr::null_mut());
+
+pub(crate) fn set_handler(handler: Option<FirstChanceHandler>) {
+    let handler = handler.map_or(ptr::null_mut(), |handler| handler as *mut ());
+    HANDLER.store(handler, Ordering::Release);
+    unsafe {
+        crashpad_client_set_first_chance_handler(if handler.is_null() {
+            None
+        } else {
+            Some(trampoline)
+        });
+    }
+}
+
+unsafe extern "C" fn trampoline(signal: c_int, siginfo: *mut c_void, context: *mut c_void) -> bool {
+    let handler = HANDLER.load(Ordering::Acquire);
+    if handler.is_null() {
+        return false;
+    }
+    // SAFETY: only set_handler stores into HANDLER, always a FirstChanceHandler
+    let handler: FirstChanceHandler = std::mem::transmute(handler);
+    let info = SignalInfo {
+        signal,
+        siginfo,
+        context,
+    };
+    // A panic must not unwind into the signal handler; report the crash instead
+    panic::catch_unwind(AssertUnwindSafe(|| handler(&info))).unwrap_or(false)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn handles_sigsegv(info: &SignalInfo) -> bool {
+        info.signal() == libc::SIGSEGV
+    }
+
+    #[test]
+    fn test_first_chance_dispatch() {
+        set_handler(Some(handles_sigsegv));
+        unsafe {
+            assert!(trampoline(libc::SIGSEGV, ptr::null_mut(), ptr::null_mut()));
+            assert!(!trampoline(libc::SIGBUS, ptr::null_mut(), ptr::null_mut()));
+        }
+
+        set_handler(None);
+        unsafe {
+            assert!(!trampoline(libc::SIGSEGV, ptr::null_mut(), ptr::null_mut()));
+        }
+    }
+}
@@ -0,0 +1,194 @@
+use std::time::Duration;
+
+use crashpad_rs_sys::*;
+
+/// Where the handler connection of this process stands, see
+/// [`HandlerStatus::state`]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum HandlerState {
+    /// No handler was started or attached
+    NotStarted,
+    /// The handler was launched and has not finished its handshake yet
+    Starting,
+    /// Connected to a running handler
+    Running,
+    /// The handler is launched by the crashing process, see
+    /// [`HandlerStartMode::AtCrash`](crate::HandlerStartMode::AtCrash)
+    OnDemand,
+    /// The handler closed its connection: it exited or was killed. Crashes
+    /// are not reported until a handler is started or attached again.
+    Lost,
+    /// The last start failed
+    Failed,
+}
+
+impl HandlerState {
+    fn from_raw(state: i32) -> Self {
+        match state as u32 {
+            CRASHPAD_HANDLER_STARTING => HandlerState::Starting,
+            CRASHPAD_HANDLER_RUNNING => HandlerState::Running,
+            CRASHPAD_HANDLER_ON_DEMAND => HandlerState::OnDemand,
+            CRASHPAD_HANDLER_LOST => HandlerState::Lost,
+            CRASHPAD_HANDLER_FAILED => HandlerState::Failed,
+            _ => HandlerState::NotStarted,
+        }
+    }
+}
+
+/// Health of the handler serving this process, from
+/// [`CrashpadClient::handler_status`](crate::CrashpadClient::handler_status)
+///
+/// The state is kept up to date by the start and attach calls and, on
+/// Linux/Android, by a monitor thread that sleeps until the handler closes
+/// its connection. Elsewhere a handler that dies after starting is not
+/// noticed and stays [`HandlerState::Running`]; on macOS Crashpad relaunches
+/// it by itself, which is not counted as a restart.
+///
+/// The handshake is the time from launching the handler until it accepted
+/// this process as a client. On Windows it completes on a Crashpad thread
+/// after the start call returns, and is timed from there.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct HandlerStatus {
+    state: HandlerState,
+    state_age: Duration,
+    pid: Option<u32>,
+    starts: u64,
+    start_failures: u64,
+    disconnects: u64,
+    last_handshake: Duration,
+    max_handshake: Duration,
+    total_handshake_ns: u64,
+}
+
+impl HandlerStatus {
+    fn from_raw(raw: &crashpad_handler_status_t) -> Self {
+        HandlerStatus {
+            state: HandlerState::from_raw(raw.state),
+            state_age: Duration::from_nanos(raw.state_age_ns),
+            pid: u32::try_from(raw.pid).ok().filter(|&pid| pid > 0),
+            starts: raw.starts,
+            start_failures: raw.start_failures,
+            disconnects: raw.disconnects,
+            last_handshake: Duration::from_nanos(raw.last_handshake_ns),
+            max_handshake: Duration::from_nanos(raw.max_handshake_ns),
+            total_handshake_ns: raw.total_handshake_ns,
+        }
+    }
+
+    /// Current state of the handler connection
+    pub fn state(&self) -> HandlerState {
+        self.state
+    }
+
+    /// Whether a crash right now would be reported
+    pub fn is_alive(&self) -> bool {
+        matches!(self.state, HandlerState::Running | HandlerState::OnDemand)
+    }
+
+    /// How long the handler has been in its current state
+    pub fn state_age(&self) -> Duration {
+        self.state_age
+    }
+
+    /// Process id of the handler (Linux/Android only)
+    pub fn pid(&self) -> Option<u32> {
+        self.pid
+    }
+
+    /// Handler launches that finished the handshake
+    pub fn starts(&self) -> u64 {
+        self.starts
+    }
+
+    /// Launches after the first, e.g. after the handler was lost
+    pub fn restarts(&self) -> u64 {
+        self.starts.saturating_sub(1)
+    }
+
+    /// Launches that failed
+    pub fn start_failures(&self) -> u64 {
+        self.start_failures
+    }
+
+    /// Times the handler closed its connection (Linux/Android only)
+    pub fn disconnects(&self) -> u64 {
+        self.disconnects
+    }
+
+    /// Handshake time of the most recent start
+    pub fn last_handshake(&self) -> Duration {
+        self.last_handshake
+    }
+
+    /// Slowest handshake
+    pub fn max_handshake(&self) -> Duration {
+        self.max_handshake
+    }
+
+    /// Mean handshake time over all starts
+    pub fn mean_handshake(&self) -> Duration {
+        match self.starts {
+            0 => Duration::ZERO,
+            starts => Duration::from_nanos(self.total_handshake_ns / starts),
+        }
+    }
+}
+
+/// Reads the cached handler health with one FFI call.
+pub(crate) fn status() -> HandlerStatus {
+    let mut raw = crashpad_handler_status_t {
+        state: 0,
+        pid: -1,
+        starts: 0,
+        start_failures: 0,
+        disconnects: 0,
+        last_handshake_ns: 0,
+        max_handshake_ns: 0,
+        total_handshake_ns: 0,
+        state_age_ns: 0,
+    };
+    unsafe { crashpad_handler_get_status(&mut raw) };
+    HandlerStatus::from_raw(&raw)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_status_from_raw() {
+        let mut raw = crashpad_handler_status_t {
+            state: CRASHPAD_HANDLER_LOST as i32,
+            pid: -1,
+            starts: 3,
+            start_failures: 1,
+            disconnects: 2,
+            last_handshake_ns: 4_000_000,
+            max_handshake_ns: 9_000_000,
+            total_handshake_ns: 15_000_000,
+            state_age_ns: 1_000,
+        };
+        let status = HandlerStatus::from_raw(&raw);
+        assert_eq!(status.state(), HandlerState::Lost);
+        assert!(!status.is_alive());
+        assert_eq!(status.pid(), None);
+        assert_eq!(status.restarts(), 2);
+        assert_eq!(status.mean_handshake(), Duration::from_millis(5));
+        assert_eq!(status.max_handshake(), Duration::from_millis(9));
+
+        raw.state = CRASHPAD_HANDLER_ON_DEMAND as i32;
+        raw.pid = 4242;
+        raw.starts = 0;
+        let status = HandlerStatus::from_raw(&raw);
+        assert!(status.is_alive());
+        assert_eq!(status.pid(), Some(4242));
+        assert_eq!(status.restarts(), 0);
+        assert_eq!(status.mean_handshake(), Duration::ZERO);
+
+        raw.state = 99;
+        assert_eq!(
+            HandlerStatus::from_raw(&raw).state(),
+            HandlerState::NotStarted
+        );
+    }
+}
@@ -0,0 +1,307 @@
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::time::Duration;
+
+use crate::Annotation;
+
+/// Sub-buckets per power of two; percentiles are within 1/16 of the value
+const SUB_BUCKET_BITS: u32 = 3;
+const SUB_BUCKETS: u64 = 1 << SUB_BUCKET_BITS;
+/// Enough buckets for any `u64` nanosecond value
+const BUCKETS: usize = ((64 - SUB_BUCKET_BITS) as usize + 1) * SUB_BUCKETS as usize;
+
+/// Latency of diagnostic dumps taken by this process since it started.
+///
+/// Every [`CrashpadClient::dump_without_crash`](crate::CrashpadClient::dump_without_crash)
+/// and [`AsyncDumper`](crate::AsyncDumper) dump is timed with a monotonic
+/// clock in three phases:
+///
+/// - **wait**: waiting for another thread's dump to finish first, see
+///   [`DumpPolicy`](crate::DumpPolicy)
+/// - **capture**: capturing the requesting thread's CPU context
+/// - **request**: the handler round trip, from the dump request until the
+///   handler is done. This covers everything the handler does: suspending
+///   the process, walking its memory, writing the minidump and committing
+///   it to the database. The handler runs in another process and does not
+///   report those steps separately.
+///
+/// Get a snapshot with
+/// [`CrashpadClient::dump_latency`](crate::CrashpadClient::dump_latency).
+/// Only dumps that were written are recorded; coalesced and dropped requests
+/// are not. Recording a dump costs a few atomic increments; percentiles come
+/// from a log-scale histogram and are accurate to about 6%.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct DumpLatency {
+    wait: LatencyStats,
+    capture: LatencyStats,
+    request: LatencyStats,
+    total: LatencyStats,
+}
+
+impl DumpLatency {
+    /// Waiting for another thread's dump to finish
+    pub fn wait(&self) -> LatencyStats {
+        self.wait
+    }
+
+    /// Context capture in the requesting thread
+    pub fn capture(&self) -> LatencyStats {
+        self.capture
+    }
+
+    /// Handler round trip, from request until the minidump is written
+    pub fn request(&self) -> LatencyStats {
+        self.request
+    }
+
+    /// All phases together
+    pub fn total(&self) -> LatencyStats {
+        self.total
+    }
+}
+
+/// Latency distribution of one dump phase
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct LatencyStats {
+    count: u64,
+    last: Duration,
+    p50: Duration,
+    p99: Duration,
+    max: Duration,
+}
+
+impl LatencyStats {
+    /// Number of dumps timed
+    pub fn count(&self) -> u64 {
+        self.count
+    }
+
+    /// Latency of the most recent dump
+    pub fn last(&self) -> Duration {
+        self.last
+    }
+
+    /// Median latency
+    pub fn p50(&self) -> Duration {
+        self.p50
+    }
+
+    /// 99th percentile latency
+    pub fn p99(&self) -> Duration {
+        self.p99
+    }
+
+    /// Slowest dump
+    pub fn max(&self) -> Duration {
+        self.max
+    }
+}
+
+/// Lock-free histogram of one phase's latencies in nanoseconds
+struct Histogram {
+    buckets: [AtomicU64; BUCKETS],
+    last: AtomicU64,
+    max: AtomicU64,
+}
+
+#[allow(clippy::declare_interior_mutable_const)]
+const ZERO: AtomicU64 = AtomicU64::new(0);
+
+impl Histogram {
+    const fn new() -> Self {
+        Histogram {
+            buckets: [ZERO; BUCKETS],
+            last: AtomicU64::new(0),
+            max: AtomicU64::new(0),
+        }
+    }
+
+    fn record(&self, nanos: u64) {
+        self.buckets[bucket_index(nanos)].fetch_add(1, Ordering::Relaxed);
+        self.last.store(nanos, Ordering::Relaxed);
+        self.max.fetch_max(nanos, Ordering::Relaxed);
+    }
+
+    fn stats(&self) -> LatencyStats {
+        let counts: Vec<u64> = self
+            .buckets
+            .iter()
+            .map(|bucket| bucket.load(Ordering::Relaxed))
+            .collect();
+        let count = counts.iter().sum();
+        LatencyStats {
+            count,
+            last: Duration::from_nanos(self.last.load(Ordering::Relaxed)),
+            p50: Duration::from_nanos(percentile(&counts, count, 50)),
+            p99: Duration::from_nanos(percentile(&counts, count, 99)),
+            max: Duration::from_nanos(self.max.load(Ordering::Relaxed)),
+        }
+    }
+}
+
+fn bucket_index(nanos: u64) -> usize {
+    if nanos < SUB_BUCKETS {
+        return nanos as usize;
+    }
+    let exponent = 63 - nanos.leading_zeros();
+    let sub_bucket = (nanos >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    ((u64::from(exponent - SUB_BUCKET_BITS) + 1) * SUB_BUCKETS + sub_bucket) as usize
+}
+
+/// Midpoint of the values falling into bucket `index`
+fn bucket_value(index: usize) -> u64 {
+    let index = index as u64;
+    if index < SUB_BUCKETS {
+        return index;
+    }
+    let shift = index / SUB_BUCKETS - 1;
+    let lower = (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    lower + ((1u64 << shift) >> 1)
+}
+
+/// Value at `percent` of `count` samples, by nearest rank
+fn percentile(counts: &[u64], count: u64, percent: u64) -> u64 {
+    if count == 0 {
+        return 0;
+    }
+    // u64::div_ceil is newer than the crate's MSRV
+    #[allow(clippy::manual_div_ceil)]
+    let rank = ((count * percent + 99) / 100).max(1);
+    let mut seen = 0;
+    for (index, &bucket_count) in counts.iter().enumerate() {
+        seen += bucket_count;
+        if seen >= rank {
+            return bucket_value(index);
+        }
+    }
+    0
+}
+
+struct Recorder {
+    wait: Histogram,
+    capture: Histogram,
+    request: Histogram,
+    total: Histogram,
+}
+
+impl Recorder {
+    const fn new() -> Self {
+        Recorder {
+            wait: Histogram::new(),
+            capture: Histogram::new(),
+            request: Histogram::new(),
+            total: Histogram::new(),
+        }
+    }
+
+    fn record(&self, wait: u64, capture: u64, request: u64) {
+        self.wait.record(wait);
+        self.capture.record(capture);
+        self.request.record(request);
+        self.total
+            .record(wait.saturating_add(capture).saturating_add(request));
+    }
+
+    fn snapshot(&self) -> DumpLatency {
+        DumpLatency {
+            wait: self.wait.stats(),
+            capture: self.capture.stats(),
+            request: self.request.stats(),
+            total: self.total.stats(),
+        }
+    }
+}
+
+static RECORDER: Recorder = Recorder::new();
+
+static STAMP_ANNOTATION: AtomicBool = AtomicBool::new(false);
+
+/// Latency summary carried by later reports, in microseconds
+static LATENCY_ANNOTATION: Annotation<128> = Annotation::new("crashpad_dump_latency_us");
+
+/// Records one dump's phase timings.
+pub(crate) fn record(wait: Duration, capture: Duration, request: Duration) {
+    RECORDER.record(nanos(wait), nanos(capture), nanos(request));
+    if STAMP_ANNOTATION.load(Ordering::Relaxed) {
+        let latency = RECORDER.snapshot();
+        let total = latency.total;
+        // A report cannot contain its own timing, so each report carries
+        // the figures of the dumps before it
+        LATENCY_ANNOTATION.set_fmt(format_args!(
+            "n={} last={} p50={} p99={} max={} wait_p99={} capture_p99={}",
+            total.count,
+            total.last.as_micros(),
+            total.p50.as_micros(),
+            total.p99.as_micros(),
+            total.max.as_micros(),
+            latency.wait.p99.as_micros(),
+            latency.capture.p99.as_micros(),
+        ));
+    }
+}
+
+/// Timings of every dump recorded so far
+pub(crate) fn snapshot() -> DumpLatency {
+    RECORDER.snapshot()
+}
+
+/// Enables the `crashpad_dump_latency_us` annotation.
+pub(crate) fn set_stamp_annotation(enabled: bool) {
+    STAMP_ANNOTATION.store(enabled, Ordering::Relaxed);
+    if !enabled {
+        LATENCY_ANNOTATION.clear();
+    }
+}
+
+fn nanos(duration: Duration) -> u64 {
+    u64::try_from(duration.as_nanos()).unwrap_or(u64::MAX)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_bucket_bounds() {
+        for nanos in (0..10_000).chain([u64::MAX / 3, u64::MAX]) {
+            let index = bucket_index(nanos);
+            assert!(index < BUCKETS);
+            let value = bucket_value(index);
+            // Within half a bucket width, a sixteenth of the value
+            assert!(
+                value.abs_diff(nanos) <= nanos / 16 + 1,
+                "{nanos} -> {value}"
+            );
+        }
+        assert!(bucket_index(1000) < bucket_index(1200));
+    }
+
+    #[test]
+    fn test_latency_percentiles() {
+        let recorder = Recorder::new();
+        assert_eq!(recorder.snapshot().total().count(), 0);
+
+        // 1..=100 microseconds of request time, constant capture
+        for micros in 1..=100 {
+            recorder.record(0, 2_000, micros * 1_000);
+        }
+        let latency = recorder.snapshot();
+        let request = latency.request();
+        assert_eq!(request.count(), 100);
+        assert_eq!(request.last(), Duration::from_micros(100));
+        assert_eq!(request.max(), Duration::from_micros(100));
+        assert!(
+            request.p50().as_micros().abs_diff(50) <= 3,
+            "{:?}",
+            request.p50()
+        );
+        assert!(
+            request.p99().as_micros().abs_diff(99) <= 6,
+            "{:?}",
+            request.p99()
+        );
+        let capture = latency.capture().p99().as_nanos();
+        assert!(capture.abs_diff(2_000) <= 2_000 / 16, "{capture}");
+        assert_eq!(latency.wait().max(), Duration::ZERO);
+        assert_eq!(latency.total().last(), Duration::from_micros(102));
+    }
+}
@@ -2,12 +2,53 @@
 //!
 //! This crate provides a safe, idiomatic Rust interface to the Crashpad crash reporting library.
 
+mod annotations;
+mod attachments;
+mod breadcrumbs;
 mod client;
 mod config;
+#[cfg_attr(
+    not(any(target_os = "ios", target_os = "tvos", target_os = "watchos")),
+    allow(dead_code)
+)]
+mod conversion;
+mod database;
+mod dumper;
+#[cfg(any(target_os = "linux", target_os = "android"))]
+mod first_chance;
+mod health;
+mod latency;
+#[cfg_attr(
+    not(any(target_os = "ios", target_os = "tvos", target_os = "watchos")),
+    allow(dead_code)
+)]
+mod observer;
+mod panic_hook;
+mod sampling;
+mod throttle;
+mod token;
+mod upload;
 
-pub use client::CrashpadClient;
-pub use config::{CrashpadConfig, CrashpadConfigBuilder};
+pub use annotations::{Annotation, AnnotationSlot};
+pub use breadcrumbs::{Breadcrumb, BreadcrumbBuffer, BREADCRUMB_MAX_LEN};
+#[cfg(any(target_os = "linux", target_os = "android"))]
+pub use client::HandlerSocket;
+pub use client::{CrashpadClient, HandlerStartup};
+pub use config::{CrashpadConfig, CrashpadConfigBuilder, HandlerStartMode, IoPriority};
+pub use conversion::{DumpConversion, DumpConversionSummary, IntermediateDumpProcessing};
+pub use database::{CrashDatabase, DatabaseCounters, ReportInfo, RetentionPolicy};
+pub use dumper::{AsyncDumper, DumpOutcome, DumpPolicy, PendingDump};
+#[cfg(any(target_os = "linux", target_os = "android"))]
+pub use first_chance::{FirstChanceHandler, SignalInfo};
+pub use health::{HandlerState, HandlerStatus};
+pub use latency::{DumpLatency, LatencyStats};
+pub use observer::ReportEvent;
+pub use panic_hook::PanicCapture;
+pub use sampling::SamplingPolicy;
 use thiserror::Error;
+pub use throttle::DumpThrottle;
+pub use token::HandlerToken;
+pub use upload::{UploadSchedule, UploadScheduler};
 
 #[derive(Error, Debug)]
 pub enum CrashpadError {
@@ -0,0 +1,220 @@
+use std::collections::HashMap;
+use std::sync::{Mutex, MutexGuard};
+
+use crate::{CrashDatabase, ReportInfo};
+
+/// Change to the report database seen after a handler pass (iOS only)
+///
+/// Delivered to the observer registered with
+/// [`crate::CrashpadClient::observe_reports`]. Crashpad only signals that a
+/// pass over pending reports finished, so the events of a pass are derived by
+/// comparing the database with what the previous pass left behind, and always
+/// end with [`ReportEvent::PassCompleted`].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum ReportEvent {
+    /// A report appeared, e.g. converted from an intermediate dump
+    Added(ReportInfo),
+    /// An upload was attempted and did not succeed
+    UploadAttempted(ReportInfo),
+    /// The report was uploaded
+    Uploaded(ReportInfo),
+    /// The report left the pending set without an upload attempt, e.g.
+    /// because uploads are disabled
+    Skipped(ReportInfo),
+    /// The report was deleted
+    Removed(String),
+    /// The handler finished processing and uploading pending reports for now
+    PassCompleted,
+}
+
+type Callback = Box<dyn FnMut(ReportEvent) + Send>;
+
+/// Turns the handler's per-pass notification into [`ReportEvent`]s
+pub(crate) struct ReportObserver {
+    state: Mutex<ObserverState>,
+}
+
+#[derive(Default)]
+struct ObserverState {
+    database: Option<CrashDatabase>,
+    known: HashMap<String, ReportInfo>,
+    callback: Option<Callback>,
+    /// Bumped whenever the callback is replaced, so a pass that ran the old
+    /// callback outside the lock does not put it back
+    generation: u64,
+}
+
+impl ReportObserver {
+    pub(crate) fn new() -> Self {
+        ReportObserver {
+            state: Mutex::new(ObserverState::default()),
+        }
+    }
+
+    /// Replaces the callback receiving events.
+    pub(crate) fn set_callback(&self, callback: Callback) {
+        let mut state = self.lock();
+        state.callback = Some(callback);
+        state.generation += 1;
+    }
+
+    /// Starts tracking `database`; reports already in it are not announced.
+    pub(crate) fn attach(&self, database: CrashDatabase) {
+        let known = database.reports().unwrap_or_default();
+        let mut state = self.lock();
+        state.known = by_uuid(known);
+        state.database = Some(database);
+    }
+
+    /// Handles the end of a handler pass.
+    pub(crate) fn pass_completed(&self) {
+        let (events, callback, generation) = {
+            let mut state = self.lock();
+            let Some(reports) = state.database.as_ref().and_then(|db| db.reports().ok()) else {
+                return;
+            };
+            let mut events = diff(&state.known, &reports);
+            events.push(ReportEvent::PassCompleted);
+            state.known = by_uuid(reports);
+            (events, state.callback.take(), state.generation)
+        };
+
+        // The callback runs unlocked so it may replace itself
+        let Some(mut callback) = callback else {
+            return;
+        };
+        for event in events {
+            callback(event);
+        }
+        let mut state = self.lock();
+        if state.generation == generation {
+            state.callback = Some(callback);
+        }
+    }
+
+    fn lock(&self) -> MutexGuard<'_, ObserverState> {
+        self.state.lock().unwrap_or_else(|e| e.into_inner())
+    }
+}
+
+fn by_uuid(reports: Vec<ReportInfo>) -> HashMap<String, ReportInfo> {
+    reports
+        .into_iter()
+        .map(|report| (report.uuid().to_string(), report))
+        .collect()
+}
+
+/// Events that turn `known` into `current`
+fn diff(known: &HashMap<String, ReportInfo>, current: &[ReportInfo]) -> Vec<ReportEvent> {
+    let mut events = Vec::new();
+    for report in current {
+        let previous = known.get(report.uuid());
+        if previous.is_none() {
+            events.push(ReportEvent::Added(report.clone()));
+        }
+
+        let was_uploaded = previous.is_some_and(ReportInfo::is_uploaded);
+        let attempts_before = previous.map_or(0, ReportInfo::upload_attempts);
+        let was_pending = match previous {
+            Some(previous) => previous.is_pending(),
+            None => true,
+        };
+        if report.is_uploaded() && !was_uploaded {
+            events.push(ReportEvent::Uploaded(report.clone()));
+        } else if report.upload_attempts() > attempts_before {
+            events.push(ReportEvent::UploadAttempted(report.clone()));
+        } else if was_pending && !report.is_pending() && !report.is_uploaded() {
+            events.push(ReportEvent::Skipped(report.clone()));
+        }
+    }
+
+    let mut removed: Vec<&String> = known
+        .keys()
+        .filter(|uuid| !current.iter().any(|report| report.uuid() == uuid.as_str()))
+        .collect();
+    removed.sort();
+    events.extend(
+        removed
+            .into_iter()
+            .map(|uuid| ReportEvent::Removed(uuid.clone())),
+    );
+    events
+}
+
+/// Trampoline for the handler's observation callback
+///
+/// # Safety
+/// `context` must come from `Arc::into_raw` on an `Arc<ReportObserver>`
+/// that is never released.
+#[cfg(any(target_os = "ios", target_os = "tvos", target_os = "watchos"))]
+pub(crate) unsafe extern "C" fn pending_reports_processed(context: *mut std::os::raw::c_void) {
+    let observer = &*(context as *const ReportObserver);
+    // Unwinding into Crashpad's upload thread is undefined behavior
+    let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| observer.pass_completed()));
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::time::SystemTime;
+
+    #[test]
+    fn test_report_events() {
+        let now = SystemTime::now();
+        let mut uploaded = ReportInfo::for_test("uploaded", 30, 10, now);
+        let mut failed = ReportInfo::for_test("failed", 20, 10, now);
+        let mut skipped = ReportInfo::for_test("skipped", 10, 10, now);
+        let deleted = ReportInfo::for_test("deleted", 40, 10, now);
+        let known = by_uuid(vec![
+            uploaded.clone(),
+            failed.clone(),
+            skipped.clone(),
+            deleted,
+        ]);
+
+        uploaded.record_upload_for_test(true);
+        failed.record_upload_for_test(false);
+        skipped.set_pending_for_test(false);
+        let added = ReportInfo::for_test("added", 1, 10, now);
+        let current = vec![
+            uploaded.clone(),
+            failed.clone(),
+            skipped.clone(),
+            added.clone(),
+        ];
+
+        assert_eq!(
+            diff(&known, &current),
+            vec![
+                ReportEvent::Uploaded(uploaded),
+                ReportEvent::UploadAttempted(failed),
+                ReportEvent::Skipped(skipped),
+                ReportEvent::Added(added),
+                ReportEvent::Removed("deleted".to_string()),
+            ]
+        );
+    }
+
+    #[test]
+    fn test_report_events_new_and_uploaded_in_one_pass() {
+        let now = SystemTime::now();
+        let mut report = ReportInfo::for_test("fresh", 1, 10, now);
+        report.record_upload_for_test(true);
+
+        assert_eq!(
+            diff(&HashMap::new(), &[report.clone()]),
+            vec![
+                ReportEvent::Added(report.clone()),
+                ReportEvent::Uploaded(report)
+            ]
+        );
+    }
+
+    #[test]
+    fn test_report_events_unchanged() {
+        let now = SystemTime::now();
+        let report = ReportInfo::for_test("same", 1, 10, now);
+        let known = by_uuid(vec![report.clone()]);
+        assert!(diff(&known, &[report]).is_empty());
+    }
+}
@@ -0,0 +1,125 @@
+use std::any::Any;
+use std::panic::{self, Location};
+use std::process;
+use std::sync::atomic::{AtomicBool, AtomicU8, Ordering};
+use std::sync::Mutex;
+
+use crate::Annotation;
+use crashpad_rs_sys::*;
+
+/// What the panic hook does after recording a Rust panic
+///
+/// Either way the panic message and location are first written into the
+/// `panic_message` and `panic_location` annotations, whose buffers are
+/// registered when the handler starts, so recording a panic allocates
+/// nothing and takes no locks shared with the rest of the process. Messages
+/// are truncated to 2048 bytes and locations to 512.
+///
+/// The hook then runs the previously installed hook (by default printing
+/// the panic to stderr).
+///
+/// Set with [`crate::CrashpadConfigBuilder::capture_panics`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum PanicCapture {
+    /// Take a diagnostic dump of the panicking thread and let the panic
+    /// continue to unwind.
+    ///
+    /// The dump is subject to the [`DumpPolicy`](crate::DumpPolicy). The
+    /// annotations are cleared afterwards so later reports do not carry a
+    /// stale message. With `panic = "abort"` the abort that follows is
+    /// reported as a crash too, so prefer [`PanicCapture::Abort`] there.
+    Dump,
+    /// Abort the process, which the handler reports as a crash.
+    Abort,
+}
+
+impl PanicCapture {
+    fn as_raw(self) -> u8 {
+        match self {
+            PanicCapture::Dump => 0,
+            PanicCapture::Abort => 1,
+        }
+    }
+}
+
+/// Panic message, truncated on a character boundary
+static PANIC_MESSAGE: Annotation<2048> = Annotation::new("panic_message");
+
+/// `file:line:column` of the panic
+static PANIC_LOCATION: Annotation<512> = Annotation::new("panic_location");
+
+static INSTALLED: AtomicBool = AtomicBool::new(false);
+static CAPTURE: AtomicU8 = AtomicU8::new(0);
+
+/// Keeps concurrent panics from overwriting each other's annotations while
+/// the first one is being dumped
+static RECORDING: Mutex<()> = Mutex::new(());
+
+/// Installs the panic hook, or changes what an installed one does.
+///
+/// Registers the annotation buffers up front so that the hook never does.
+pub(crate) fn install(capture: PanicCapture) {
+    PANIC_MESSAGE.clear();
+    PANIC_LOCATION.clear();
+    // Some platforms allocate a mutex on first use
+    drop(RECORDING.lock().unwrap_or_else(|e| e.into_inner()));
+    CAPTURE.store(capture.as_raw(), Ordering::Relaxed);
+    if INSTALLED.swap(true, Ordering::AcqRel) {
+        return;
+    }
+
+    let previous = panic::take_hook();
+    panic::set_hook(Box::new(move |info| {
+        let abort = CAPTURE.load(Ordering::Relaxed) == PanicCapture::Abort.as_raw();
+        {
+            let _recording = RECORDING.lock().unwrap_or_else(|e| e.into_inner());
+            record(info.payload(), info.location());
+            if !abort {
+                unsafe { crashpad_dump_without_crash() };
+                PANIC_MESSAGE.clear();
+                PANIC_LOCATION.clear();
+            }
+        }
+
+        previous(info);
+        if abort {
+            process::abort();
+        }
+    }));
+}
+
+fn record(payload: &(dyn Any + Send), location: Option<&Location<'_>>) {
+    PANIC_MESSAGE.set(payload_message(payload));
+    match location {
+        Some(location) => PANIC_LOCATION.set_fmt(format_args!("{location}")),
+        None => PANIC_LOCATION.clear(),
+    }
+}
+
+/// The message of a `panic!` payload, which is a `&str` or a `String`
+fn payload_message(payload: &(dyn Any + Send)) -> &str {
+    if let Some(message) = payload.downcast_ref::<&'static str>() {
+        message
+    } else if let Some(message) = payload.downcast_ref::<String>() {
+        message
+    } else {
+        "Box<dyn Any>"
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_payload_message() {
+        let payload: Box<dyn Any + Send> = Box::new("static message");
+        assert_eq!(payload_message(payload.as_ref()), "static message");
+
+        let payload: Box<dyn Any + Send> = Box::new(format!("formatted {}", 42));
+        assert_eq!(payload_message(payload.as_ref()), "formatted 42");
+
+        let payload: Box<dyn Any + Send> = Box::new(42);
+        assert_eq!(payload_message(payload.as_ref()), "Box<dyn Any>");
+    }
+}
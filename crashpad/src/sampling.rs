@@ -0,0 +1,178 @@
+use std::collections::hash_map::RandomState;
+use std::collections::HashMap;
+use std::hash::{BuildHasher, Hasher};
+use std::sync::atomic::{AtomicU64, Ordering};
+
+/// Sampling of non-fatal dumps across a fleet.
+///
+/// Soft-failure paths on many hosts produce far more dumps than are needed
+/// to diagnose a problem. A `SamplingPolicy` keeps only a fraction of them:
+/// each dump signature gets a sample rate between 0.0 and 1.0, and calls that
+/// are not sampled skip context capture and the handler entirely.
+///
+/// By default every call is sampled independently at random. With a
+/// [deterministic key](SamplingPolicy::deterministic_key) such as a host name
+/// or session id, the decision is instead a stable hash of the key and the
+/// signature, so the same hosts keep reporting a given signature and their
+/// dumps can be correlated over time.
+///
+/// Sampling only applies to
+/// [`CrashpadClient::dump_without_crash_sampled`](crate::CrashpadClient::dump_without_crash_sampled).
+/// Crashes are always captured.
+///
+/// # Example
+/// ```
+/// use crashpad_rs::SamplingPolicy;
+///
+/// // Keep 1% of soft failures, but every "data-corruption" dump
+/// let policy = SamplingPolicy::new(0.01)
+///     .rate("data-corruption", 1.0)
+///     .deterministic_key("host-1234");
+/// ```
+#[derive(Debug, Clone)]
+pub struct SamplingPolicy {
+    default_rate: f64,
+    rates: HashMap<String, f64>,
+    key_hash: Option<u64>,
+    random: RandomState,
+}
+
+/// Call counter feeding random sampling decisions
+static SAMPLE_COUNTER: AtomicU64 = AtomicU64::new(0);
+
+impl SamplingPolicy {
+    /// Samples every signature at `default_rate` (clamped to 0.0..=1.0).
+    pub fn new(default_rate: f64) -> Self {
+        SamplingPolicy {
+            default_rate: clamp_rate(default_rate),
+            rates: HashMap::new(),
+            key_hash: None,
+            random: RandomState::new(),
+        }
+    }
+
+    /// Samples `signature` at `rate` (clamped to 0.0..=1.0) instead of the
+    /// default.
+    pub fn rate<S: Into<String>>(mut self, signature: S, rate: f64) -> Self {
+        self.rates.insert(signature.into(), clamp_rate(rate));
+        self
+    }
+
+    /// Makes decisions a stable function of `key` and the signature.
+    ///
+    /// The hash is fixed across builds and platforms, so hosts sharing a
+    /// policy agree on which of them report each signature.
+    pub fn deterministic_key<K: AsRef<[u8]>>(mut self, key: K) -> Self {
+        self.key_hash = Some(fnv1a(FNV_OFFSET, key.as_ref()));
+        self
+    }
+
+    /// Sample rate that applies to `signature`
+    pub fn rate_for(&self, signature: &str) -> f64 {
+        self.rates
+            .get(signature)
+            .copied()
+            .unwrap_or(self.default_rate)
+    }
+
+    /// Decides whether a dump with `signature` should be taken.
+    pub fn should_sample(&self, signature: &str) -> bool {
+        let rate = self.rate_for(signature);
+        if rate >= 1.0 {
+            return true;
+        }
+        if rate <= 0.0 {
+            return false;
+        }
+
+        let value = match self.key_hash {
+            Some(key_hash) => mix(fnv1a(key_hash, signature.as_bytes())),
+            None => {
+                let mut hasher = self.random.build_hasher();
+                hasher.write_u64(SAMPLE_COUNTER.fetch_add(1, Ordering::Relaxed));
+                hasher.finish()
+            }
+        };
+        // Compare in 53-bit space, the precision of the rate
+        ((value >> 11) as f64) < rate * (1u64 << 53) as f64
+    }
+}
+
+impl Default for SamplingPolicy {
+    /// Samples everything
+    fn default() -> Self {
+        Self::new(1.0)
+    }
+}
+
+fn clamp_rate(rate: f64) -> f64 {
+    if rate.is_nan() {
+        0.0
+    } else {
+        rate.clamp(0.0, 1.0)
+    }
+}
+
+const FNV_OFFSET: u64 = 0xcbf2_9ce4_8422_2325;
+const FNV_PRIME: u64 = 0x0000_0100_0000_01b3;
+
+fn fnv1a(mut hash: u64, bytes: &[u8]) -> u64 {
+    for &byte in bytes {
+        hash ^= u64::from(byte);
+        hash = hash.wrapping_mul(FNV_PRIME);
+    }
+    hash
+}
+
+/// splitmix64 finalizer, spreading FNV's output over all bits
+fn mix(mut value: u64) -> u64 {
+    value = (value ^ (value >> 30)).wrapping_mul(0xbf58_476d_1ce4_e5b9);
+    value = (value ^ (value >> 27)).wrapping_mul(0x94d0_49bb_1331_11eb);
+    value ^ (value >> 31)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_sampling_rates() {
+        let policy = SamplingPolicy::new(0.0)
+            .rate("always", 1.0)
+            .rate("clamped", 7.5)
+            .rate("nan", f64::NAN);
+
+        assert!(!policy.should_sample("other"));
+        assert!(policy.should_sample("always"));
+        assert_eq!(policy.rate_for("clamped"), 1.0);
+        assert_eq!(policy.rate_for("nan"), 0.0);
+        assert!(SamplingPolicy::default().should_sample("anything"));
+    }
+
+    #[test]
+    fn test_sampling_random_fraction() {
+        let policy = SamplingPolicy::new(0.25);
+        let sampled = (0..20_000)
+            .filter(|_| policy.should_sample("soft-failure"))
+            .count();
+        assert!((4_000..6_000).contains(&sampled), "sampled {sampled}");
+    }
+
+    #[test]
+    fn test_sampling_deterministic() {
+        let decide = |host: &str| {
+            SamplingPolicy::new(0.5)
+                .deterministic_key(host)
+                .should_sample("soft-failure")
+        };
+
+        // Stable for a given host, and spread across hosts
+        let hosts: Vec<String> = (0..1000).map(|i| format!("host-{i}")).collect();
+        let first: Vec<bool> = hosts.iter().map(|h| decide(h)).collect();
+        let second: Vec<bool> = hosts.iter().map(|h| decide(h)).collect();
+        assert_eq!(first, second);
+
+        let sampled = first.iter().filter(|&&s| s).count();
+        assert!((400..600).contains(&sampled), "sampled {sampled}");
+    }
+}
@@ -0,0 +1,226 @@
+use std::collections::hash_map::DefaultHasher;
+use std::fmt;
+use std::hash::{Hash, Hasher};
+use std::panic::Location;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::{Duration, Instant};
+
+/// Number of recent dump signatures remembered for deduplication
+const DEDUP_SLOTS: usize = 64;
+
+/// Rate limit and deduplication for diagnostic dumps.
+///
+/// A bad deploy can make one error path request thousands of dumps per
+/// second, and each dump captures context and blocks on a round trip to the
+/// handler. A `DumpThrottle` admits at most `max_dumps` per `period` (a token
+/// bucket allowing bursts of up to `max_dumps`) and drops repeats of the same
+/// signature within the dedup window. Rejecting a dump only reads the clock
+/// and a few atomics; there is no lock or allocation.
+///
+/// Use it through [`CrashpadClient::dump_without_crash_throttled`] and
+/// [`CrashpadClient::dump_without_crash_keyed`].
+///
+/// [`CrashpadClient::dump_without_crash_throttled`]: crate::CrashpadClient::dump_without_crash_throttled
+/// [`CrashpadClient::dump_without_crash_keyed`]: crate::CrashpadClient::dump_without_crash_keyed
+///
+/// # Example
+/// ```no_run
+/// use std::time::Duration;
+/// use crashpad_rs::{CrashpadClient, DumpThrottle};
+///
+/// # let client = CrashpadClient::new().unwrap();
+/// // At most 5 dumps a minute, and one per call site per 10 minutes
+/// let throttle = DumpThrottle::new(5, Duration::from_secs(60))
+///     .dedup_window(Duration::from_secs(600));
+///
+/// client.dump_without_crash_throttled(&throttle);
+/// ```
+pub struct DumpThrottle {
+    epoch: Instant,
+    /// Nanoseconds per token
+    interval: u64,
+    /// How far ahead of the clock the next arrival time may run
+    tolerance: u64,
+    /// Theoretical arrival time of the next dump (GCRA)
+    next_allowed: AtomicU64,
+    dedup_window: u64,
+    dedup_keys: [AtomicU64; DEDUP_SLOTS],
+    dedup_times: [AtomicU64; DEDUP_SLOTS],
+    suppressed: AtomicU64,
+}
+
+#[allow(clippy::declare_interior_mutable_const)]
+const ZERO: AtomicU64 = AtomicU64::new(0);
+
+impl DumpThrottle {
+    /// Allows up to `max_dumps` per `period`; the dedup window defaults to
+    /// `period`.
+    ///
+    /// `max_dumps` of 0 rejects every dump.
+    pub fn new(max_dumps: u32, period: Duration) -> Self {
+        let period = saturating_nanos(period);
+        let interval = (period / u64::from(max_dumps.max(1))).max(1);
+        // With no tokens at all, the next arrival never comes
+        let next_allowed = if max_dumps == 0 { u64::MAX } else { 0 };
+
+        DumpThrottle {
+            epoch: Instant::now(),
+            interval,
+            tolerance: period.saturating_sub(interval),
+            next_allowed: AtomicU64::new(next_allowed),
+            dedup_window: period,
+            dedup_keys: [ZERO; DEDUP_SLOTS],
+            dedup_times: [ZERO; DEDUP_SLOTS],
+            suppressed: AtomicU64::new(0),
+        }
+    }
+
+    /// Drops a dump whose signature was already dumped within `window`.
+    ///
+    /// A zero window disables deduplication.
+    pub fn dedup_window(mut self, window: Duration) -> Self {
+        self.dedup_window = saturating_nanos(window);
+        self
+    }
+
+    /// Number of dumps rejected so far
+    pub fn suppressed(&self) -> u64 {
+        self.suppressed.load(Ordering::Relaxed)
+    }
+
+    /// Decides whether a dump from the calling location may proceed.
+    #[track_caller]
+    pub fn allow(&self) -> bool {
+        self.allow_signature(location_signature(Location::caller()))
+    }
+
+    /// Decides whether a dump with the caller-supplied `key` may proceed.
+    pub fn allow_keyed<K: Hash + ?Sized>(&self, key: &K) -> bool {
+        let mut hasher = DefaultHasher::new();
+        key.hash(&mut hasher);
+        self.allow_signature(hasher.finish())
+    }
+
+    fn allow_signature(&self, signature: u64) -> bool {
+        // 0 marks an empty dedup slot
+        let signature = signature | 1;
+        let now = self.now();
+        let slot = (signature >> 1) as usize % DEDUP_SLOTS;
+
+        if self.dedup_window > 0
+            && self.dedup_keys[slot].load(Ordering::Relaxed) == signature
+            && now.saturating_sub(self.dedup_times[slot].load(Ordering::Relaxed))
+                < self.dedup_window
+        {
+            return self.reject();
+        }
+
+        if !self.take_token(now) {
+            return self.reject();
+        }
+
+        // Racing writers may briefly pair a key with another key's time; the
+        // worst case is one extra or one missed dump.
+        self.dedup_keys[slot].store(signature, Ordering::Relaxed);
+        self.dedup_times[slot].store(now, Ordering::Relaxed);
+        true
+    }
+
+    /// Generic cell rate algorithm: a lock-free token bucket in one word
+    fn take_token(&self, now: u64) -> bool {
+        let mut next_allowed = self.next_allowed.load(Ordering::Relaxed);
+        loop {
+            let start = next_allowed.max(now);
+            if start - now > self.tolerance {
+                return false;
+            }
+            let updated = start.saturating_add(self.interval);
+            match self.next_allowed.compare_exchange_weak(
+                next_allowed,
+                updated,
+                Ordering::Relaxed,
+                Ordering::Relaxed,
+            ) {
+                Ok(_) => return true,
+                Err(current) => next_allowed = current,
+            }
+        }
+    }
+
+    fn reject(&self) -> bool {
+        self.suppressed.fetch_add(1, Ordering::Relaxed);
+        false
+    }
+
+    fn now(&self) -> u64 {
+        saturating_nanos(self.epoch.elapsed())
+    }
+}
+
+impl fmt::Debug for DumpThrottle {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("DumpThrottle")
+            .field("interval", &Duration::from_nanos(self.interval))
+            .field("dedup_window", &Duration::from_nanos(self.dedup_window))
+            .field("suppressed", &self.suppressed())
+            .finish()
+    }
+}
+
+/// Cheap per-call-site signature; file names are static strings, so their
+/// address identifies the file within this process
+fn location_signature(location: &Location<'_>) -> u64 {
+    let file = location.file().as_ptr() as u64;
+    let position = u64::from(location.line()) << 32 | u64::from(location.column());
+    (file ^ position.rotate_left(17)).wrapping_mul(0x9E37_79B9_7F4A_7C15)
+}
+
+fn saturating_nanos(duration: Duration) -> u64 {
+    u64::try_from(duration.as_nanos()).unwrap_or(u64::MAX)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_throttle_rate_limit() {
+        let throttle = DumpThrottle::new(3, Duration::from_secs(3600)).dedup_window(Duration::ZERO);
+
+        let allowed = (0..10).filter(|_| throttle.allow_keyed("same")).count();
+        assert_eq!(allowed, 3);
+        assert_eq!(throttle.suppressed(), 7);
+    }
+
+    #[test]
+    fn test_throttle_refills() {
+        let throttle = DumpThrottle::new(1, Duration::from_millis(20)).dedup_window(Duration::ZERO);
+
+        assert!(throttle.allow_keyed("a"));
+        assert!(!throttle.allow_keyed("a"));
+        std::thread::sleep(Duration::from_millis(30));
+        assert!(throttle.allow_keyed("a"));
+    }
+
+    #[test]
+    fn test_throttle_dedup() {
+        let throttle =
+            DumpThrottle::new(100, Duration::from_secs(1)).dedup_window(Duration::from_secs(3600));
+
+        assert!(throttle.allow_keyed("timeout"));
+        assert!(!throttle.allow_keyed("timeout"));
+        assert!(throttle.allow_keyed("parse error"));
+
+        // Each call site is its own signature
+        let call_site = || throttle.allow();
+        assert!(call_site());
+        assert!(!call_site());
+        assert!(throttle.allow());
+    }
+
+    #[test]
+    fn test_throttle_zero_rejects_all() {
+        let throttle = DumpThrottle::new(0, Duration::from_secs(1));
+        assert!(!throttle.allow_keyed("anything"));
+    }
+}
@@ -0,0 +1,121 @@
+use std::env;
+use std::fmt;
+use std::str::FromStr;
+
+use crate::CrashpadError;
+
+/// Opaque reference to a running handler that another process can attach to.
+///
+/// A parent process that started a handler exports a token with
+/// [`CrashpadClient::export_handler_token`](crate::CrashpadClient::export_handler_token)
+/// and hands its string form to a child, typically through the
+/// [`HandlerToken::ENV_VAR`] environment variable. The child connects with
+/// [`CrashpadClient::attach`](crate::CrashpadClient::attach) instead of
+/// launching its own handler.
+///
+/// # Platform Behavior
+/// - **Windows**: Name of the handler's IPC pipe
+/// - **macOS**: Bootstrap name of the handler's Mach service
+/// - **Linux/Android**: Inheritable socket descriptor plus the handler pid
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct HandlerToken {
+    kind: TokenKind,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub(crate) enum TokenKind {
+    Pipe(String),
+    MachService(String),
+    Socket { fd: i32, pid: i32 },
+}
+
+impl HandlerToken {
+    /// Environment variable conventionally used to pass a token to children
+    pub const ENV_VAR: &'static str = "CRASHPAD_HANDLER_TOKEN";
+
+    pub(crate) fn new(kind: TokenKind) -> Self {
+        HandlerToken { kind }
+    }
+
+    pub(crate) fn kind(&self) -> &TokenKind {
+        &self.kind
+    }
+
+    /// Reads a token from [`HandlerToken::ENV_VAR`].
+    ///
+    /// Returns `None` if the variable is unset or does not hold a valid token.
+    pub fn from_env() -> Option<Self> {
+        env::var(Self::ENV_VAR).ok()?.parse().ok()
+    }
+}
+
+impl fmt::Display for HandlerToken {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match &self.kind {
+            TokenKind::Pipe(name) => write!(f, "pipe:{name}"),
+            TokenKind::MachService(name) => write!(f, "mach:{name}"),
+            TokenKind::Socket { fd, pid } => write!(f, "socket:{fd}:{pid}"),
+        }
+    }
+}
+
+impl FromStr for HandlerToken {
+    type Err = CrashpadError;
+
+    fn from_str(s: &str) -> Result<Self, Self::Err> {
+        let invalid = || CrashpadError::InvalidConfiguration(format!("Invalid handler token: {s}"));
+
+        let (scheme, value) = s.split_once(':').ok_or_else(invalid)?;
+        let kind = match scheme {
+            "pipe" if !value.is_empty() => TokenKind::Pipe(value.to_string()),
+            "mach" if !value.is_empty() => TokenKind::MachService(value.to_string()),
+            "socket" => {
+                let (fd, pid) = value.split_once(':').ok_or_else(invalid)?;
+                let fd = fd.parse().map_err(|_| invalid())?;
+                let pid = pid.parse().map_err(|_| invalid())?;
+                if fd < 0 {
+                    return Err(invalid());
+                }
+                TokenKind::Socket { fd, pid }
+            }
+            _ => return Err(invalid()),
+        };
+
+        Ok(HandlerToken { kind })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_token_round_trip() {
+        let tokens = [
+            HandlerToken::new(TokenKind::Pipe(r"\\.\pipe\crashpad_1234_ABCD".to_string())),
+            HandlerToken::new(TokenKind::MachService("com.example.crashpad".to_string())),
+            HandlerToken::new(TokenKind::Socket { fd: 7, pid: 4242 }),
+        ];
+
+        for token in tokens {
+            let parsed: HandlerToken = token.to_string().parse().unwrap();
+            assert_eq!(parsed, token);
+        }
+    }
+
+    #[test]
+    fn test_token_invalid() {
+        for input in [
+            "",
+            "pipe",
+            "pipe:",
+            "mach:",
+            "socket:7",
+            "socket:x:1",
+            "socket:-1:1",
+            "unknown:value",
+        ] {
+            assert!(input.parse::<HandlerToken>().is_err(), "{input:?}");
+        }
+    }
+}
@@ -0,0 +1,507 @@
+use std::collections::hash_map::RandomState;
+use std::collections::HashSet;
+use std::fmt;
+use std::hash::{BuildHasher, Hasher};
+use std::path::Path;
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::JoinHandle;
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+
+use crate::{CrashDatabase, ReportInfo, Result};
+
+const SECONDS_PER_DAY: u64 = 24 * 60 * 60;
+
+/// When and how fast an [`UploadScheduler`] releases reports for upload
+///
+/// The default releases every report as soon as it is seen, which behaves
+/// like the handler's own uploads with a short polling delay.
+#[derive(Debug, Clone, PartialEq)]
+pub struct UploadSchedule {
+    max_bytes_per_second: Option<u64>,
+    batch_size: usize,
+    jitter: Duration,
+    window: Option<(Duration, Duration)>,
+    poll_interval: Duration,
+    compression_level: Option<u32>,
+}
+
+impl Default for UploadSchedule {
+    fn default() -> Self {
+        UploadSchedule {
+            max_bytes_per_second: None,
+            batch_size: 1,
+            jitter: Duration::ZERO,
+            window: None,
+            poll_interval: Duration::from_secs(60),
+            compression_level: None,
+        }
+    }
+}
+
+impl UploadSchedule {
+    /// A schedule that releases reports immediately
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Caps the average upload volume at `bytes` per second.
+    ///
+    /// The cap applies to how quickly reports are released; a single report
+    /// is still sent at full speed by the handler.
+    pub fn max_bytes_per_second(mut self, bytes: u64) -> Self {
+        self.max_bytes_per_second = Some(bytes.max(1));
+        self
+    }
+
+    /// Waits until `count` reports are queued, then releases them together.
+    pub fn batch_size(mut self, count: usize) -> Self {
+        self.batch_size = count.max(1);
+        self
+    }
+
+    /// Delays each batch by a random time up to `jitter`, so hosts that
+    /// crashed together do not upload together.
+    pub fn jitter(mut self, jitter: Duration) -> Self {
+        self.jitter = jitter;
+        self
+    }
+
+    /// Only releases reports between `start` and `end`, measured from
+    /// midnight UTC.
+    ///
+    /// A window whose end is before its start spans midnight.
+    pub fn window(mut self, start: Duration, end: Duration) -> Self {
+        let day = Duration::from_secs(SECONDS_PER_DAY);
+        self.window = Some((
+            Duration::from_secs(start.as_secs() % day.as_secs()),
+            Duration::from_secs(end.as_secs() % day.as_secs()),
+        ));
+        self
+    }
+
+    /// How often the database is checked for queued reports
+    ///
+    /// # Default
+    /// 60 seconds
+    pub fn poll_interval(mut self, interval: Duration) -> Self {
+        self.poll_interval = interval.max(Duration::from_millis(1));
+        self
+    }
+
+    /// Gzip-compresses reports on disk while they wait for release.
+    ///
+    /// Queued reports are compressed at zlib `level` (0 to 9) the first time
+    /// the scheduler sees them and restored just before release, so a host
+    /// that cannot upload for a long time keeps a fraction of the minidump
+    /// bytes on disk. See [`CrashDatabase::compress`].
+    ///
+    /// # Default
+    /// Reports are stored uncompressed
+    pub fn compress_on_disk(mut self, level: u32) -> Self {
+        self.compression_level = Some(level.min(9));
+        self
+    }
+
+    fn in_window(&self, now: SystemTime) -> bool {
+        let Some((start, end)) = self.window else {
+            return true;
+        };
+        let since_midnight = Duration::from_secs(
+            now.duration_since(UNIX_EPOCH)
+                .map_or(0, |elapsed| elapsed.as_secs() % SECONDS_PER_DAY),
+        );
+        if start <= end {
+            start <= since_midnight && since_midnight < end
+        } else {
+            since_midnight >= start || since_midnight < end
+        }
+    }
+}
+
+/// Uploads queued crash reports on a schedule instead of immediately.
+///
+/// After a fleet-wide crash every handler would otherwise upload at once.
+/// The scheduler turns the handler's automatic uploads off in the database
+/// settings; the handler then keeps new reports without sending them. A
+/// background thread polls the database and releases queued reports with
+/// [`CrashDatabase::request_upload`] according to an [`UploadSchedule`]:
+/// only inside the upload window, once a batch has accumulated, after a
+/// random delay, and no faster than the byte budget allows.
+///
+/// Released reports are sent by the handler on its next pass over pending
+/// reports, which Crashpad runs every 15 minutes and after each new crash.
+/// Uploads stay disabled after the scheduler stops, so queued reports wait
+/// for the next scheduler instead of all being sent at once. A report is
+/// released once: if the handler's upload of it fails, the scheduler does
+/// not request it again, so an unreachable server does not get the same
+/// reports on every poll.
+///
+/// With [`UploadSchedule::compress_on_disk`], queued reports are kept
+/// gzip-compressed until they are released. The byte budget then counts
+/// compressed sizes, which is close to what the handler sends with its
+/// default gzip upload encoding.
+///
+/// # Example
+/// ```no_run
+/// use std::time::Duration;
+/// use crashpad_rs::{UploadSchedule, UploadScheduler};
+///
+/// let schedule = UploadSchedule::new()
+///     .max_bytes_per_second(256 * 1024)
+///     .batch_size(5)
+///     .jitter(Duration::from_secs(600))
+///     .window(Duration::from_secs(2 * 3600), Duration::from_secs(6 * 3600));
+/// let scheduler = UploadScheduler::start("./crashes", schedule)?;
+/// # Ok::<(), crashpad_rs::CrashpadError>(())
+/// ```
+pub struct UploadScheduler {
+    stop: Arc<(Mutex<bool>, Condvar)>,
+    worker: Option<JoinHandle<()>>,
+}
+
+impl UploadScheduler {
+    /// Takes over uploads for the database at `database_path`.
+    pub fn start<P: AsRef<Path>>(database_path: P, schedule: UploadSchedule) -> Result<Self> {
+        let database = CrashDatabase::open(database_path)?;
+        database.set_uploads_enabled(false)?;
+
+        let stop = Arc::new((Mutex::new(false), Condvar::new()));
+        let worker_stop = Arc::clone(&stop);
+        let worker = std::thread::Builder::new()
+            .name("crashpad-upload".to_string())
+            .spawn(move || run_scheduler(database, schedule, worker_stop))?;
+
+        Ok(UploadScheduler {
+            stop,
+            worker: Some(worker),
+        })
+    }
+}
+
+impl Drop for UploadScheduler {
+    fn drop(&mut self) {
+        let (stopped, cvar) = &*self.stop;
+        *stopped.lock().unwrap_or_else(|e| e.into_inner()) = true;
+        cvar.notify_all();
+        if let Some(worker) = self.worker.take() {
+            let _ = worker.join();
+        }
+    }
+}
+
+impl fmt::Debug for UploadScheduler {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("UploadScheduler").finish_non_exhaustive()
+    }
+}
+
+fn run_scheduler(
+    database: CrashDatabase,
+    schedule: UploadSchedule,
+    stop: Arc<(Mutex<bool>, Condvar)>,
+) {
+    let poll_interval = schedule.poll_interval;
+    let compression_level = schedule.compression_level;
+    let mut planner = Planner::new(schedule, Instant::now());
+    let mut compressed = HashSet::new();
+    let (stopped, cvar) = &*stop;
+
+    loop {
+        if let Ok(reports) = database.reports() {
+            let release = planner.plan(Instant::now(), SystemTime::now(), reports.clone());
+            database.request_upload(&release);
+            if let Some(level) = compression_level {
+                compress_parked(&database, &reports, &release, level, &mut compressed);
+            }
+        }
+
+        let guard = stopped.lock().unwrap_or_else(|e| e.into_inner());
+        let (guard, _) = cvar
+            .wait_timeout_while(guard, poll_interval, |stopped| !*stopped)
+            .unwrap_or_else(|e| e.into_inner());
+        if *guard {
+            return;
+        }
+    }
+}
+
+/// Compresses queued reports that were not just released
+///
+/// `compressed` remembers reports handled on earlier polls, so each report's
+/// file is only touched once while it waits.
+fn compress_parked(
+    database: &CrashDatabase,
+    reports: &[ReportInfo],
+    release: &[ReportInfo],
+    level: u32,
+    compressed: &mut HashSet<String>,
+) {
+    let released: HashSet<&str> = release.iter().map(ReportInfo::uuid).collect();
+    let parked: Vec<&ReportInfo> = reports
+        .iter()
+        .filter(|report| is_queued(report) && !released.contains(report.uuid()))
+        .collect();
+
+    database.compress(
+        parked
+            .iter()
+            .copied()
+            .filter(|report| !compressed.contains(report.uuid())),
+        level,
+    );
+    *compressed = parked
+        .iter()
+        .map(|report| report.uuid().to_string())
+        .collect();
+}
+
+/// Scheduling decisions, kept apart from the database for testing
+struct Planner {
+    schedule: UploadSchedule,
+    /// Byte budget available for release; may go negative after a large report
+    budget: f64,
+    last_plan: Instant,
+    /// When the current batch may be released, once it is full
+    release_at: Option<Instant>,
+    /// Set while a released batch is still being drained by the byte budget
+    draining: bool,
+    random: RandomState,
+    draws: u64,
+}
+
+impl Planner {
+    fn new(schedule: UploadSchedule, now: Instant) -> Self {
+        let mut planner = Planner {
+            schedule,
+            budget: 0.0,
+            last_plan: now,
+            release_at: None,
+            draining: false,
+            random: RandomState::new(),
+            draws: 0,
+        };
+        planner.budget = planner.max_budget();
+        planner
+    }
+
+    /// Budget accumulated over one poll interval, the largest burst allowed
+    fn max_budget(&self) -> f64 {
+        self.schedule.max_bytes_per_second.map_or(0.0, |rate| {
+            rate as f64 * self.schedule.poll_interval.as_secs_f64().max(1.0)
+        })
+    }
+
+    /// Reports to release now, oldest first
+    fn plan(
+        &mut self,
+        now: Instant,
+        wall: SystemTime,
+        reports: Vec<ReportInfo>,
+    ) -> Vec<ReportInfo> {
+        if let Some(rate) = self.schedule.max_bytes_per_second {
+            let elapsed = now.saturating_duration_since(self.last_plan).as_secs_f64();
+            self.budget = (self.budget + rate as f64 * elapsed).min(self.max_budget());
+        }
+        self.last_plan = now;
+
+        let mut queued: Vec<ReportInfo> = reports.into_iter().filter(is_queued).collect();
+        if queued.is_empty() {
+            self.draining = false;
+            self.release_at = None;
+        }
+        if !self.schedule.in_window(wall) {
+            self.release_at = None;
+            return Vec::new();
+        }
+        if !self.draining && queued.len() < self.schedule.batch_size {
+            self.release_at = None;
+            return Vec::new();
+        }
+
+        let jitter = self.draw_jitter();
+        let release_at = *self.release_at.get_or_insert(now + jitter);
+        if now < release_at {
+            return Vec::new();
+        }
+
+        queued.sort_by_key(ReportInfo::creation_time);
+        let queued_count = queued.len();
+        let mut release = Vec::new();
+        for report in queued {
+            if self.schedule.max_bytes_per_second.is_some() {
+                if self.budget <= 0.0 {
+                    break;
+                }
+                self.budget -= report.total_size() as f64;
+            }
+            release.push(report);
+        }
+
+        // Whatever the budget held back is part of this batch, not the next;
+        // once all of it is out, the next batch has to fill up again
+        self.draining = release.len() < queued_count;
+        if !self.draining {
+            self.release_at = None;
+        }
+        release
+    }
+
+    fn draw_jitter(&mut self) -> Duration {
+        if self.schedule.jitter.is_zero() || self.release_at.is_some() {
+            return Duration::ZERO;
+        }
+        let mut hasher = self.random.build_hasher();
+        hasher.write_u64(self.draws);
+        self.draws += 1;
+        let fraction = (hasher.finish() >> 11) as f64 / (1u64 << 53) as f64;
+        self.schedule.jitter.mul_f64(fraction)
+    }
+}
+
+/// Reports the handler set aside because uploads are disabled
+///
+/// Reports with an upload attempt were released before and failed; they are
+/// not released again.
+fn is_queued(report: &ReportInfo) -> bool {
+    !report.is_pending()
+        && !report.is_uploaded()
+        && !report.upload_explicitly_requested()
+        && report.upload_attempts() == 0
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn queued(count: usize, size: u64, now: SystemTime) -> Vec<ReportInfo> {
+        (0..count)
+            .map(|i| {
+                let mut report =
+                    ReportInfo::for_test(&format!("report-{i}"), 100 - i as u64, size, now);
+                report.set_pending_for_test(false);
+                report
+            })
+            .collect()
+    }
+
+    #[test]
+    fn test_schedule_releases_everything_by_default() {
+        let wall = SystemTime::now();
+        let now = Instant::now();
+        let mut planner = Planner::new(UploadSchedule::new(), now);
+
+        let release = planner.plan(now, wall, queued(3, 1000, wall));
+        assert_eq!(release.len(), 3);
+        assert_eq!(release[0].uuid(), "report-0");
+    }
+
+    #[test]
+    fn test_schedule_batches() {
+        let wall = SystemTime::now();
+        let now = Instant::now();
+        let mut planner = Planner::new(UploadSchedule::new().batch_size(3), now);
+
+        assert!(planner.plan(now, wall, queued(2, 1000, wall)).is_empty());
+        assert_eq!(planner.plan(now, wall, queued(3, 1000, wall)).len(), 3);
+    }
+
+    #[test]
+    fn test_schedule_byte_budget() {
+        let wall = SystemTime::now();
+        let now = Instant::now();
+        let schedule = UploadSchedule::new()
+            .max_bytes_per_second(1000)
+            .poll_interval(Duration::from_secs(1))
+            .batch_size(4);
+        let mut planner = Planner::new(schedule, now);
+
+        // 1000 bytes of budget releases two 600-byte reports (going into debt)
+        assert_eq!(planner.plan(now, wall, queued(4, 600, wall)).len(), 2);
+        // The rest of the batch drains as the budget refills, below batch size
+        let later = now + Duration::from_millis(100);
+        assert!(planner.plan(later, wall, queued(2, 600, wall)).is_empty());
+        let later = now + Duration::from_secs(2);
+        assert_eq!(planner.plan(later, wall, queued(2, 600, wall)).len(), 2);
+        // With the batch drained, a new arrival waits for a full batch again
+        let later = now + Duration::from_secs(4);
+        assert!(planner.plan(later, wall, queued(1, 600, wall)).is_empty());
+        assert_eq!(planner.plan(later, wall, queued(4, 600, wall)).len(), 2);
+    }
+
+    #[test]
+    fn test_schedule_batch_threshold_after_release() {
+        let wall = SystemTime::now();
+        let now = Instant::now();
+        let mut planner = Planner::new(UploadSchedule::new().batch_size(3), now);
+
+        assert_eq!(planner.plan(now, wall, queued(3, 1000, wall)).len(), 3);
+        assert!(planner.plan(now, wall, queued(1, 1000, wall)).is_empty());
+        assert!(planner.plan(now, wall, queued(2, 1000, wall)).is_empty());
+        assert_eq!(planner.plan(now, wall, queued(3, 1000, wall)).len(), 3);
+    }
+
+    #[test]
+    fn test_schedule_jitter() {
+        let wall = SystemTime::now();
+        let now = Instant::now();
+        let schedule = UploadSchedule::new().jitter(Duration::from_secs(60));
+        let mut planner = Planner::new(schedule, now);
+
+        // Released once the random delay has passed, never before
+        let first = planner.plan(now, wall, queued(1, 10, wall));
+        let release_at = planner.release_at.unwrap();
+        assert!(release_at <= now + Duration::from_secs(60));
+        assert_eq!(first.is_empty(), release_at > now);
+
+        let after = planner.plan(now + Duration::from_secs(61), wall, queued(1, 10, wall));
+        assert_eq!(after.len(), 1);
+    }
+
+    #[test]
+    fn test_schedule_window() {
+        let midnight = UNIX_EPOCH + Duration::from_secs(20_000 * SECONDS_PER_DAY);
+        let at = |hours: u64| midnight + Duration::from_secs(hours * 3600);
+
+        let night = UploadSchedule::new().window(
+            Duration::from_secs(22 * 3600),
+            Duration::from_secs(4 * 3600),
+        );
+        assert!(night.in_window(at(23)));
+        assert!(night.in_window(at(2)));
+        assert!(!night.in_window(at(12)));
+
+        let day = UploadSchedule::new().window(
+            Duration::from_secs(9 * 3600),
+            Duration::from_secs(17 * 3600),
+        );
+        assert!(day.in_window(at(9)));
+        assert!(!day.in_window(at(17)));
+
+        let now = Instant::now();
+        let mut planner = Planner::new(night, now);
+        assert!(planner.plan(now, at(12), queued(1, 10, at(12))).is_empty());
+        assert_eq!(planner.plan(now, at(23), queued(1, 10, at(23))).len(), 1);
+    }
+
+    #[test]
+    fn test_schedule_ignores_pending_and_requested() {
+        let wall = SystemTime::now();
+        let now = Instant::now();
+        let mut planner = Planner::new(UploadSchedule::new(), now);
+
+        let pending = vec![ReportInfo::for_test("new", 1, 10, wall)];
+        assert!(planner.plan(now, wall, pending).is_empty());
+    }
+
+    #[test]
+    fn test_schedule_does_not_retry_failed_uploads() {
+        let wall = SystemTime::now();
+        let now = Instant::now();
+        let mut planner = Planner::new(UploadSchedule::new(), now);
+
+        let mut failed = queued(1, 10, wall);
+        failed[0].record_upload_for_test(false);
+        assert!(planner.plan(now, wall, failed.clone()).is_empty());
+        assert!(planner.plan(now, wall, failed).is_empty());
+    }
+}
@@ -0,0 +1,106 @@
+//! Handler health in forked children
+//!
+//! Kills the handler, so it runs in its own test binary rather than next to
+//! tests that need one.
+
+#[cfg(any(target_os = "linux", target_os = "android"))]
+#[cfg(test)]
+mod fork_tests {
+    use crashpad_rs::{CrashpadClient, HandlerState};
+    use std::collections::HashMap;
+    use std::path::PathBuf;
+    use std::time::{Duration, Instant};
+    use tempfile::TempDir;
+
+    #[test]
+    fn test_forked_child_sees_handler_loss() {
+        let handler_path = find_crashpad_handler();
+        if !handler_path.exists() {
+            println!("Handler not found, skipping forked child test");
+            return;
+        }
+
+        let temp_dir = TempDir::new().expect("Should be able to create temp directory");
+        let client = CrashpadClient::new().expect("CrashpadClient::new() should succeed");
+        client
+            .start_handler(
+                &handler_path,
+                &temp_dir.path().join("crashpad_db"),
+                &temp_dir.path().join("crashpad_metrics"),
+                None,
+                &HashMap::new(),
+            )
+            .expect("Handler should start");
+        let handler_pid = client.handler_status().pid().expect("Handler pid is known");
+
+        let mut ready = [0; 2];
+        assert_eq!(unsafe { libc::pipe(ready.as_mut_ptr()) }, 0);
+        let child = unsafe { libc::fork() };
+        assert!(child >= 0, "fork should succeed");
+        if child == 0 {
+            // Only the child's own status queries from here on; never return
+            // into the test harness
+            let running = client.handler_status().state() == HandlerState::Running;
+            unsafe { libc::write(ready[1], [1u8].as_ptr().cast(), 1) };
+            let deadline = Instant::now() + Duration::from_secs(10);
+            let mut lost = false;
+            while running && Instant::now() < deadline {
+                if client.handler_status().state() == HandlerState::Lost {
+                    lost = true;
+                    break;
+                }
+                std::thread::sleep(Duration::from_millis(10));
+            }
+            unsafe { libc::_exit(if lost { 0 } else { 1 }) };
+        }
+
+        let mut byte = 0u8;
+        assert_eq!(
+            unsafe { libc::read(ready[0], (&mut byte as *mut u8).cast(), 1) },
+            1
+        );
+        assert_eq!(unsafe { libc::kill(handler_pid as i32, libc::SIGKILL) }, 0);
+
+        let mut status = 0;
+        assert_eq!(unsafe { libc::waitpid(child, &mut status, 0) }, child);
+        assert!(
+            libc::WIFEXITED(status) && libc::WEXITSTATUS(status) == 0,
+            "Forked child should see the handler as lost"
+        );
+        println!("✓ Forked child noticed the handler going away");
+    }
+
+    fn find_crashpad_handler() -> PathBuf {
+        let platform = format!(
+            "{}-{}",
+            std::env::consts::OS,
+            if cfg!(target_arch = "x86_64") {
+                "x64"
+            } else {
+                "arm64"
+            }
+        );
+
+        // Look in build location
+        let possible_paths = vec![
+            format!(
+                "third_party/crashpad_checkout/crashpad/out/{}/crashpad_handler",
+                platform
+            ),
+            format!(
+                "../third_party/crashpad_checkout/crashpad/out/{}/crashpad_handler",
+                platform
+            ),
+        ];
+
+        for path_str in possible_paths {
+            let path = PathBuf::from(path_str);
+            if path.exists() {
+                return path;
+            }
+        }
+
+        // Return dummy path if not found (test will handle it)
+        PathBuf::from("crashpad_handler")
+    }
+}
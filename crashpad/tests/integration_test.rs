@@ -1,6 +1,10 @@
-use crashpad_rs::CrashpadClient;
+use crashpad_rs::{
+    Annotation, AnnotationSlot, AsyncDumper, CrashDatabase, CrashpadClient, CrashpadConfig,
+    HandlerStartMode, RetentionPolicy,
+};
 use std::collections::HashMap;
 use std::path::PathBuf;
+use std::time::Duration;
 use tempfile::TempDir;
 
 #[test]
@@ -120,6 +124,319 @@ fn test_with_annotations() {
     }
 }
 
+#[test]
+fn test_background_start() {
+    let client = CrashpadClient::new().expect("CrashpadClient::new() should succeed");
+
+    let temp_dir = TempDir::new().expect("Should be able to create temp directory");
+    let handler_path = find_crashpad_handler();
+
+    let config = CrashpadConfig::builder()
+        .handler_path(&handler_path)
+        .database_path(temp_dir.path().join("crashpad_db"))
+        .metrics_path(temp_dir.path().join("crashpad_metrics"))
+        .handler_start_mode(HandlerStartMode::Background)
+        .build();
+
+    let result = client.start_with_config(&config, &HashMap::new());
+
+    if handler_path.exists() {
+        assert!(result.is_ok(), "Background start should return: {result:?}");
+        let startup = client
+            .handler_startup()
+            .expect("Background start should provide a completion handle");
+        let outcome = startup.wait_timeout(Duration::from_secs(10));
+        assert!(
+            matches!(outcome, Some(Ok(()))),
+            "Handler should finish starting in the background: {outcome:?}"
+        );
+        assert!(startup.is_complete());
+        // Tests share the process-wide status, so only check what they
+        // cannot undo
+        let status = client.handler_status();
+        assert!(status.starts() >= 1, "Start should be counted: {status:?}");
+        assert!(status.max_handshake() > Duration::ZERO);
+        println!("✓ Handler started in the background");
+    } else {
+        println!("Handler not found, skipping background start test");
+    }
+}
+
+#[cfg(any(target_os = "linux", target_os = "android"))]
+#[test]
+fn test_background_start_retry() {
+    let client = CrashpadClient::new().expect("CrashpadClient::new() should succeed");
+
+    // A handler that exists but cannot be executed fails every start
+    let temp_dir = TempDir::new().expect("Should be able to create temp directory");
+    let handler_path = temp_dir.path().join("crashpad_handler");
+    std::fs::write(&handler_path, "not a handler").expect("Should write the fake handler");
+
+    let config = CrashpadConfig::builder()
+        .handler_path(&handler_path)
+        .database_path(temp_dir.path().join("crashpad_db"))
+        .metrics_path(temp_dir.path().join("crashpad_metrics"))
+        .handler_start_mode(HandlerStartMode::Background)
+        .build();
+
+    for attempt in 1..=2 {
+        let result = client.start_with_config(&config, &HashMap::new());
+        assert!(
+            result.is_ok(),
+            "Background start attempt {attempt} should return: {result:?}"
+        );
+        let outcome = client
+            .handler_startup()
+            .expect("Background start should provide a completion handle")
+            .wait_timeout(Duration::from_secs(10));
+        assert!(
+            matches!(outcome, Some(Err(_))),
+            "Start attempt {attempt} should fail: {outcome:?}"
+        );
+    }
+    println!("✓ Failed background start can be retried");
+}
+
+#[test]
+fn test_async_dump() {
+    let client = CrashpadClient::new().expect("CrashpadClient::new() should succeed");
+
+    let temp_dir = TempDir::new().expect("Should be able to create temp directory");
+    let handler_path = find_crashpad_handler();
+    if !handler_path.exists() {
+        println!("Handler not found, skipping async dump test");
+        return;
+    }
+
+    let config = CrashpadConfig::builder()
+        .handler_path(&handler_path)
+        .database_path(temp_dir.path().join("crashpad_db"))
+        .metrics_path(temp_dir.path().join("crashpad_metrics"))
+        .build();
+    client
+        .start_with_config(&config, &HashMap::new())
+        .expect("Handler should start");
+
+    let dumper = AsyncDumper::new().expect("Dumper thread should start");
+    let pending = dumper.dump().expect("Dump should be queued");
+    assert!(
+        pending.wait_timeout(Duration::from_secs(30)),
+        "Queued dump should complete"
+    );
+    // Recorded before the dump is marked complete
+    assert!(CrashpadClient::dump_latency().request().count() >= 1);
+    println!("✓ Dump written from the dumper thread");
+}
+
+#[test]
+#[cfg(not(any(target_os = "ios", target_os = "tvos", target_os = "watchos")))]
+fn test_attachments() {
+    let client = CrashpadClient::new().expect("CrashpadClient::new() should succeed");
+
+    let temp_dir = TempDir::new().expect("Should be able to create temp directory");
+    let handler_path = find_crashpad_handler();
+    if !handler_path.exists() {
+        println!("Handler not found, skipping attachment test");
+        return;
+    }
+
+    let log_path = temp_dir.path().join("app.log");
+    let log: Vec<u8> = (0..10_000u32).map(|i| b'a' + (i % 26) as u8).collect();
+    std::fs::write(&log_path, &log).expect("Should write log");
+
+    let database_path = temp_dir.path().join("crashpad_db");
+    let config = CrashpadConfig::builder()
+        .handler_path(&handler_path)
+        .database_path(&database_path)
+        .metrics_path(temp_dir.path().join("crashpad_metrics"))
+        .attachment(&log_path, 1000, true)
+        .build();
+    client
+        .start_with_config(&config, &HashMap::new())
+        .expect("Handler should start");
+
+    // Only the capped tail is handed to the handler
+    let staged_path = database_path
+        .join("staged-attachments")
+        .join(std::process::id().to_string())
+        .join("app.log");
+    let staged = std::fs::read(&staged_path).expect("Staged attachment should exist");
+    assert_eq!(staged, &log[log.len() - 1000..]);
+
+    std::fs::write(&log_path, b"short").expect("Should rewrite log");
+    client
+        .refresh_attachments()
+        .expect("Refresh should succeed");
+    assert_eq!(std::fs::read(&staged_path).unwrap(), b"short");
+    println!("✓ Attachment staged and refreshed");
+}
+
+#[test]
+fn test_crash_database() {
+    let temp_dir = TempDir::new().expect("Should be able to create temp directory");
+    let database =
+        CrashDatabase::open(temp_dir.path().join("crashpad_db")).expect("Database should open");
+
+    // A fresh database has no reports and nothing to prune
+    assert!(database
+        .reports()
+        .expect("Listing should succeed")
+        .is_empty());
+    assert!(database.pending_reports().unwrap().is_empty());
+    assert!(database.completed_reports().unwrap().is_empty());
+    let counters = database.counters().expect("Counters should be readable");
+    assert_eq!(counters.reports(), 0);
+    assert_eq!(counters.last_upload_attempt_time(), None);
+
+    let policy = RetentionPolicy::new().max_count(0);
+    assert_eq!(database.prune(&policy).unwrap(), 0);
+    assert_eq!(database.delete(&[]), 0);
+    assert_eq!(database.compress(&[], 6), 0);
+    assert_eq!(database.decompress(&[]), 0);
+}
+
+#[test]
+#[cfg(any(target_os = "linux", target_os = "android"))]
+fn test_handler_socket_export() {
+    let client = CrashpadClient::new().expect("CrashpadClient::new() should succeed");
+
+    // Nothing to export before a handler is running
+    assert!(client.handler_socket().is_err());
+
+    let temp_dir = TempDir::new().expect("Should be able to create temp directory");
+    let handler_path = find_crashpad_handler();
+    if !handler_path.exists() {
+        println!("Handler not found, skipping handler socket test");
+        return;
+    }
+
+    client
+        .start_handler(
+            &handler_path,
+            &temp_dir.path().join("crashpad_db"),
+            &temp_dir.path().join("crashpad_metrics"),
+            None,
+            &HashMap::new(),
+        )
+        .expect("Handler should start");
+
+    let socket = client
+        .handler_socket()
+        .expect("Running handler should expose its socket");
+    assert!(socket.fd() >= 0);
+    assert!(socket.pid() > 0);
+
+    let inheritable = socket
+        .dup_inheritable()
+        .expect("Handler socket should be duplicable");
+    drop(inheritable);
+    println!("✓ Handler socket exported");
+}
+
+#[test]
+#[cfg(any(target_os = "linux", target_os = "android"))]
+fn test_first_chance_handler() {
+    use crashpad_rs::SignalInfo;
+    use std::sync::atomic::{AtomicBool, Ordering};
+
+    static INTERCEPTED: AtomicBool = AtomicBool::new(false);
+
+    fn intercept(info: &SignalInfo) -> bool {
+        if info.signal() != libc::SIGSEGV {
+            return false;
+        }
+        INTERCEPTED.store(true, Ordering::SeqCst);
+        true
+    }
+
+    let handler_path = find_crashpad_handler();
+    if !handler_path.exists() {
+        println!("Handler not found, skipping first-chance handler test");
+        return;
+    }
+
+    // Set before the start, which hands it to Crashpad's signal handler
+    CrashpadClient::set_first_chance_handler(Some(intercept));
+
+    let client = CrashpadClient::new().expect("CrashpadClient::new() should succeed");
+    let temp_dir = TempDir::new().expect("Should be able to create temp directory");
+    client
+        .start_handler(
+            &handler_path,
+            &temp_dir.path().join("crashpad_db"),
+            &temp_dir.path().join("crashpad_metrics"),
+            None,
+            &HashMap::new(),
+        )
+        .expect("Handler should start");
+
+    // Handled first-chance: the signal returns here with no dump
+    unsafe { libc::raise(libc::SIGSEGV) };
+    assert!(INTERCEPTED.load(Ordering::SeqCst));
+
+    CrashpadClient::set_first_chance_handler(None);
+    println!("✓ First-chance handler intercepted the signal");
+}
+
+#[test]
+fn test_annotation_slot() {
+    let slot = AnnotationSlot::new("request_id", 16).expect("Slot should be created");
+    assert_eq!(slot.capacity(), 16);
+
+    // Updates are plain copies and may be repeated freely
+    for i in 0..1000 {
+        slot.set(&format!("req-{i}"));
+    }
+    slot.set("a value longer than the slot capacity");
+    slot.clear();
+
+    assert!(AnnotationSlot::new("", 16).is_err());
+    assert!(AnnotationSlot::new("empty", 0).is_err());
+    assert!(AnnotationSlot::new("huge", AnnotationSlot::max_capacity() + 1).is_err());
+
+    // Crashpad needs value sizes below kValueMaxSize (20480 bytes)
+    let max = AnnotationSlot::max_capacity();
+    assert_eq!(max, 20479);
+    assert!(AnnotationSlot::new("largest", max).is_ok());
+    assert!(AnnotationSlot::new("too_large", 20480).is_err());
+}
+
+#[test]
+fn test_static_annotation() {
+    static SHARD: Annotation<16> = Annotation::new("shard");
+    static BUILD_FLAVOR: Annotation<20479> = Annotation::new("build_flavor");
+
+    assert_eq!(SHARD.name(), "shard");
+    for i in 0..1000 {
+        SHARD.set_fmt(format_args!("shard-{i}"));
+    }
+    SHARD.set("a value longer than sixteen bytes");
+    SHARD.clear();
+
+    // The largest compile-time size is the largest Crashpad accepts
+    assert_eq!(AnnotationSlot::max_capacity(), 20479);
+    BUILD_FLAVOR.set("release");
+}
+
+#[test]
+fn test_excluded_memory_range() {
+    // Page-sized and larger, so Linux also marks it for core dumps
+    let arena = vec![0u8; 1 << 20];
+    let (address, len) = (arena.as_ptr(), arena.len());
+
+    CrashpadClient::exclude_memory_range(address, len).expect("Range should be excluded");
+    // Overlapping exclusions are independent
+    CrashpadClient::exclude_memory_range(address, len / 2).expect("Range should be excluded");
+    assert!(CrashpadClient::exclude_memory_range(address, 0).is_err());
+
+    assert!(CrashpadClient::remove_excluded_memory_range(address, len));
+    assert!(CrashpadClient::remove_excluded_memory_range(
+        address,
+        len / 2
+    ));
+    assert!(!CrashpadClient::remove_excluded_memory_range(address, len));
+}
+
 // Helper function to find the built crashpad_handler
 fn find_crashpad_handler() -> PathBuf {
     let platform = format!(
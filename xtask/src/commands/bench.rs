@@ -0,0 +1,192 @@
+use anyhow::{Context, Result};
+use serde_json::{json, Value};
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::time::SystemTime;
+use xshell::{cmd, Shell};
+
+use crate::utils::find_workspace_root;
+
+/// Run the client benchmarks and collect the results into one JSON file
+///
+/// With a `baseline` results file, also prints how binary sizes, idle RSS
+/// and each benchmark's mean changed relative to it.
+pub fn bench(
+    sh: &Shell,
+    filter: Option<String>,
+    output: Option<PathBuf>,
+    baseline: Option<PathBuf>,
+) -> Result<()> {
+    println!("Running benchmarks...");
+
+    let workspace_root = find_workspace_root(sh)?;
+    sh.change_dir(&workspace_root);
+
+    let out_dir = workspace_root.join("target").join("crashpad-bench");
+    sh.create_dir(&out_dir)?;
+    let rss_path = out_dir.join("handler_rss.json");
+    let size_path = out_dir.join("binary_size.json");
+    for path in [&rss_path, &size_path] {
+        if path.exists() {
+            sh.remove_path(path)?;
+        }
+    }
+
+    // Criterion keeps results of earlier runs; only collect this run's
+    let started = SystemTime::now();
+    let filter: Vec<String> = filter.into_iter().collect();
+    cmd!(
+        sh,
+        "cargo bench --package crashpad-rs --bench client -- {filter...}"
+    )
+    .env("CRASHPAD_BENCH_OUT", &out_dir)
+    .run()?;
+
+    println!("📊 Collecting results...");
+    let mut benchmarks = Vec::new();
+    collect_estimates(
+        &workspace_root.join("target").join("criterion"),
+        started,
+        &mut benchmarks,
+    )?;
+    benchmarks.sort_by(|a, b| a["id"].as_str().cmp(&b["id"].as_str()));
+
+    let read_optional = |path: &Path| -> Result<Value> {
+        match fs::read_to_string(path) {
+            Ok(content) => Ok(serde_json::from_str(&content)?),
+            Err(_) => Ok(Value::Null),
+        }
+    };
+
+    let results = json!({
+        "crashpad_revision": crashpad_revision(sh, &workspace_root),
+        "timestamp": chrono::Utc::now().to_rfc3339(),
+        "os": std::env::consts::OS,
+        "arch": std::env::consts::ARCH,
+        "optimize": std::env::var("CRASHPAD_OPTIMIZE").unwrap_or_else(|_| "default".to_string()),
+        "binary_size": read_optional(&size_path)?,
+        "handler_rss": read_optional(&rss_path)?,
+        "benchmarks": benchmarks,
+    });
+
+    let output = output.unwrap_or_else(|| out_dir.join("results.json"));
+    fs::write(&output, serde_json::to_string_pretty(&results)?)
+        .with_context(|| format!("Failed to write {}", output.display()))?;
+
+    println!(
+        "✅ {} benchmark results written to {}",
+        results["benchmarks"].as_array().map_or(0, Vec::len),
+        output.display()
+    );
+
+    if let Some(baseline) = baseline {
+        let content = fs::read_to_string(&baseline)
+            .with_context(|| format!("Failed to read {}", baseline.display()))?;
+        print_deltas(&serde_json::from_str(&content)?, &results);
+    }
+    Ok(())
+}
+
+/// Print the relative change of every metric present in both result files
+fn print_deltas(baseline: &Value, results: &Value) {
+    println!(
+        "📈 Compared to baseline ({} → {}):",
+        baseline["optimize"].as_str().unwrap_or("default"),
+        results["optimize"].as_str().unwrap_or("default")
+    );
+
+    let print = |name: &str, before: &Value, after: &Value| {
+        if let (Some(before), Some(after)) = (before.as_f64(), after.as_f64()) {
+            let percent = if before > 0.0 {
+                (after - before) / before * 100.0
+            } else {
+                0.0
+            };
+            println!("  {name:<48} {before:>14.0} → {after:>14.0} ({percent:+.1}%)");
+        }
+    };
+
+    for (section, field) in [
+        ("binary_size", "handler_bytes"),
+        ("binary_size", "bench_bytes"),
+        ("handler_rss", "rss_kib"),
+        ("handler_rss", "peak_rss_kib"),
+    ] {
+        print(
+            &format!("{section}.{field}"),
+            &baseline[section][field],
+            &results[section][field],
+        );
+    }
+
+    let empty = Vec::new();
+    let before = baseline["benchmarks"].as_array().unwrap_or(&empty);
+    for benchmark in results["benchmarks"].as_array().unwrap_or(&empty) {
+        let id = &benchmark["id"];
+        if let Some(old) = before.iter().find(|old| &old["id"] == id) {
+            print(
+                &format!("{} (mean ns)", id.as_str().unwrap_or("?")),
+                &old["mean_ns"],
+                &benchmark["mean_ns"],
+            );
+        }
+    }
+}
+
+/// Revision of the pinned Crashpad submodule, to compare runs across upgrades
+fn crashpad_revision(sh: &Shell, workspace_root: &Path) -> Value {
+    let _dir = sh.push_dir(workspace_root.join("crashpad-sys/third_party/crashpad"));
+    match cmd!(sh, "git rev-parse HEAD").quiet().read() {
+        Ok(rev) => Value::String(rev.trim().to_string()),
+        Err(_) => Value::Null,
+    }
+}
+
+/// Find criterion's `new/estimates.json` files written since `since`
+fn collect_estimates(dir: &Path, since: SystemTime, benchmarks: &mut Vec<Value>) -> Result<()> {
+    let Ok(entries) = fs::read_dir(dir) else {
+        return Ok(());
+    };
+
+    for entry in entries {
+        let path = entry?.path();
+        if !path.is_dir() {
+            continue;
+        }
+
+        let new_dir = path.join("new");
+        let estimates_path = new_dir.join("estimates.json");
+        let fresh = fs::metadata(&estimates_path)
+            .and_then(|metadata| metadata.modified())
+            .is_ok_and(|modified| modified >= since);
+        if fresh {
+            benchmarks.push(read_benchmark(&new_dir)?);
+        }
+        collect_estimates(&path, since, benchmarks)?;
+    }
+    Ok(())
+}
+
+fn read_benchmark(new_dir: &Path) -> Result<Value> {
+    let read = |name: &str| -> Result<Value> {
+        let content = fs::read_to_string(new_dir.join(name))
+            .with_context(|| format!("Failed to read {}", new_dir.join(name).display()))?;
+        Ok(serde_json::from_str(&content)?)
+    };
+    let benchmark = read("benchmark.json")?;
+    let estimates = read("estimates.json")?;
+
+    Ok(json!({
+        "id": benchmark["full_id"],
+        "group": benchmark["group_id"],
+        "function": benchmark["function_id"],
+        "parameter": benchmark["value_str"],
+        "mean_ns": estimates["mean"]["point_estimate"],
+        "mean_ci_ns": [
+            estimates["mean"]["confidence_interval"]["lower_bound"],
+            estimates["mean"]["confidence_interval"]["upper_bound"],
+        ],
+        "median_ns": estimates["median"]["point_estimate"],
+        "std_dev_ns": estimates["std_dev"]["point_estimate"],
+    }))
+}
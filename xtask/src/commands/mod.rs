@@ -1,3 +1,4 @@
+pub mod bench;
 pub mod build;
 pub mod deps;
 pub mod dist;
@@ -6,6 +7,7 @@ pub mod symlink;
 pub mod test;
 pub mod tools;
 
+pub use bench::bench;
 pub use build::build;
 pub use deps::update_deps;
 pub use dist::dist;
@@ -9,34 +9,49 @@ struct BuildArtifacts {
     out_dir: PathBuf, // The entire OUT_DIR from vendored-depot build
 }
 
-/// Build prebuilt packages for distribution
-pub fn build_prebuilt(sh: &Shell, target: Option<String>) -> Result<()> {
-    println!("🔨 Building prebuilt package...");
-
+/// Build prebuilt packages for distribution, one per target
+pub fn build_prebuilt(sh: &Shell, targets: Vec<String>) -> Result<()> {
     let workspace_root = find_workspace_root(sh)?;
     sh.change_dir(&workspace_root);
 
-    // Get target triple
-    let target = target.unwrap_or_else(|| {
-        std::env::var("TARGET").unwrap_or_else(|_| {
-            // Detect current platform
-            let output = std::process::Command::new("rustc")
-                .args(["-vV"])
-                .output()
-                .expect("Failed to get rustc version");
-            let output_str = String::from_utf8_lossy(&output.stdout);
-
-            // Extract host triple from rustc output
-            for line in output_str.lines() {
-                if line.starts_with("host:") {
-                    return line.split_whitespace().nth(1).unwrap().to_string();
-                }
+    let targets = if targets.is_empty() {
+        vec![default_target()]
+    } else {
+        targets
+    };
+    for target in &targets {
+        build_prebuilt_target(sh, &workspace_root, target)?;
+    }
+
+    if targets.len() > 1 {
+        println!("\n✅ Built prebuilt packages for {}", targets.join(", "));
+    }
+    Ok(())
+}
+
+/// Target triple from TARGET, or the host's
+fn default_target() -> String {
+    std::env::var("TARGET").unwrap_or_else(|_| {
+        // Detect current platform
+        let output = std::process::Command::new("rustc")
+            .args(["-vV"])
+            .output()
+            .expect("Failed to get rustc version");
+        let output_str = String::from_utf8_lossy(&output.stdout);
+
+        // Extract host triple from rustc output
+        for line in output_str.lines() {
+            if line.starts_with("host:") {
+                return line.split_whitespace().nth(1).unwrap().to_string();
             }
+        }
 
-            panic!("Could not determine target triple");
-        })
-    });
+        panic!("Could not determine target triple");
+    })
+}
 
+fn build_prebuilt_target(sh: &Shell, workspace_root: &Path, target: &str) -> Result<()> {
+    println!("🔨 Building prebuilt package...");
     println!("📦 Target: {}", target);
 
     // Build crashpad using appropriate feature for platform
@@ -50,12 +65,12 @@ pub fn build_prebuilt(sh: &Shell, target: Option<String>) -> Result<()> {
     cmd!(sh, "cargo build --package crashpad-rs-sys --release --no-default-features --features {feature} --target {target}").run()?;
 
     // Get package version
-    let version = get_package_version(&workspace_root)?;
+    let version = get_package_version(workspace_root)?;
     println!("📌 Version: {}", version);
 
     // Find the OUT_DIR from vendored-depot build
     println!("📂 Finding build output directory...");
-    let out_dir = find_build_output_dir(&workspace_root, &target)?;
+    let out_dir = find_build_output_dir(workspace_root, target)?;
     println!("  Found OUT_DIR: {}", out_dir.display());
 
     let artifacts = BuildArtifacts { out_dir };
@@ -63,7 +78,7 @@ pub fn build_prebuilt(sh: &Shell, target: Option<String>) -> Result<()> {
     // Create prebuilt directory structure in target/ first
     let prebuilt_dir = workspace_root
         .join("target")
-        .join(&target)
+        .join(target)
         .join("crashpad-prebuilt")
         .join(&version);
 
@@ -85,7 +100,7 @@ pub fn build_prebuilt(sh: &Shell, target: Option<String>) -> Result<()> {
     }
 
     // 2. Copy platform-specific libraries and handler
-    match target.as_str() {
+    match target {
         t if t.contains("windows") => {
             // Copy crashpad_wrapper.lib
             let wrapper_lib_src = artifacts.out_dir.join("crashpad_wrapper.lib");
@@ -149,6 +164,15 @@ pub fn build_prebuilt(sh: &Shell, target: Option<String>) -> Result<()> {
                     handler_src.display()
                 );
             }
+
+            // Copy crashpad_wer.dll, the WER module shipped next to the handler
+            let wer_src = crashpad_build_dir.join("crashpad_wer.dll");
+            if wer_src.exists() {
+                fs::copy(&wer_src, prebuilt_dir.join("crashpad_wer.dll"))?;
+                println!("  ✓ crashpad_wer.dll");
+            } else {
+                println!("  ⚠ crashpad_wer.dll not found at {}", wer_src.display());
+            }
         }
         t if t.contains("apple") || t.contains("linux") || t.contains("android") => {
             // Copy wrapper library
@@ -162,7 +186,7 @@ pub fn build_prebuilt(sh: &Shell, target: Option<String>) -> Result<()> {
             // Copy actual crashpad libraries from build/obj
             let crashpad_build_dir = workspace_root
                 .join("target")
-                .join(&target)
+                .join(target)
                 .join("release")
                 .join("crashpad_build")
                 .join("obj");
@@ -216,14 +240,14 @@ pub fn build_prebuilt(sh: &Shell, target: Option<String>) -> Result<()> {
                     // Android: handler is in release directory with .so extension
                     workspace_root
                         .join("target")
-                        .join(&target)
+                        .join(target)
                         .join("release")
                         .join(handler_name)
                 } else {
                     // Others: handler is in crashpad_build directory
                     workspace_root
                         .join("target")
-                        .join(&target)
+                        .join(target)
                         .join("release")
                         .join("crashpad_build")
                         .join(handler_name)
@@ -281,51 +305,72 @@ pub fn build_prebuilt(sh: &Shell, target: Option<String>) -> Result<()> {
     let checksum_path = PathBuf::from(checksum_path);
     fs::write(&checksum_path, format!("{}  {}\n", digest, archive_name))?;
 
-    // Simulate GitHub download by copying to cache and extracting
-    println!("\n📥 Simulating GitHub download to cache...");
-    let cache_dir = std::env::var("CRASHPAD_CACHE_DIR")
+    // Install in the local cache exactly as a verified download would
+    println!("\n📥 Installing in the local content store...");
+    let cache_dir = install_in_store(sh, &archive_path, &digest, &version, target)?;
+
+    println!("\n✅ Prebuilt package created:");
+    println!("  📁 Build: {}", prebuilt_dir.display());
+    println!("  📁 Cache: {}", cache_dir.display());
+    println!("  📦 Archive: {}", archive_path.display());
+    println!("  🔐 Checksum: {}", checksum_path.display());
+    println!("\n📤 Ready to upload to GitHub Releases!");
+    println!("\n🧪 Test locally with: cargo build --package crashpad-rs-sys --features prebuilt");
+
+    Ok(())
+}
+
+/// Put `archive` in the content-addressed store and point the prebuilt
+/// cache for `version` and `target` at it, mirroring crashpad-sys's
+/// build/prebuilt.rs
+///
+/// An archive the store already has is not extracted again.
+fn install_in_store(
+    sh: &Shell,
+    archive: &Path,
+    digest: &str,
+    version: &str,
+    target: &str,
+) -> Result<PathBuf> {
+    let cache_root = std::env::var("CRASHPAD_CACHE_DIR")
         .map(PathBuf::from)
         .unwrap_or_else(|_| {
             dirs::cache_dir()
                 .unwrap_or_else(|| PathBuf::from(".cache"))
                 .join("crashpad-rs")
-        })
-        .join("prebuilt")
-        .join(&version)
-        .join(&target);
+        });
+    let store = cache_root.join("store");
 
-    // Clean and create cache directory
+    let tree = store.join("trees").join(digest);
+    if tree.is_dir() {
+        println!("  ✓ Reusing extracted {}", digest);
+    } else {
+        let archives = store.join("archives");
+        sh.create_dir(&archives)?;
+        fs::copy(archive, archives.join(format!("{digest}.tar.gz")))?;
+        println!("  ✓ Stored archive {}", digest);
+
+        let staging = store
+            .join("trees")
+            .join(format!(".{}.{}.tmp", digest, std::process::id()));
+        if staging.exists() {
+            sh.remove_path(&staging)?;
+        }
+        sh.create_dir(&staging)?;
+        cmd!(sh, "tar -xzf {archive} -C {staging}").run()?;
+        fs::rename(&staging, &tree)?;
+        println!("  ✓ Extracted in store");
+    }
+
+    let cache_dir = cache_root.join("prebuilt").join(version).join(target);
     if cache_dir.exists() {
         sh.remove_path(&cache_dir)?;
     }
     sh.create_dir(&cache_dir)?;
+    fs::write(cache_dir.join("sha256"), format!("{digest}\n"))?;
+    println!("  ✓ Recorded {} for {}", digest, target);
 
-    // Copy archive to cache (simulating download)
-    let cache_archive = cache_dir.join(&archive_name);
-    fs::copy(&archive_path, &cache_archive)?;
-    println!("  ✓ Copied archive to cache");
-
-    // Extract in cache (same as prebuilt.rs would do)
-    cmd!(sh, "tar -xzf {cache_archive} -C {cache_dir}").run()?;
-    println!("  ✓ Extracted in cache");
-
-    // Create marker file
-    let marker_file = cache_dir.join(".crashpad-ok");
-    fs::write(&marker_file, "")?;
-    println!("  ✓ Created .crashpad-ok marker");
-
-    // Clean up the archive from cache (it's already in target/prebuilt-archives/)
-    fs::remove_file(&cache_archive)?;
-
-    println!("\n✅ Prebuilt package created:");
-    println!("  📁 Build: {}", prebuilt_dir.display());
-    println!("  📁 Cache: {}", cache_dir.display());
-    println!("  📦 Archive: {}", archive_path.display());
-    println!("  🔐 Checksum: {}", checksum_path.display());
-    println!("\n📤 Ready to upload to GitHub Releases!");
-    println!("\n🧪 Test locally with: cargo build --package crashpad-rs-sys --features prebuilt");
-
-    Ok(())
+    Ok(tree)
 }
 
 /// Get package version from Cargo.toml
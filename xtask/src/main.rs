@@ -3,9 +3,12 @@ mod utils;
 
 use anyhow::Result;
 use clap::{Parser, Subcommand};
+use std::path::PathBuf;
 use xshell::Shell;
 
-use commands::{build, build_prebuilt, create_symlinks, dist, install_tools, test, update_deps};
+use commands::{
+    bench, build, build_prebuilt, create_symlinks, dist, install_tools, test, update_deps,
+};
 
 #[derive(Parser)]
 #[command(author, version, about = "Development tasks for crashpad-rs")]
@@ -24,6 +27,17 @@ enum Commands {
     },
     /// Package the crates for distribution
     Dist,
+    /// Run the client benchmarks and write the results as JSON
+    Bench {
+        /// Only run benchmarks whose id matches this regex
+        filter: Option<String>,
+        /// Results file (default: target/crashpad-bench/results.json)
+        #[arg(long)]
+        output: Option<PathBuf>,
+        /// Earlier results file to print size and latency deltas against
+        #[arg(long)]
+        baseline: Option<PathBuf>,
+    },
     /// Run tests in parallel using multiple processes
     Test,
     /// Install external development tools
@@ -38,9 +52,9 @@ enum Commands {
     Symlink,
     /// Build prebuilt packages for distribution
     BuildPrebuilt {
-        /// Target triple (optional, defaults to current)
+        /// Target triple, repeat for several (optional, defaults to current)
         #[arg(long)]
-        target: Option<String>,
+        target: Vec<String>,
     },
 }
 
@@ -59,6 +73,11 @@ fn main() -> Result<()> {
     match cli.command {
         Commands::Build { release } => build(&sh, release)?,
         Commands::Dist => dist(&sh)?,
+        Commands::Bench {
+            filter,
+            output,
+            baseline,
+        } => bench(&sh, filter, output, baseline)?,
         Commands::Test => test(&sh)?,
         Commands::InstallTools => install_tools(&sh)?,
         Commands::UpdateDeps { create_pr } => update_deps(&sh, create_pr)?,